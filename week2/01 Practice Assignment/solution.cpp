@@ -13,11 +13,15 @@ struct Spending {
 
 vector<Spending> LoadFromXml(istream& input) {
   Document doc = Load(input);
+  const NameId category = InternName("category");
+  const NameId amount = InternName("amount");
+
   vector<Spending> result;
+  result.reserve(doc.GetRoot().Children().size());
   for (const Node& node : doc.GetRoot().Children()) {
     result.push_back({
-      node.AttributeValue<string>("category"),
-      node.AttributeValue<int>("amount")
+      node.AttributeValue<string>(category),
+      node.AttributeValue<int>(amount)
     });
   }
   return result;
@@ -42,7 +42,20 @@ string MostExpensiveCategory(
 }
 
 vector<Spending> LoadFromXml(istream& input) {
- }
+  Document doc = Load(input);
+  const NameId category = InternName("category");
+  const NameId amount = InternName("amount");
+
+  vector<Spending> result;
+  result.reserve(doc.GetRoot().Children().size());
+  for (const Node& node : doc.GetRoot().Children()) {
+    result.push_back({
+      node.AttributeValue<string>(category),
+      node.AttributeValue<int>(amount)
+    });
+  }
+  return result;
+}
 
 void TestLoadFromXml() {
   istringstream xml_input(R"(<july>
@@ -95,8 +108,74 @@ void TestXmlLibrary() {
   ASSERT_EQUAL(july.Children().size(), 1u);
 }
 
+void TestNestedXml() {
+  istringstream xml_input(R"(<?xml version="1.0"?>
+<year name="2019">
+  <!-- расходы по месяцам -->
+  <month name="july">
+    <spend amount="2500" category="fast food"/>
+    <spend amount='1150' category="transport"></spend>
+  </month>
+  <month name="august">
+    <spend amount="-30" category="refund &amp; bonus"></spend>
+  </month>
+  <empty/>
+</year>)");
+
+  Document doc = Load(xml_input);
+  const Node& root = doc.GetRoot();
+  ASSERT_EQUAL(root.Name(), "year");
+  ASSERT_EQUAL(root.AttributeValue<string>("name"), "2019");
+  ASSERT_EQUAL(root.Children().size(), 3u);
+
+  const Node& july = root.Children()[0];
+  ASSERT_EQUAL(july.Name(), "month");
+  ASSERT_EQUAL(july.Children().size(), 2u);
+  ASSERT_EQUAL(july.Children()[0].AttributeValue<string>("category"), "fast food");
+  ASSERT_EQUAL(july.Children()[1].AttributeValue<int>("amount"), 1150);
+
+  const Node& refund = root.Children()[1].Children().front();
+  ASSERT_EQUAL(refund.AttributeValue<int>("amount"), -30);
+  ASSERT_EQUAL(refund.AttributeValue<string>("category"), "refund & bonus");
+
+  ASSERT_EQUAL(root.Children()[2].Name(), "empty");
+  ASSERT(root.Children()[2].Children().empty());
+}
+
+void TestInternedNames() {
+  Node spend("spend", {{"category", "food"}, {"amount", "2500"}});
+  const NameId amount = InternName("amount");
+  ASSERT_EQUAL(InternName("amount"), amount);
+  ASSERT_EQUAL(NameById(amount), "amount");
+  ASSERT_EQUAL(spend.NameCode(), InternName("spend"));
+  ASSERT_EQUAL(spend.AttributeValue<int>(amount), 2500);
+  ASSERT_EQUAL(spend.AttributeValue<double>("amount"), 2500.0);
+
+  // Как и istringstream, пропускаем пробелы и знак плюс перед числом
+  Node padded("spend", {{"amount", " 2500"}, {"delta", "+5"}, {"bad", "abc"}});
+  ASSERT_EQUAL(padded.AttributeValue<int>("amount"), 2500);
+  ASSERT_EQUAL(padded.AttributeValue<int>("delta"), 5);
+  ASSERT_EQUAL(padded.AttributeValue<double>("delta"), 5.0);
+  bool thrown = false;
+  try {
+    padded.AttributeValue<int>("bad");
+  } catch (invalid_argument&) {
+    thrown = true;
+  }
+  Assert(thrown, "AttributeValue() should throw invalid_argument for non-number");
+
+  try {
+    spend.AttributeValue<int>("no_such_attribute");
+    Assert(false, "AttributeValue() should throw out_of_range for unknown attribute");
+  } catch (out_of_range&) {
+  }
+  ASSERT(!FindName("no_such_attribute"));
+}
+
 int main() {
   TestRunner tr;
   RUN_TEST(tr, TestXmlLibrary);
   RUN_TEST(tr, TestLoadFromXml);
+  RUN_TEST(tr, TestNestedXml);
+  RUN_TEST(tr, TestInternedNames);
 }
@@ -1,67 +1,218 @@
 #include "xml.h"
 
+#include <deque>
+#include <iterator>
 #include <string_view>
 #include <iostream>
+#include <unordered_map>
 using namespace std;
 
-pair<string_view, string_view> Split(string_view line, char by) {
-  size_t pos = line.find(by);
-  string_view left = line.substr(0, pos);
+namespace {
 
-  if (pos < line.size() && pos + 1 < line.size()) {
-    return {left, line.substr(pos + 1)};
-  } else {
-    return {left, string_view()};
-  }
+// Строки лежат в deque, поэтому string_view-ключи не инвалидируются при росте
+struct NameTable {
+  deque<string> names;
+  unordered_map<string_view, NameId> ids;
+};
+
+NameTable& Names() {
+  static NameTable table;
+  return table;
+}
+
+bool IsNameChar(char c) {
+  return !isspace(static_cast<unsigned char>(c)) &&
+         c != '=' && c != '>' && c != '/' && c != '<';
 }
 
-string_view Lstrip(string_view line) {
-  while (!line.empty() && isspace(line[0])) {
-    line.remove_prefix(1);
+string DecodeEntities(string_view value) {
+  static const pair<string_view, char> entities[] = {
+    {"&lt;", '<'}, {"&gt;", '>'}, {"&amp;", '&'}, {"&quot;", '"'}, {"&apos;", '\''}
+  };
+
+  string result;
+  result.reserve(value.size());
+  while (!value.empty()) {
+    size_t amp = value.find('&');
+    result.append(value.substr(0, amp));
+    if (amp == string_view::npos) {
+      break;
+    }
+    value.remove_prefix(amp);
+    bool decoded = false;
+    for (const auto& [entity, c] : entities) {
+      if (value.substr(0, entity.size()) == entity) {
+        result.push_back(c);
+        value.remove_prefix(entity.size());
+        decoded = true;
+        break;
+      }
+    }
+    if (!decoded) {
+      result.push_back('&');
+      value.remove_prefix(1);
+    }
   }
-  return line;
+  return result;
 }
 
-string_view Unquote(string_view value) {
-  if (!value.empty() && value.front() == '"') {
-    value.remove_prefix(1);
+class Parser {
+public:
+  explicit Parser(string_view text) : rest(text) {
+  }
+
+  Node ParseRoot() {
+    SkipMisc();
+    return ParseElement();
+  }
+
+private:
+  string_view rest;
+
+  void SkipSpaces() {
+    while (!rest.empty() && isspace(static_cast<unsigned char>(rest.front()))) {
+      rest.remove_prefix(1);
+    }
   }
-  if (!value.empty() && value.back() == '"') {
-    value.remove_suffix(1);
+
+  void SkipPast(string_view marker) {
+    size_t pos = rest.find(marker);
+    rest.remove_prefix(pos == string_view::npos ? rest.size() : pos + marker.size());
   }
-  return value;
-}
-
-Node LoadNode(istream& input) {
-  string root_name;
-  getline(input, root_name);
-
-  Node root(root_name.substr(1, root_name.size() - 2), {});
-  for (string line; getline(input, line) && Lstrip(line)[1] != '/'; ) {
-    auto [node_name, attrs] = Split(Lstrip(line), ' ');
-    attrs = Split(attrs, '>').first;
-    unordered_map<string, string> node_attrs;
-    while (!attrs.empty()) {
-      auto [head, tail] = Split(attrs, ' ');
-      auto [name, value] = Split(head, '=');
-      if (!name.empty() && !value.empty()) {
-        node_attrs[string(Unquote(name))] = string(Unquote(value));
+
+  // Пропускает текст, объявления <?...?> и комментарии <!-- ... --> до следующего тега
+  void SkipMisc() {
+    while (true) {
+      rest.remove_prefix(min(rest.find('<'), rest.size()));
+      if (rest.substr(0, 4) == "<!--") {
+        SkipPast("-->");
+      } else if (rest.substr(0, 2) == "<?" || rest.substr(0, 2) == "<!") {
+        SkipPast(">");
+      } else {
+        return;
       }
-      attrs = tail;
     }
+  }
 
-    root.AddChild(Node(string(node_name.substr(1)), move(node_attrs)));
+  string_view ReadName() {
+    size_t len = 0;
+    while (len < rest.size() && IsNameChar(rest[len])) {
+      ++len;
+    }
+    string_view name = rest.substr(0, len);
+    rest.remove_prefix(len);
+    return name;
   }
-  return root;
+
+  string_view ReadValue() {
+    if (rest.empty()) {
+      return {};
+    }
+    const char quote = rest.front();
+    if (quote != '"' && quote != '\'') {
+      return ReadName();
+    }
+    rest.remove_prefix(1);
+    size_t end = rest.find(quote);
+    string_view value = rest.substr(0, end);
+    rest.remove_prefix(min(end + 1, rest.size()));
+    return value;
+  }
+
+  Node ParseElement() {
+    if (rest.empty() || rest.front() != '<') {
+      throw runtime_error("xml: element expected");
+    }
+    rest.remove_prefix(1);
+    const NameId name = InternName(ReadName());
+
+    vector<pair<NameId, string>> attrs;
+    while (true) {
+      SkipSpaces();
+      if (rest.empty()) {
+        throw runtime_error("xml: unexpected end of input");
+      } else if (rest.front() == '/' || rest.front() == '>') {
+        break;
+      }
+      const string_view attr_name = ReadName();
+      if (attr_name.empty()) {
+        throw runtime_error("xml: malformed attribute");
+      }
+      SkipSpaces();
+      string_view value;
+      if (!rest.empty() && rest.front() == '=') {
+        rest.remove_prefix(1);
+        SkipSpaces();
+        value = ReadValue();
+      }
+      attrs.emplace_back(
+        InternName(attr_name),
+        value.find('&') == string_view::npos ? string(value) : DecodeEntities(value)
+      );
+    }
+
+    Node node(name, move(attrs));
+    if (rest.front() == '/') {
+      SkipPast(">");
+      return node;
+    }
+    rest.remove_prefix(1);
+
+    while (true) {
+      SkipMisc();
+      if (rest.empty()) {
+        throw runtime_error("xml: unclosed element " + string(NameById(name)));
+      } else if (rest.substr(0, 2) == "</") {
+        SkipPast(">");
+        return node;
+      }
+      node.AddChild(ParseElement());
+    }
+  }
+};
+
+}
+
+NameId InternName(string_view name) {
+  NameTable& table = Names();
+  if (auto it = table.ids.find(name); it != table.ids.end()) {
+    return it->second;
+  }
+  const NameId id = static_cast<NameId>(table.names.size());
+  const string& stored = table.names.emplace_back(name);
+  table.ids.emplace(stored, id);
+  return id;
+}
+
+optional<NameId> FindName(string_view name) {
+  const NameTable& table = Names();
+  if (auto it = table.ids.find(name); it != table.ids.end()) {
+    return it->second;
+  }
+  return nullopt;
+}
+
+string_view NameById(NameId id) {
+  return Names().names.at(id);
 }
 
 Document Load(istream& input) {
-  return Document{LoadNode(input)};
+  const string text{istreambuf_iterator<char>(input), istreambuf_iterator<char>()};
+  return Document{Parser(text).ParseRoot()};
 }
 
 Node::Node(
-  string name, unordered_map<string, string> attrs
-) : name(move(name)), attrs(move(attrs)) {
+  string name, vector<pair<string, string>> attrs
+) : name(InternName(name)) {
+  this->attrs.reserve(attrs.size());
+  for (auto& [attr_name, value] : attrs) {
+    this->attrs.emplace_back(InternName(attr_name), move(value));
+  }
+}
+
+Node::Node(
+  NameId name, vector<pair<NameId, string>> attrs
+) : name(name), attrs(move(attrs)) {
 }
 
 const vector<Node>& Node::Children() const {
@@ -80,5 +231,9 @@ void Node::AddChild(Node node) {
 }
 
 string_view Node::Name() const {
+  return NameById(name);
+}
+
+NameId Node::NameCode() const {
   return name;
 }
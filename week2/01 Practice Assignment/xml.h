@@ -1,28 +1,51 @@
 #pragma once
 
+#include <cctype>
+#include <charconv>
+#include <cstdint>
 #include <istream>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <vector>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <type_traits>
+#include <utility>
 using namespace std;
 
+// Имена элементов и атрибутов хранятся один раз в общей таблице,
+// а узлы ссылаются на них по небольшому целому номеру
+using NameId = uint32_t;
+
+NameId InternName(string_view name);
+optional<NameId> FindName(string_view name);
+string_view NameById(NameId id);
+
 class Node {
 public:
-  Node(string name, unordered_map<string, string> attrs);
+  Node(string name, vector<pair<string, string>> attrs);
+  Node(NameId name, vector<pair<NameId, string>> attrs);
 
   const vector<Node>& Children() const;
   void AddChild(Node node);
   string_view Name() const;
+  NameId NameCode() const;
 
   template <typename T>
-  T AttributeValue(const string& name) const;
+  T AttributeValue(string_view name) const;
+
+  // В горячих циклах имя атрибута лучше один раз перевести в NameId
+  // через InternName и обращаться по нему: так не нужен поиск по строке
+  template <typename T>
+  T AttributeValue(NameId name) const;
 
 private:
-  string name;
+  const string& RawAttribute(NameId name) const;
+
+  NameId name;
   vector<Node> children;
-  unordered_map<string, string> attrs;
+  vector<pair<NameId, string>> attrs;
 };
 
 class Document {
@@ -40,10 +63,50 @@ Document Load(istream& input);
 
 
 
+inline const string& Node::RawAttribute(NameId name) const {
+  for (const auto& [attr_name, value] : attrs) {
+    if (attr_name == name) {
+      return value;
+    }
+  }
+  throw out_of_range("no attribute " + string(NameById(name)));
+}
+
+template <typename T>
+inline T Node::AttributeValue(NameId name) const {
+  const string& value = RawAttribute(name);
+  if constexpr (is_same_v<T, string>) {
+    return value;
+  } else if constexpr (
+    (is_integral_v<T> && !is_same_v<T, bool>) || is_floating_point_v<T>
+  ) {
+    // Как и istringstream, пропускаем пробелы и знак плюс перед числом
+    const char* first = value.data();
+    const char* last = value.data() + value.size();
+    while (first != last && isspace(static_cast<unsigned char>(*first))) {
+      ++first;
+    }
+    if (first != last && *first == '+' && (last - first == 1 || first[1] != '-')) {
+      ++first;
+    }
+    T result{};
+    const auto [ptr, ec] = from_chars(first, last, result);
+    if (ec != errc() || ptr == first) {
+      throw invalid_argument("bad number in attribute " + string(NameById(name)) + ": " + value);
+    }
+    return result;
+  } else {
+    istringstream attr_input(value);
+    T result;
+    attr_input >> result;
+    return result;
+  }
+}
+
 template <typename T>
-inline T Node::AttributeValue(const string& name) const {
-  istringstream attr_input(attrs.at(name));
-  T result;
-  attr_input >> result;
-  return result;
+inline T Node::AttributeValue(string_view name) const {
+  if (auto id = FindName(name)) {
+    return AttributeValue<T>(*id);
+  }
+  throw out_of_range("no attribute " + string(name));
 }
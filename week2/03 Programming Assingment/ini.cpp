@@ -1,14 +1,24 @@
 #include "ini.h"
 #include <unordered_map>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
 
-std::pair<std::string, std::string> Split(std::string line, char by) {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::pair<std::string_view, std::string_view> Split(std::string_view line, char by) {
     size_t pos = line.find(by);
-    std::string left = line.substr(0, pos);
+    std::string_view left = line.substr(0, pos);
+    // Как и в исходной версии: строка без '=' даёт пару {line, line},
+    // потому что npos + 1 == 0
     return {left, line.substr(pos + 1)};
 }
 
 Ini::Section &Ini::Document::AddSection(std::string name) {
-    return sections[name];
+    return sections[std::move(name)];
 }
 
 const Ini::Section &Ini::Document::GetSection(const std::string &name) const {
@@ -21,18 +31,107 @@ size_t Ini::Document::SectionCount() const {
 
 Ini::Document Ini::Load(std::istream &input) {
     Ini::Document doc;
-    std::string name;
+    Ini::Section *section = nullptr;
     for (std::string line; std::getline(input, line);) {
         if (line == "") {
             continue;
         } else if (line[0] == '[') {
-            name = line.substr(1, line.size() - 2);
-            doc.AddSection(name);
+            section = &doc.AddSection(line.substr(1, line.size() - 2));
         } else {
-            doc.AddSection(name).insert(Split(line, '='));
+            if (section == nullptr) {
+                section = &doc.AddSection("");
+            }
+            auto [key, value] = Split(line, '=');
+            section->emplace(key, value);
         }
-
     }
 
     return doc;
 }
+
+Ini::MappedFile::MappedFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) < 0) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "fstat " + path);
+    }
+
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int error = errno;
+            close(fd);
+            data = nullptr;
+            throw std::system_error(error, std::generic_category(), "mmap " + path);
+        }
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+}
+
+Ini::MappedFile::MappedFile(MappedFile &&other) noexcept
+        : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {
+}
+
+Ini::MappedFile &Ini::MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        if (data != nullptr) {
+            munmap(data, size);
+        }
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+    }
+    return *this;
+}
+
+Ini::MappedFile::~MappedFile() {
+    if (data != nullptr) {
+        munmap(data, size);
+    }
+}
+
+std::string_view Ini::MappedFile::Contents() const {
+    return {static_cast<const char *>(data), size};
+}
+
+// Содержимое отображения не переезжает при перемещении MappedFile,
+// поэтому string_view в sections остаются валидными
+Ini::DocumentView::DocumentView(MappedFile mapped) : file(std::move(mapped)) {
+    std::string_view text = file.Contents();
+    SectionView *section = nullptr;
+    while (!text.empty()) {
+        size_t eol = text.find('\n');
+        std::string_view line = text.substr(0, eol);
+        text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+
+        if (line.empty()) {
+            continue;
+        } else if (line[0] == '[') {
+            section = &sections[line.substr(1, line.size() - 2)];
+        } else {
+            if (section == nullptr) {
+                section = &sections[std::string_view()];
+            }
+            section->insert(Split(line, '='));
+        }
+    }
+}
+
+const Ini::SectionView &Ini::DocumentView::GetSection(std::string_view name) const {
+    return sections.at(name);
+}
+
+size_t Ini::DocumentView::SectionCount() const {
+    return sections.size();
+}
+
+Ini::DocumentView Ini::LoadMapped(const std::string &path) {
+    return DocumentView(MappedFile(path));
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <iostream>
 
@@ -21,4 +22,43 @@ namespace Ini {
     };
 
     Document Load(std::istream &input);
+
+    // Файл, отображённый в память только для чтения
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string &path);
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile &operator=(MappedFile &&other) noexcept;
+
+        ~MappedFile();
+
+        std::string_view Contents() const;
+
+    private:
+        void *data = nullptr;
+        size_t size = 0;
+    };
+
+    using SectionView = std::unordered_map<std::string_view, std::string_view>;
+
+    // Документ, ключи и значения которого указывают прямо в отображённый файл.
+    // Секции ищутся по string_view, поэтому поиск ничего не аллоцирует
+    class DocumentView {
+    public:
+        explicit DocumentView(MappedFile file);
+
+        const SectionView &GetSection(std::string_view name) const;
+
+        size_t SectionCount() const;
+
+    private:
+        MappedFile file;
+        std::unordered_map<std::string_view, SectionView> sections;
+    };
+
+    DocumentView LoadMapped(const std::string &path);
 }
@@ -0,0 +1,350 @@
+#include "ini_reloader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace {
+
+    // Читает файл целиком в строку. Отображение в память тут не годится:
+    // файл могут обрезать прямо во время разбора, и обращение к отрезанным
+    // страницам закончилось бы SIGBUS
+    std::string ReadWholeFile(const std::string &path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+
+        std::string contents;
+        struct stat st{};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            contents.reserve(static_cast<size_t>(st.st_size));
+        }
+        char buffer[1 << 16];
+        for (;;) {
+            ssize_t len = read(fd, buffer, sizeof(buffer));
+            if (len < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int error = errno;
+                close(fd);
+                throw std::system_error(error, std::generic_category(), "read " + path);
+            }
+            if (len == 0) {
+                break;
+            }
+            contents.append(buffer, static_cast<size_t>(len));
+        }
+        close(fd);
+        return contents;
+    }
+
+    std::pair<std::string_view, std::string_view> SplitLine(std::string_view line, char by) {
+        size_t pos = line.find(by);
+        // Как и Split из ini.cpp: строка без '=' даёт пару {line, line}
+        return {line.substr(0, pos), line.substr(pos + 1)};
+    }
+
+    // Разбивает текст на участки, каждый из которых начинается с заголовка секции.
+    // Участки секций с одинаковым именем склеиваются в порядке следования
+    std::vector<std::pair<std::string_view, std::string>> SplitIntoRegions(std::string_view text) {
+        std::vector<std::pair<std::string_view, std::string>> regions;
+        std::unordered_map<std::string_view, size_t> index;
+        size_t current = 0;
+
+        while (!text.empty()) {
+            size_t eol = text.find('\n');
+            std::string_view line = text.substr(0, eol);
+            text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+
+            if (line.empty()) {
+                continue;
+            } else if (line[0] == '[') {
+                std::string_view name = line.substr(1, line.size() - 2);
+                auto [it, inserted] = index.emplace(name, regions.size());
+                if (inserted) {
+                    regions.emplace_back(name, std::string());
+                }
+                current = it->second;
+            } else {
+                if (regions.empty()) {
+                    index.emplace(std::string_view(), 0);
+                    regions.emplace_back(std::string_view(), std::string());
+                }
+                regions[current].second.append(line).push_back('\n');
+            }
+        }
+        return regions;
+    }
+
+    Ini::Section ParseRegion(std::string_view raw) {
+        Ini::Section section;
+        while (!raw.empty()) {
+            size_t eol = raw.find('\n');
+            section.insert(SplitLine(raw.substr(0, eol), '='));
+            raw.remove_prefix(eol == std::string_view::npos ? raw.size() : eol + 1);
+        }
+        return section;
+    }
+
+    Ini::SectionDiff DiffSections(std::string name, const Ini::Section &before, const Ini::Section &after) {
+        Ini::SectionDiff diff{std::move(name), Ini::SectionDiff::Kind::Changed, {}, {}, {}};
+        for (const auto &[key, value] : after) {
+            if (auto it = before.find(key); it == before.end()) {
+                diff.added_keys.push_back(key);
+            } else if (it->second != value) {
+                diff.changed_keys.push_back(key);
+            }
+        }
+        for (const auto &[key, value] : before) {
+            if (after.count(key) == 0) {
+                diff.removed_keys.push_back(key);
+            }
+        }
+        std::sort(diff.added_keys.begin(), diff.added_keys.end());
+        std::sort(diff.removed_keys.begin(), diff.removed_keys.end());
+        std::sort(diff.changed_keys.begin(), diff.changed_keys.end());
+        return diff;
+    }
+
+}
+
+const Ini::Section &Ini::Snapshot::GetSection(std::string_view name) const {
+    return sections.at(name)->section;
+}
+
+size_t Ini::Snapshot::SectionCount() const {
+    return sections.size();
+}
+
+uint64_t Ini::Snapshot::Version() const {
+    return version;
+}
+
+bool Ini::Reloader::FileStamp::operator==(const FileStamp &other) const {
+    return mtime_ns == other.mtime_ns && size == other.size && inode == other.inode;
+}
+
+Ini::Reloader::Reloader(std::string path) : path(std::move(path)) {
+#ifdef __linux__
+    // Следим за каталогом, а не за самим файлом: так мы не теряем
+    // замену файла через rename, которой пользуются редакторы и деплой
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd >= 0) {
+        size_t slash = this->path.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : this->path.substr(0, slash + 1);
+        if (inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0) {
+            close(inotify_fd);
+            inotify_fd = -1;
+        }
+    }
+#endif
+    // Деструктор у недостроенного объекта не вызовется, закрываем дескриптор сами
+    try {
+        Reload();
+    } catch (...) {
+        if (inotify_fd >= 0) {
+            close(inotify_fd);
+        }
+        throw;
+    }
+}
+
+Ini::Reloader::~Reloader() {
+    Stop();
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+    }
+}
+
+std::shared_ptr<const Ini::Snapshot> Ini::Reloader::Current() const {
+    // Разные потоки начинают поиск свободного слота с разных мест
+    static thread_local const size_t first_slot = std::hash<std::thread::id>()(std::this_thread::get_id());
+    for (size_t i = first_slot;; ++i) {
+        std::atomic<const Snapshot *> &slot = hazards[i % hazard_slot_count].snapshot;
+        const Snapshot *snapshot = current.load();
+        const Snapshot *expected = nullptr;
+        if (!slot.compare_exchange_strong(expected, snapshot)) {
+            continue;
+        }
+        // Publish сначала меняет current, а потом просматривает слоты. Если
+        // после записи в слот current не изменился, Publish увидит наш слот
+        // и не освободит снимок, пока мы не увеличим счётчик ссылок
+        if (current.load() == snapshot) {
+            std::shared_ptr<const Snapshot> result = snapshot->shared_from_this();
+            slot.store(nullptr);
+            return result;
+        }
+        slot.store(nullptr);
+    }
+}
+
+void Ini::Reloader::Subscribe(Subscriber subscriber) {
+    std::lock_guard guard(writer_mutex);
+    subscribers.push_back(std::move(subscriber));
+}
+
+bool Ini::Reloader::Reload() {
+    std::unique_lock lock(writer_mutex);
+
+    stamp = ReadStamp();
+    const std::string contents = ReadWholeFile(path);
+    const std::shared_ptr<const Snapshot> previous = owner;
+
+    auto next = std::make_shared<Snapshot>();
+    next->version = previous == nullptr ? 1 : previous->Version() + 1;
+    std::vector<SectionDiff> diff;
+
+    for (auto &[name, raw] : SplitIntoRegions(contents)) {
+        std::shared_ptr<const Snapshot::ParsedSection> parsed;
+        if (previous != nullptr) {
+            if (auto it = previous->sections.find(name); it != previous->sections.end()) {
+                if (it->second->raw == raw) {
+                    parsed = it->second;
+                } else {
+                    auto changed = std::make_shared<Snapshot::ParsedSection>(
+                            Snapshot::ParsedSection{std::string(name), std::move(raw), {}});
+                    changed->section = ParseRegion(changed->raw);
+                    diff.push_back(DiffSections(changed->name, it->second->section, changed->section));
+                    parsed = std::move(changed);
+                }
+            }
+        }
+        if (!parsed) {
+            auto added = std::make_shared<Snapshot::ParsedSection>(
+                    Snapshot::ParsedSection{std::string(name), std::move(raw), {}});
+            added->section = ParseRegion(added->raw);
+            if (previous != nullptr) {
+                diff.push_back(DiffSections(added->name, {}, added->section));
+                diff.back().kind = SectionDiff::Kind::Added;
+            }
+            parsed = std::move(added);
+        }
+        next->sections.emplace(parsed->name, std::move(parsed));
+    }
+
+    if (previous != nullptr) {
+        for (const auto &[name, parsed] : previous->sections) {
+            if (next->sections.count(name) == 0) {
+                diff.push_back(DiffSections(parsed->name, parsed->section, {}));
+                diff.back().kind = SectionDiff::Kind::Removed;
+            }
+        }
+        if (diff.empty()) {
+            return false;
+        }
+    }
+    std::sort(diff.begin(), diff.end(), [](const SectionDiff &lhs, const SectionDiff &rhs) {
+        return lhs.name < rhs.name;
+    });
+
+    Publish(next);
+    const std::vector<Subscriber> to_notify = subscribers;
+    lock.unlock();
+
+    for (const Subscriber &subscriber : to_notify) {
+        subscriber(*next, diff);
+    }
+    return true;
+}
+
+void Ini::Reloader::Publish(std::shared_ptr<const Snapshot> next) {
+    current.store(next.get());
+    if (owner != nullptr) {
+        retired.push_back(std::move(owner));
+    }
+    owner = std::move(next);
+
+    retired.erase(std::remove_if(retired.begin(), retired.end(), [this](const auto &snapshot) {
+        return std::none_of(hazards.begin(), hazards.end(), [&snapshot](const HazardSlot &slot) {
+            return slot.snapshot.load() == snapshot.get();
+        });
+    }), retired.end());
+}
+
+bool Ini::Reloader::Poll() {
+    if (inotify_fd >= 0) {
+        if (!HasPendingEvents()) {
+            return false;
+        }
+    } else {
+        std::lock_guard guard(writer_mutex);
+        if (ReadStamp() == stamp) {
+            return false;
+        }
+    }
+    return Reload();
+}
+
+void Ini::Reloader::Start(std::chrono::milliseconds poll_interval) {
+    if (running.exchange(true)) {
+        return;
+    }
+    watcher = std::thread([this, poll_interval] {
+        while (running.load()) {
+            if (inotify_fd >= 0) {
+                pollfd fd{inotify_fd, POLLIN, 0};
+                ::poll(&fd, 1, static_cast<int>(poll_interval.count()));
+            } else {
+                std::this_thread::sleep_for(poll_interval);
+            }
+            try {
+                Poll();
+            } catch (std::exception &) {
+                // Файл могут заменять прямо сейчас: оставляем текущий снимок
+                // и пробуем снова на следующей итерации
+            }
+        }
+    });
+}
+
+void Ini::Reloader::Stop() {
+    if (running.exchange(false) && watcher.joinable()) {
+        watcher.join();
+    }
+}
+
+Ini::Reloader::FileStamp Ini::Reloader::ReadStamp() const {
+    struct stat st{};
+    if (stat(path.c_str(), &st) < 0) {
+        return {};
+    }
+    return {
+            static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec,
+            static_cast<int64_t>(st.st_size),
+            static_cast<int64_t>(st.st_ino),
+    };
+}
+
+bool Ini::Reloader::HasPendingEvents() {
+    bool relevant = false;
+#ifdef __linux__
+    size_t slash = path.rfind('/');
+    std::string_view file_name = slash == std::string::npos ? std::string_view(path)
+                                                            : std::string_view(path).substr(slash + 1);
+
+    alignas(inotify_event) char buffer[4096];
+    for (ssize_t len; (len = read(inotify_fd, buffer, sizeof(buffer))) > 0;) {
+        for (char *ptr = buffer; ptr < buffer + len;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(ptr);
+            if (event->len > 0 && file_name == event->name) {
+                relevant = true;
+            }
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+#endif
+    return relevant;
+}
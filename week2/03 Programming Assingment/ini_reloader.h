@@ -0,0 +1,128 @@
+#pragma once
+
+#include "ini.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Ini {
+
+    // Неизменяемый снимок документа. Секции, не поменявшиеся между
+    // перезагрузками, разделяются соседними снимками
+    class Snapshot : public std::enable_shared_from_this<Snapshot> {
+    public:
+        const Section &GetSection(std::string_view name) const;
+
+        size_t SectionCount() const;
+
+        uint64_t Version() const;
+
+    private:
+        friend class Reloader;
+
+        struct ParsedSection {
+            std::string name;
+            std::string raw;
+            Section section;
+        };
+
+        uint64_t version = 0;
+        std::unordered_map<std::string_view, std::shared_ptr<const ParsedSection>> sections;
+    };
+
+    struct SectionDiff {
+        enum class Kind {
+            Added,
+            Removed,
+            Changed,
+        };
+
+        std::string name;
+        Kind kind;
+        std::vector<std::string> added_keys, removed_keys, changed_keys;
+    };
+
+    // Следит за INI-файлом и публикует новые снимки атомарной заменой указателя.
+    //
+    // Current() не берёт блокировок: читатель защищает сырой указатель
+    // hazard-слотом, проверяет, что он всё ещё опубликован, и только потом
+    // получает shared_ptr через shared_from_this. Reload освобождает старый
+    // снимок, лишь когда ни один слот на него не указывает. Полученный
+    // shared_ptr можно держать сколько угодно перезагрузок
+    class Reloader {
+    public:
+        using Subscriber = std::function<void(const Snapshot &, const std::vector<SectionDiff> &)>;
+
+        explicit Reloader(std::string path);
+
+        Reloader(const Reloader &) = delete;
+        Reloader &operator=(const Reloader &) = delete;
+
+        ~Reloader();
+
+        std::shared_ptr<const Snapshot> Current() const;
+
+        void Subscribe(Subscriber subscriber);
+
+        // Перечитывает файл; возвращает true, если содержимое поменялось.
+        // Подписчики вызываются уже без блокировки, так что из них можно
+        // подписываться и перечитывать файл
+        bool Reload();
+
+        // Перечитывает файл, только если inotify (или stat, если inotify
+        // недоступен) сообщает об изменении
+        bool Poll();
+
+        void Start(std::chrono::milliseconds poll_interval);
+
+        void Stop();
+
+    private:
+        struct FileStamp {
+            int64_t mtime_ns = -1, size = -1, inode = -1;
+
+            bool operator==(const FileStamp &other) const;
+        };
+
+        FileStamp ReadStamp() const;
+
+        bool HasPendingEvents();
+
+        // Публикует next и освобождает снимки, которые больше никто не читает.
+        // Вызывается под writer_mutex
+        void Publish(std::shared_ptr<const Snapshot> next);
+
+        struct alignas(64) HazardSlot {
+            std::atomic<const Snapshot *> snapshot{nullptr};
+        };
+
+        static constexpr size_t hazard_slot_count = 64;
+
+        const std::string path;
+        std::atomic<const Snapshot *> current{nullptr};
+        mutable std::array<HazardSlot, hazard_slot_count> hazards;
+
+        std::mutex writer_mutex;
+        // Владеет опубликованным снимком
+        std::shared_ptr<const Snapshot> owner;
+        // Заменённые снимки, которые в момент замены ещё защищал чей-то слот
+        std::vector<std::shared_ptr<const Snapshot>> retired;
+        std::vector<Subscriber> subscribers;
+        FileStamp stamp;
+
+        int inotify_fd = -1;
+        std::atomic<bool> running{false};
+        std::thread watcher;
+    };
+
+}
@@ -1,8 +1,16 @@
 #include "test_runner.h"
 
 #include "ini.h"
+#include "ini_reloader.h"
+#include "profile.h"
 
+#include <atomic>
+#include <cstdio>
+#include <fstream>
 #include <sstream>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
@@ -107,11 +115,237 @@ void TestDuplicateSections() {
   ASSERT_EQUAL(doc.GetSection("one"), expected);
 }
 
-int main() {
+void TestLoadMapped() {
+  const string path = "test_load_mapped.ini";
+  {
+    ofstream output(path);
+    output << "[july]\nfood=2500\nsport=12000\n\n[august]\nfood=3250\ntravel=0\nfood=1\n";
+  }
+  ifstream input(path);
+  const Ini::Document doc = Ini::Load(input);
+  const Ini::DocumentView view = Ini::LoadMapped(path);
+  remove(path.c_str());
+
+  ASSERT_EQUAL(view.SectionCount(), doc.SectionCount());
+  for (const char* name : {"july", "august"}) {
+    const Ini::SectionView& section = view.GetSection(name);
+    ASSERT_EQUAL(section.size(), doc.GetSection(name).size());
+    for (const auto& [key, value] : doc.GetSection(name)) {
+      ASSERT_EQUAL(section.at(key), value);
+    }
+  }
+
+  try {
+    view.GetSection("september");
+    Assert(false, "Ini::DocumentView::GetSection() should throw std::out_of_range for unknown section");
+  } catch (out_of_range&) {
+  }
+}
+
+void WriteFile(const string& path, const string& content) {
+  ofstream output(path);
+  output << content;
+}
+
+void TestLineWithoutEquals() {
+  const string path = "test_line_without_equals.ini";
+  {
+    ofstream output(path);
+    output << "[flags]\nverbose\nlevel=3\n";
+  }
+  ifstream input(path);
+  const Ini::Document doc = Ini::Load(input);
+  const Ini::DocumentView view = Ini::LoadMapped(path);
+  remove(path.c_str());
+
+  const Ini::Section expected = {{"verbose", "verbose"}, {"level", "3"}};
+  ASSERT_EQUAL(doc.GetSection("flags"), expected);
+  ASSERT_EQUAL(view.GetSection("flags").at("verbose"), "verbose");
+
+  WriteFile(path, "[flags]\nverbose\nlevel=3\n");
+  Ini::Reloader reloader(path);
+  remove(path.c_str());
+  ASSERT_EQUAL(reloader.Current()->GetSection("flags"), expected);
+}
+
+void TestReloaderDiff() {
+  const string path = "test_reloader_diff.ini";
+  WriteFile(path, "[july]\nfood=2500\nsport=12000\n\n[august]\nfood=3250\n\n[june]\ntravel=1\n");
+
+  Ini::Reloader reloader(path);
+  const auto first = reloader.Current();
+  ASSERT_EQUAL(first->SectionCount(), 3u);
+  ASSERT_EQUAL(first->GetSection("july").at("sport"), "12000");
+
+  vector<Ini::SectionDiff> diff;
+  reloader.Subscribe([&diff](const Ini::Snapshot&, const vector<Ini::SectionDiff>& d) {
+    diff = d;
+  });
+
+  ASSERT(!reloader.Reload());
+
+  WriteFile(path, "[july]\nfood=2500\nsport=12000\n\n[august]\nfood=3000\nclothes=8300\n\n[september]\nfood=1\n");
+  ASSERT(reloader.Reload());
+  remove(path.c_str());
+
+  const auto second = reloader.Current();
+  ASSERT_EQUAL(second->Version(), first->Version() + 1);
+  ASSERT_EQUAL(second->GetSection("august").at("food"), "3000");
+  // Неизменившаяся секция не перечитывается и разделяется снимками
+  ASSERT(&second->GetSection("july") == &first->GetSection("july"));
+
+  ASSERT_EQUAL(diff.size(), 3u);
+  ASSERT_EQUAL(diff[0].name, "august");
+  ASSERT(diff[0].kind == Ini::SectionDiff::Kind::Changed);
+  ASSERT_EQUAL(diff[0].added_keys, vector<string>{"clothes"});
+  ASSERT_EQUAL(diff[0].changed_keys, vector<string>{"food"});
+  ASSERT(diff[0].removed_keys.empty());
+  ASSERT_EQUAL(diff[1].name, "june");
+  ASSERT(diff[1].kind == Ini::SectionDiff::Kind::Removed);
+  ASSERT_EQUAL(diff[1].removed_keys, vector<string>{"travel"});
+  ASSERT_EQUAL(diff[2].name, "september");
+  ASSERT(diff[2].kind == Ini::SectionDiff::Kind::Added);
+}
+
+void TestReloaderPoll() {
+  const string path = "test_reloader_poll.ini";
+  WriteFile(path, "[july]\nfood=2500\n");
+
+  Ini::Reloader reloader(path);
+  ASSERT(!reloader.Poll());
+
+  WriteFile(path, "[july]\nfood=2600\n");
+  ASSERT(reloader.Poll());
+  ASSERT_EQUAL(reloader.Current()->GetSection("july").at("food"), "2600");
+
+  reloader.Start(chrono::milliseconds(5));
+  WriteFile(path, "[july]\nfood=2700\n");
+  for (int i = 0; i < 200 && reloader.Current()->GetSection("july").at("food") != "2700"; ++i) {
+    this_thread::sleep_for(chrono::milliseconds(5));
+  }
+  reloader.Stop();
+  remove(path.c_str());
+
+  ASSERT_EQUAL(reloader.Current()->GetSection("july").at("food"), "2700");
+}
+
+void TestReloaderMissingFile() {
+  try {
+    Ini::Reloader reloader("test_reloader_missing.ini");
+    Assert(false, "Ini::Reloader should throw for a missing file");
+  } catch (system_error&) {
+  }
+}
+
+void TestReloaderSnapshotLifetime() {
+  const string path = "test_reloader_lifetime.ini";
+  WriteFile(path, "[july]\nfood=0\n");
+
+  Ini::Reloader reloader(path);
+  const auto first = reloader.Current();
+  // Подписчик может подписываться и перечитывать файл, не попадая в deadlock
+  int nested_calls = 0;
+  reloader.Subscribe([&](const Ini::Snapshot& snapshot, const vector<Ini::SectionDiff>&) {
+    if (snapshot.Version() == 2) {
+      reloader.Subscribe([&nested_calls](const Ini::Snapshot&, const vector<Ini::SectionDiff>&) {
+        ++nested_calls;
+      });
+      reloader.Reload();
+    }
+  });
+  for (int i = 1; i <= 40; ++i) {
+    WriteFile(path, "[july]\nfood=" + to_string(i) + "\n");
+    ASSERT(reloader.Reload());
+  }
+  remove(path.c_str());
+
+  // Снимок, полученный 40 перезагрузок назад, всё ещё жив
+  ASSERT_EQUAL(first->Version(), 1u);
+  ASSERT_EQUAL(first->GetSection("july").at("food"), "0");
+  ASSERT_EQUAL(reloader.Current()->GetSection("july").at("food"), "40");
+  ASSERT_EQUAL(nested_calls, 39);
+}
+
+void TestReloaderConcurrentReaders() {
+  const string path = "test_reloader_readers.ini";
+  WriteFile(path, "[july]\nfood=0\ncopy=0\n");
+
+  Ini::Reloader reloader(path);
+  atomic<bool> done{false};
+  atomic<int> inconsistent{0};
+  vector<thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      uint64_t last_version = 0;
+      while (!done.load()) {
+        const auto snapshot = reloader.Current();
+        const Ini::Section& july = snapshot->GetSection("july");
+        // Версии не убывают, а снимок всегда целиком от одной перезагрузки
+        if (snapshot->Version() < last_version || july.at("food") != july.at("copy")) {
+          ++inconsistent;
+        }
+        last_version = snapshot->Version();
+      }
+    });
+  }
+  for (int i = 1; i <= 200; ++i) {
+    WriteFile(path, "[july]\nfood=" + to_string(i) + "\ncopy=" + to_string(i) + "\n");
+    ASSERT(reloader.Reload());
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  remove(path.c_str());
+
+  ASSERT_EQUAL(inconsistent.load(), 0);
+  ASSERT_EQUAL(reloader.Current()->Version(), 201u);
+}
+
+void BenchmarkLoad() {
+  const string path = "benchmark_load.ini";
+  {
+    ofstream output(path);
+    for (int section = 0; section < 1000; ++section) {
+      output << "[section_" << section << "]\n";
+      for (int key = 0; key < 300; ++key) {
+        output << "key_" << key << "=value_" << section * key << '\n';
+      }
+      output << '\n';
+    }
+  }
+
+  size_t loaded_count = 0;
+  {
+    LOG_DURATION("Ini::Load, 300000 keys");
+    ifstream input(path);
+    loaded_count += Ini::Load(input).SectionCount();
+  }
+  {
+    LOG_DURATION("Ini::LoadMapped, 300000 keys");
+    loaded_count += Ini::LoadMapped(path).SectionCount();
+  }
+  remove(path.c_str());
+  ASSERT_EQUAL(loaded_count, 2000u);
+}
+
+int main(int argc, char* argv[]) {
   TestRunner tr;
   RUN_TEST(tr, TestLoadIni);
   RUN_TEST(tr, TestDocument);
   RUN_TEST(tr, TestUnknownSection);
   RUN_TEST(tr, TestDuplicateSections);
+  RUN_TEST(tr, TestLoadMapped);
+  RUN_TEST(tr, TestLineWithoutEquals);
+  RUN_TEST(tr, TestReloaderDiff);
+  RUN_TEST(tr, TestReloaderPoll);
+  RUN_TEST(tr, TestReloaderMissingFile);
+  RUN_TEST(tr, TestReloaderSnapshotLifetime);
+  RUN_TEST(tr, TestReloaderConcurrentReaders);
+
+  // Замер пишет и читает файл на 300000 ключей, поэтому только по --benchmark
+  if (argc > 1 && string(argv[1]) == "--benchmark") {
+    BenchmarkLoad();
+  }
   return 0;
 }
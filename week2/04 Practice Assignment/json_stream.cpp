@@ -0,0 +1,210 @@
+#include "json_stream.h"
+
+#include <cctype>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+using namespace std;
+
+namespace Json {
+
+namespace {
+
+void AppendUtf8(uint32_t code_point, string& out) {
+  if (code_point < 0x80) {
+    out.push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+}
+
+TokenReader::TokenReader(istream& input) : input(*input.rdbuf()) {
+}
+
+Token TokenReader::Next() {
+  const int c = SkipSeparators();
+  if (c == EOF) {
+    return Token::End;
+  }
+  input.sbumpc();
+
+  switch (c) {
+    case '[':
+      scopes.push_back('[');
+      expect_key = false;
+      return Token::BeginArray;
+    case '{':
+      scopes.push_back('{');
+      expect_key = true;
+      return Token::BeginObject;
+    case ']':
+    case '}':
+      if (scopes.empty()) {
+        throw runtime_error("json: unbalanced brackets");
+      }
+      scopes.pop_back();
+      expect_key = false;
+      return c == ']' ? Token::EndArray : Token::EndObject;
+    case '"': {
+      ReadString();
+      const bool is_key = expect_key;
+      expect_key = false;
+      return is_key ? Token::Key : Token::String;
+    }
+    default:
+      input.sungetc();
+      ReadInt();
+      expect_key = false;
+      return Token::Int;
+  }
+}
+
+void TokenReader::SkipValue(Token token) {
+  for (int depth = 0; ; token = Next()) {
+    if (token == Token::BeginArray || token == Token::BeginObject) {
+      ++depth;
+    } else if (token == Token::EndArray || token == Token::EndObject) {
+      --depth;
+    } else if (token == Token::End) {
+      throw runtime_error("json: unexpected end of input");
+    }
+    if (depth == 0) {
+      return;
+    }
+  }
+}
+
+const string& TokenReader::StringValue() const {
+  return string_value;
+}
+
+int TokenReader::IntValue() const {
+  return int_value;
+}
+
+int TokenReader::SkipSeparators() {
+  int c;
+  while ((c = input.sgetc()) != EOF && (isspace(c) || c == ',' || c == ':')) {
+    if (c == ',' && !scopes.empty() && scopes.back() == '{') {
+      expect_key = true;
+    }
+    input.sbumpc();
+  }
+  return c;
+}
+
+void TokenReader::ReadString() {
+  string_value.clear();
+  for (int c; (c = input.sbumpc()) != '"'; ) {
+    if (c == EOF) {
+      throw runtime_error("json: unexpected end of string");
+    }
+    if (c != '\\') {
+      string_value.push_back(static_cast<char>(c));
+      continue;
+    }
+    switch (c = input.sbumpc()) {
+      case '"': case '\\': case '/': string_value.push_back(static_cast<char>(c)); break;
+      case 'b': string_value.push_back('\b'); break;
+      case 'f': string_value.push_back('\f'); break;
+      case 'n': string_value.push_back('\n'); break;
+      case 'r': string_value.push_back('\r'); break;
+      case 't': string_value.push_back('\t'); break;
+      case 'u': {
+        uint32_t code_point = ReadHex4();
+        // Символы вне BMP записываются суррогатной парой (RFC 8259, раздел 7)
+        if (code_point >= 0xD800 && code_point < 0xDC00) {
+          if (input.sbumpc() != '\\' || input.sbumpc() != 'u') {
+            throw runtime_error("json: unpaired surrogate in string");
+          }
+          const uint32_t low = ReadHex4();
+          if (low < 0xDC00 || low >= 0xE000) {
+            throw runtime_error("json: unpaired surrogate in string");
+          }
+          code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+        } else if (code_point >= 0xDC00 && code_point < 0xE000) {
+          throw runtime_error("json: unpaired surrogate in string");
+        }
+        AppendUtf8(code_point, string_value);
+        break;
+      }
+      case EOF: throw runtime_error("json: unexpected end of string");
+      default: throw runtime_error("json: invalid escape in string");
+    }
+  }
+}
+
+uint32_t TokenReader::ReadHex4() {
+  uint32_t result = 0;
+  for (int i = 0; i < 4; ++i) {
+    const int c = input.sbumpc();
+    if (c == EOF || !isxdigit(c)) {
+      throw runtime_error("json: invalid \\u escape in string");
+    }
+    result = result * 16 + (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+  }
+  return result;
+}
+
+void TokenReader::ReadInt() {
+  bool negative = false;
+  if (input.sgetc() == '-') {
+    negative = true;
+    input.sbumpc();
+  }
+  if (!isdigit(input.sgetc())) {
+    throw runtime_error("json: unexpected character");
+  }
+  // Копим отрицательное значение: его диапазон включает минимальный int
+  int result = 0;
+  for (int c; isdigit(c = input.sgetc()); input.sbumpc()) {
+    const int digit = c - '0';
+    if (result < (numeric_limits<int>::min() + digit) / 10) {
+      throw runtime_error("json: integer out of range");
+    }
+    result = result * 10 - digit;
+  }
+  if (!negative) {
+    if (result == numeric_limits<int>::min()) {
+      throw runtime_error("json: integer out of range");
+    }
+    result = -result;
+  }
+  int_value = result;
+}
+
+void WriteEscaped(string_view value, string& out) {
+  for (char c : value) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\t': out += "\\t"; break;
+      case '\r': out += "\\r"; break;
+      case '\b': out += "\\b"; break;
+      case '\f': out += "\\f"; break;
+      default:
+        // Остальные управляющие символы в строке JSON допустимы только как \u00XX
+        if (static_cast<unsigned char>(c) < 0x20) {
+          const char* const hex = "0123456789abcdef";
+          out.append("\\u00").append(1, hex[c >> 4]).append(1, hex[c & 0xF]);
+        } else {
+          out.push_back(c);
+        }
+    }
+  }
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Json {
+
+enum class Token {
+  BeginArray,
+  EndArray,
+  BeginObject,
+  EndObject,
+  Key,
+  String,
+  Int,
+  End,
+};
+
+// Читает JSON как последовательность токенов, не строя дерево документа.
+// Запятые и двоеточия поглощаются, строка перед двоеточием выдаётся как Key
+class TokenReader {
+public:
+  explicit TokenReader(std::istream& input);
+
+  Token Next();
+
+  // Пропускает значение, первым токеном которого был token
+  void SkipValue(Token token);
+
+  const std::string& StringValue() const;
+  int IntValue() const;
+
+private:
+  std::streambuf& input;
+  std::vector<char> scopes;
+  bool expect_key = false;
+  std::string string_value;
+  int int_value = 0;
+
+  int SkipSeparators();
+  void ReadString();
+  uint32_t ReadHex4();
+  void ReadInt();
+};
+
+void WriteEscaped(std::string_view value, std::string& out);
+
+}
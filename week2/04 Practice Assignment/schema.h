@@ -0,0 +1,229 @@
+#pragma once
+
+#include "json_stream.h"
+#include "xml_stream.h"
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Типизированная загрузка записей из JSON и XML без построения документа.
+// Поля структуры описываются один раз специализацией Schema::Fields:
+//
+//   template <>
+//   struct Schema::Fields<Spending> {
+//     static constexpr auto value = std::make_tuple(
+//       Schema::Bind("category", &Spending::category),
+//       Schema::Bind("amount", &Spending::amount)
+//     );
+//   };
+//
+// после чего LoadJsonArray<Spending> и LoadXmlChildren<Spending> заполняют
+// vector<Spending> прямо из потока токенов
+namespace Schema {
+
+template <typename Struct, typename Member>
+struct Field {
+  std::string_view name;
+  Member Struct::* member;
+};
+
+template <typename Struct, typename Member>
+constexpr Field<Struct, Member> Bind(std::string_view name, Member Struct::* member) {
+  return {name, member};
+}
+
+template <typename T>
+struct Fields;
+
+constexpr uint32_t Hash(std::string_view name, uint32_t seed) {
+  uint32_t hash = 2166136261u ^ seed;
+  for (char c : name) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  }
+  return hash ^ (hash >> 15);
+}
+
+// Совершенный хеш имён полей: seed подбирается при компиляции так,
+// чтобы все имена попали в разные ячейки таблицы
+template <typename T>
+class FieldIndex {
+  static constexpr auto& fields = Fields<T>::value;
+  static constexpr size_t field_count = std::tuple_size_v<std::decay_t<decltype(fields)>>;
+
+  static constexpr size_t TableSize() {
+    size_t size = 1;
+    while (size < 2 * field_count) {
+      size *= 2;
+    }
+    return size;
+  }
+
+  static constexpr size_t table_size = TableSize();
+
+  template <size_t... I>
+  static constexpr std::array<std::string_view, field_count> Names(std::index_sequence<I...>) {
+    return {std::get<I>(fields).name...};
+  }
+
+  static constexpr std::array<std::string_view, field_count> names =
+      Names(std::make_index_sequence<field_count>());
+
+  static constexpr bool IsPerfect(uint32_t seed) {
+    std::array<bool, table_size> used{};
+    for (std::string_view name : names) {
+      const size_t slot = Hash(name, seed) & (table_size - 1);
+      if (used[slot]) {
+        return false;
+      }
+      used[slot] = true;
+    }
+    return true;
+  }
+
+  static constexpr uint32_t FindSeed() {
+    uint32_t seed = 0;
+    while (!IsPerfect(seed)) {
+      ++seed;
+    }
+    return seed;
+  }
+
+  static constexpr uint32_t seed = FindSeed();
+
+  static constexpr std::array<int8_t, table_size> BuildSlots() {
+    std::array<int8_t, table_size> slots{};
+    for (auto& slot : slots) {
+      slot = -1;
+    }
+    for (size_t i = 0; i < field_count; ++i) {
+      slots[Hash(names[i], seed) & (table_size - 1)] = static_cast<int8_t>(i);
+    }
+    return slots;
+  }
+
+  static constexpr std::array<int8_t, table_size> slots = BuildSlots();
+
+public:
+  static_assert(field_count < 128, "too many fields for int8_t slots");
+
+  // Номер поля с именем name или -1
+  static constexpr int Find(std::string_view name) {
+    const int index = slots[Hash(name, seed) & (table_size - 1)];
+    return index >= 0 && names[index] == name ? index : -1;
+  }
+
+  // Вызывает visitor(field) для поля с номером index
+  template <typename Visitor>
+  static void Visit(int index, Visitor&& visitor) {
+    VisitImpl(index, visitor, std::make_index_sequence<field_count>());
+  }
+
+private:
+  template <typename Visitor, size_t... I>
+  static void VisitImpl(int index, Visitor& visitor, std::index_sequence<I...>) {
+    ((index == static_cast<int>(I) ? (visitor(std::get<I>(fields)), true) : false) || ...);
+  }
+};
+
+// Текст атрибута в поле field_name. Число должно занимать весь текст и
+// помещаться в тип поля, иначе invalid_argument
+template <typename Member>
+void AssignText(Member& member, std::string_view text, std::string_view field_name) {
+  if constexpr (std::is_same_v<Member, std::string>) {
+    member.assign(text);
+  } else if constexpr (std::is_arithmetic_v<Member> && !std::is_same_v<Member, bool>) {
+    const char* end = text.data() + text.size();
+    const auto [ptr, error] = std::from_chars(text.data(), end, member);
+    if (error != std::errc() || ptr != end) {
+      throw std::invalid_argument(
+        "xml: bad number for " + std::string(field_name) + ": \"" + std::string(text) + "\"");
+    }
+  } else {
+    static_assert(std::is_same_v<Member, std::string>, "unsupported field type");
+  }
+}
+
+// Читает массив объектов [{"name": value, ...}, ...]. Неизвестные ключи пропускаются
+template <typename T>
+std::vector<T> LoadJsonArray(std::istream& input) {
+  Json::TokenReader reader(input);
+  if (reader.Next() != Json::Token::BeginArray) {
+    throw std::invalid_argument("json: array expected");
+  }
+
+  std::vector<T> result;
+  for (Json::Token token; (token = reader.Next()) != Json::Token::EndArray; ) {
+    if (token != Json::Token::BeginObject) {
+      throw std::invalid_argument("json: object expected");
+    }
+    T& item = result.emplace_back();
+    while ((token = reader.Next()) == Json::Token::Key) {
+      const int index = FieldIndex<T>::Find(reader.StringValue());
+      token = reader.Next();
+      if (index < 0) {
+        reader.SkipValue(token);
+        continue;
+      }
+      FieldIndex<T>::Visit(index, [&](const auto& field) {
+        auto& member = item.*field.member;
+        using Member = std::decay_t<decltype(member)>;
+        if constexpr (std::is_same_v<Member, std::string>) {
+          if (token != Json::Token::String) {
+            throw std::invalid_argument("json: string expected for " + std::string(field.name));
+          }
+          member = reader.StringValue();
+        } else {
+          if (token != Json::Token::Int) {
+            throw std::invalid_argument("json: number expected for " + std::string(field.name));
+          }
+          member = static_cast<Member>(reader.IntValue());
+        }
+      });
+    }
+    if (token != Json::Token::EndObject) {
+      throw std::invalid_argument("json: unterminated object");
+    }
+  }
+  return result;
+}
+
+// Читает дочерние элементы корня, заполняя поля из одноимённых атрибутов
+template <typename T>
+std::vector<T> LoadXmlChildren(std::istream& input) {
+  Xml::EventReader reader(input);
+  Xml::Event event;
+  std::vector<T> result;
+  int depth = 0;
+
+  while (reader.Next(event)) {
+    if (event.type == Xml::Event::Type::EndElement) {
+      --depth;
+      continue;
+    }
+    if (++depth != 2) {
+      continue;
+    }
+    T& item = result.emplace_back();
+    for (size_t i = 0; i < event.attr_count; ++i) {
+      const auto& [name, value] = event.attrs[i];
+      if (const int index = FieldIndex<T>::Find(name); index >= 0) {
+        FieldIndex<T>::Visit(index, [&item, &value = value](const auto& field) {
+          AssignText(item.*field.member, value, field.name);
+        });
+      }
+    }
+  }
+  return result;
+}
+
+}
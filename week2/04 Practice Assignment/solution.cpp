@@ -1,11 +1,17 @@
 #include "xml.h"
 #include "json.h"
+#include "json_stream.h"
+#include "schema.h"
+#include "transcoder.h"
 
+#include "profile.h"
 #include "test_runner.h"
 
+#include <limits>
 #include <vector>
 #include <string>
 #include <map>
+#include <streambuf>
 
 Json::Document XmlToJson(const Xml::Document& doc) {
  using namespace std;
@@ -33,6 +39,27 @@ Xml::Document JsonToXml(const Json::Document& doc, std::string root_name) {
  return Xml::Document(std::move(root));
 }
 
+struct Spending {
+  std::string category;
+  int amount;
+};
+
+bool operator==(const Spending& lhs, const Spending& rhs) {
+  return lhs.category == rhs.category && lhs.amount == rhs.amount;
+}
+
+std::ostream& operator<<(std::ostream& os, const Spending& s) {
+  return os << '(' << s.category << ": " << s.amount << ')';
+}
+
+template <>
+struct Schema::Fields<Spending> {
+  static constexpr auto value = std::make_tuple(
+    Schema::Bind("category", &Spending::category),
+    Schema::Bind("amount", &Spending::amount)
+  );
+};
+
 void TestXmlToJson() {
  using std::string;
  using std::vector;
@@ -114,10 +141,285 @@ void TestJsonToXml() {
  }
 }
 
-int main() {
+void TestTranscodeXmlToJson() {
+  using namespace std;
+
+  const string xml = R"(<july>
+<spend amount="23400" category="travel"></spend>
+<spend amount="5000" category="food &amp; &quot;drinks&quot;"></spend>
+<spend category="transport" amount="1150"/>
+</july>
+)";
+  istringstream input(xml);
+  ostringstream output;
+  TranscodeXmlToJson(input, output);
+
+  ASSERT_EQUAL(output.str(), "[{\"amount\": 23400, \"category\": \"travel\"}, "
+                             "{\"amount\": 5000, \"category\": \"food & \\\"drinks\\\"\"}, "
+                             "{\"amount\": 1150, \"category\": \"transport\"}]");
+
+  // Дети корня с любым именем преобразуются так же, как в XmlToJson
+  istringstream mixed_input(R"(<july><spend amount="1" category="a"/><refund amount="-2" category="b"/></july>)");
+  ostringstream mixed_output;
+  TranscodeXmlToJson(mixed_input, mixed_output);
+  ASSERT_EQUAL(mixed_output.str(), "[{\"amount\": 1, \"category\": \"a\"}, "
+                                   "{\"amount\": -2, \"category\": \"b\"}]");
+
+  istringstream empty_input("<july>\n</july>\n");
+  ostringstream empty_output;
+  TranscodeXmlToJson(empty_input, empty_output);
+  ASSERT_EQUAL(empty_output.str(), "[]");
+
+  // Сумма должна быть целым числом целиком и помещаться в int
+  for (const char* amount : {"", "12x", "1.5", "99999999999"}) {
+    istringstream bad_input(string("<july><spend amount=\"") + amount + "\" category=\"a\"/></july>");
+    ostringstream bad_output;
+    try {
+      TranscodeXmlToJson(bad_input, bad_output);
+      Assert(false, string("amount \"") + amount + "\" should be rejected");
+    } catch (const invalid_argument&) {
+    }
+  }
+}
+
+void TestTranscodeJsonToXml() {
+  using namespace std;
+
+  const string json = R"([{"category": "food", "amount": 2500}, {"amount": 1150, "note": [1, {"x": 2}], "category": "transport"}])";
+  istringstream input(json);
+  ostringstream output;
+  TranscodeJsonToXml(input, output, "month");
+
+  ASSERT_EQUAL(output.str(), "<month>\n"
+                             "<spend amount=\"2500\" category=\"food\"></spend>\n"
+                             "<spend amount=\"1150\" category=\"transport\"></spend>\n"
+                             "</month>\n");
+
+  // Результат читается библиотекой и совпадает с преобразованием через документы
+  istringstream xml_input(output.str());
+  const Xml::Document streamed = Xml::Load(xml_input);
+  istringstream json_input(json);
+  const Xml::Document expected = JsonToXml(Json::Load(json_input), "month");
+
+  ASSERT_EQUAL(streamed.GetRoot().Name(), expected.GetRoot().Name());
+  ASSERT_EQUAL(streamed.GetRoot().Children().size(), expected.GetRoot().Children().size());
+  for (size_t i = 0; i < expected.GetRoot().Children().size(); ++i) {
+    const auto& lhs = streamed.GetRoot().Children()[i];
+    const auto& rhs = expected.GetRoot().Children()[i];
+    ASSERT_EQUAL(lhs.AttributeValue<string>("category"), rhs.AttributeValue<string>("category"));
+    ASSERT_EQUAL(lhs.AttributeValue<int>("amount"), rhs.AttributeValue<int>("amount"));
+  }
+}
+
+void TestTokenReader() {
+  using namespace std;
+
+  istringstream input(R"({"s": "q\"\\\/\b\f\n\r\t\u0041\u00e9\u20ac\ud83d\ude00", "n": [-2147483648, 2147483647]})");
+  Json::TokenReader reader(input);
+  ASSERT(reader.Next() == Json::Token::BeginObject);
+  ASSERT(reader.Next() == Json::Token::Key);
+  ASSERT(reader.Next() == Json::Token::String);
+  ASSERT_EQUAL(reader.StringValue(), "q\"\\/\b\f\n\r\tA\u00e9\u20ac\U0001F600");
+  ASSERT(reader.Next() == Json::Token::Key);
+  ASSERT(reader.Next() == Json::Token::BeginArray);
+  ASSERT(reader.Next() == Json::Token::Int);
+  ASSERT_EQUAL(reader.IntValue(), numeric_limits<int>::min());
+  ASSERT(reader.Next() == Json::Token::Int);
+  ASSERT_EQUAL(reader.IntValue(), numeric_limits<int>::max());
+
+  string escaped;
+  Json::WriteEscaped("\b\f\x01", escaped);
+  ASSERT_EQUAL(escaped, "\\b\\f\\u0001");
+
+  for (const string bad : {"2147483648", "-2147483649", "99999999999999999999", R"("\ud83d")", R"("\x")", R"("\u12")"}) {
+    istringstream bad_input(bad);
+    Json::TokenReader bad_reader(bad_input);
+    bool thrown = false;
+    try {
+      bad_reader.Next();
+    } catch (runtime_error&) {
+      thrown = true;
+    }
+    Assert(thrown, "TokenReader should reject " + bad);
+  }
+}
+
+// Источник XML с расходами заданного размера, который генерируется на лету,
+// чтобы измерять гигабайтные входы, не держа их в памяти
+class SpendingsXmlSource : public std::streambuf {
+public:
+  explicit SpendingsXmlSource(size_t byte_limit) : byte_limit(byte_limit) {
+  }
+
+protected:
+  int_type underflow() override {
+    if (finished) {
+      return traits_type::eof();
+    }
+
+    buffer.assign(produced == 0 ? "<month>\n" : "");
+    while (buffer.size() < 64 * 1024 && produced + buffer.size() < byte_limit) {
+      buffer += "<spend amount=\"";
+      buffer += std::to_string(record_index * 7919 % 100000);
+      buffer += "\" category=\"category_";
+      buffer += std::to_string(record_index % 100);
+      buffer += "\"></spend>\n";
+      ++record_index;
+    }
+    if (produced + buffer.size() >= byte_limit) {
+      buffer += "</month>\n";
+      finished = true;
+    }
+    produced += buffer.size();
+    setg(buffer.data(), buffer.data(), buffer.data() + buffer.size());
+    return traits_type::to_int_type(*gptr());
+  }
+
+private:
+  size_t byte_limit;
+  size_t produced = 0;
+  size_t record_index = 0;
+  bool finished = false;
+  std::string buffer;
+};
+
+class CountingSink : public std::streambuf {
+public:
+  size_t Count() const {
+    return count;
+  }
+
+protected:
+  std::streamsize xsputn(const char*, std::streamsize n) override {
+    count += n;
+    return n;
+  }
+
+  int_type overflow(int_type c) override {
+    ++count;
+    return c;
+  }
+
+private:
+  size_t count = 0;
+};
+
+std::vector<Spending> SpendingsFromJson(const Json::Document& doc) {
+  std::vector<Spending> result;
+  for (const Json::Node& n : doc.GetRoot().AsArray()) {
+    result.push_back({n.AsMap().at("category").AsString(), n.AsMap().at("amount").AsInt()});
+  }
+  return result;
+}
+
+void BenchmarkSchemaLoad(size_t megabytes) {
+  using namespace std;
+
+  vector<Spending> typed;
+  {
+    LOG_DURATION("Schema::LoadXmlChildren<Spending>, " + to_string(megabytes) + " MB");
+    SpendingsXmlSource source(megabytes << 20);
+    istream input(&source);
+    typed = Schema::LoadXmlChildren<Spending>(input);
+  }
+
+  vector<Spending> through_documents;
+  {
+    LOG_DURATION("Xml::Load + XmlToJson + AsMap, " + to_string(megabytes) + " MB");
+    SpendingsXmlSource source(megabytes << 20);
+    istream input(&source);
+    through_documents = SpendingsFromJson(XmlToJson(Xml::Load(input)));
+  }
+
+  ASSERT_EQUAL(typed.size(), through_documents.size());
+  ASSERT(typed == through_documents);
+}
+
+// Для замера на гигабайтных входах запустите ./solution --benchmark 1024:
+// потоковому преобразованию это не прибавит памяти
+void BenchmarkTranscoder(size_t megabytes) {
+  using namespace std;
+
+  size_t streamed_bytes = 0;
+  {
+    LOG_DURATION("TranscodeXmlToJson, " + to_string(megabytes) + " MB");
+    SpendingsXmlSource source(megabytes << 20);
+    istream input(&source);
+    CountingSink sink;
+    ostream output(&sink);
+    TranscodeXmlToJson(input, output);
+    streamed_bytes = sink.Count();
+  }
+
+  size_t document_items = 0;
+  {
+    LOG_DURATION("Xml::Load + XmlToJson, " + to_string(megabytes) + " MB");
+    SpendingsXmlSource source(megabytes << 20);
+    istream input(&source);
+    document_items = XmlToJson(Xml::Load(input)).GetRoot().AsArray().size();
+  }
+
+  ASSERT(streamed_bytes > 0);
+  ASSERT(document_items > 0);
+}
+
+void TestSchemaFieldIndex() {
+  using Index = Schema::FieldIndex<Spending>;
+  static_assert(Index::Find("category") == 0);
+  static_assert(Index::Find("amount") == 1);
+  static_assert(Index::Find("amounts") == -1);
+  ASSERT_EQUAL(Index::Find(std::string("amount")), 1);
+  ASSERT_EQUAL(Index::Find(""), -1);
+}
+
+void TestSchemaLoadJson() {
+  using namespace std;
+
+  istringstream input(R"([
+    {"category": "food", "amount": 2500},
+    {"note": {"tags": ["a", "b"]}, "amount": 1150, "category": "transport"},
+    {"amount": -30}
+  ])");
+  const vector<Spending> expected = {{"food", 2500}, {"transport", 1150}, {"", -30}};
+  ASSERT_EQUAL(Schema::LoadJsonArray<Spending>(input), expected);
+}
+
+void TestSchemaLoadXml() {
+  using namespace std;
+
+  istringstream input(R"(<july>
+<spend amount="2500" category="food"></spend>
+<spend category="transport" amount="1150" note="ignored"/>
+</july>)");
+  const vector<Spending> expected = {{"food", 2500}, {"transport", 1150}};
+  ASSERT_EQUAL(Schema::LoadXmlChildren<Spending>(input), expected);
+
+  istringstream bad_input(R"(<july><spend amount="25x" category="food"/></july>)");
+  try {
+    Schema::LoadXmlChildren<Spending>(bad_input);
+    Assert(false, "amount=\"25x\" should be rejected");
+  } catch (const invalid_argument& e) {
+    ASSERT(string(e.what()).find("amount") != string::npos);
+  }
+}
+
+int main(int argc, char* argv[]) {
   TestRunner tr;
   RUN_TEST(tr, TestXmlToJson);
   RUN_TEST(tr, TestJsonToXml);
+  RUN_TEST(tr, TestTranscodeXmlToJson);
+  RUN_TEST(tr, TestTranscodeJsonToXml);
+  RUN_TEST(tr, TestTokenReader);
+  RUN_TEST(tr, TestSchemaFieldIndex);
+  RUN_TEST(tr, TestSchemaLoadJson);
+  RUN_TEST(tr, TestSchemaLoadXml);
+
+  // Замеры только по ./solution --benchmark [MB], по умолчанию на 16 MB
+  if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+    const size_t megabytes = argc > 2 ? std::stoul(argv[2]) : 16;
+    BenchmarkTranscoder(megabytes);
+    BenchmarkSchemaLoad(megabytes);
+  }
   return 0;
 }
 
@@ -0,0 +1,114 @@
+#include "transcoder.h"
+
+#include "json_stream.h"
+#include "xml_stream.h"
+
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+using namespace std;
+
+namespace {
+
+void AppendInt(int value, string& out) {
+  char buffer[16];
+  out.append(buffer, to_chars(begin(buffer), end(buffer), value).ptr);
+}
+
+}
+
+void TranscodeXmlToJson(istream& input, ostream& output) {
+  Xml::EventReader reader(input);
+  Xml::Event event;
+  string record;
+  int depth = 0;
+  bool first = true;
+
+  output.put('[');
+  while (reader.Next(event)) {
+    if (event.type == Xml::Event::Type::EndElement) {
+      --depth;
+      continue;
+    }
+    // Как и XmlToJson, преобразуем всех детей корня, независимо от имени
+    if (++depth != 2) {
+      continue;
+    }
+
+    const string* amount = event.Attribute("amount");
+    const string* category = event.Attribute("category");
+    if (amount == nullptr || category == nullptr) {
+      throw invalid_argument("xml: spend without amount or category");
+    }
+    int amount_value = 0;
+    const char* amount_end = amount->data() + amount->size();
+    const auto [amount_ptr, amount_error] = from_chars(amount->data(), amount_end, amount_value);
+    if (amount_error != errc() || amount_ptr != amount_end) {
+      throw invalid_argument("xml: amount is not an integer: " + *amount);
+    }
+
+    record.clear();
+    if (!first) {
+      record += ", ";
+    }
+    first = false;
+    record += "{\"amount\": ";
+    AppendInt(amount_value, record);
+    record += ", \"category\": \"";
+    Json::WriteEscaped(*category, record);
+    record += "\"}";
+    output.write(record.data(), record.size());
+  }
+  output.put(']');
+}
+
+void TranscodeJsonToXml(istream& input, ostream& output, string_view root_name) {
+  Json::TokenReader reader(input);
+  string record;
+  string category;
+
+  record.append("<").append(root_name).append(">\n");
+  output.write(record.data(), record.size());
+
+  if (reader.Next() != Json::Token::BeginArray) {
+    throw invalid_argument("json: array of spendings expected");
+  }
+  for (Json::Token token; (token = reader.Next()) != Json::Token::EndArray; ) {
+    if (token != Json::Token::BeginObject) {
+      throw invalid_argument("json: spending object expected");
+    }
+
+    int amount = 0;
+    category.clear();
+    while ((token = reader.Next()) == Json::Token::Key) {
+      const string& key = reader.StringValue();
+      if (key == "category") {
+        if (reader.Next() != Json::Token::String) {
+          throw invalid_argument("json: category must be a string");
+        }
+        category = reader.StringValue();
+      } else if (key == "amount") {
+        if (reader.Next() != Json::Token::Int) {
+          throw invalid_argument("json: amount must be an integer");
+        }
+        amount = reader.IntValue();
+      } else {
+        reader.SkipValue(reader.Next());
+      }
+    }
+    if (token != Json::Token::EndObject) {
+      throw invalid_argument("json: unterminated spending object");
+    }
+
+    record.assign("<spend amount=\"");
+    AppendInt(amount, record);
+    record += "\" category=\"";
+    Xml::WriteEscaped(category, record);
+    record += "\"></spend>\n";
+    output.write(record.data(), record.size());
+  }
+
+  record.assign("</").append(root_name).append(">\n");
+  output.write(record.data(), record.size());
+}
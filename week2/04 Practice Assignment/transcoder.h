@@ -0,0 +1,11 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string_view>
+
+// Потоковые версии XmlToJson и JsonToXml: читают события исходного формата
+// и сразу пишут результат, не строя ни исходный, ни итоговый документ.
+// Память не зависит от размера входа
+void TranscodeXmlToJson(std::istream& input, std::ostream& output);
+void TranscodeJsonToXml(std::istream& input, std::ostream& output, std::string_view root_name);
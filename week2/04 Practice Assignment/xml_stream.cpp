@@ -0,0 +1,164 @@
+#include "xml_stream.h"
+
+#include <cctype>
+#include <stdexcept>
+using namespace std;
+
+namespace Xml {
+
+namespace {
+
+bool IsNameChar(int c) {
+  return c != EOF && !isspace(c) && c != '=' && c != '>' && c != '/' && c != '<';
+}
+
+}
+
+const string* Event::Attribute(string_view attr_name) const {
+  for (size_t i = 0; i < attr_count; ++i) {
+    if (attrs[i].first == attr_name) {
+      return &attrs[i].second;
+    }
+  }
+  return nullptr;
+}
+
+EventReader::EventReader(istream& input) : input(*input.rdbuf()) {
+}
+
+bool EventReader::Next(Event& event) {
+  if (pending_end) {
+    pending_end = false;
+    event.type = Event::Type::EndElement;
+    event.attr_count = 0;
+    return true;
+  }
+
+  while (true) {
+    int c;
+    while ((c = input.sbumpc()) != EOF && c != '<') {
+    }
+    if (c == EOF) {
+      return false;
+    }
+
+    c = input.sgetc();
+    if (c == '!') {
+      input.sbumpc();
+      SkipPast(input.sgetc() == '-' ? "-->" : ">");
+      continue;
+    } else if (c == '?') {
+      SkipPast(">");
+      continue;
+    }
+
+    event.attr_count = 0;
+    if (c == '/') {
+      input.sbumpc();
+      event.type = Event::Type::EndElement;
+      ReadName(event.name);
+      SkipPast(">");
+      return true;
+    }
+
+    event.type = Event::Type::StartElement;
+    ReadName(event.name);
+    while (true) {
+      c = SkipSpaces();
+      if (c == EOF) {
+        throw runtime_error("xml: unexpected end of input");
+      } else if (c == '>') {
+        input.sbumpc();
+        return true;
+      } else if (c == '/') {
+        SkipPast(">");
+        pending_end = true;
+        return true;
+      }
+
+      if (event.attr_count == event.attrs.size()) {
+        event.attrs.emplace_back();
+      }
+      auto& [attr_name, value] = event.attrs[event.attr_count++];
+      ReadName(attr_name);
+      value.clear();
+      if (SkipSpaces() == '=') {
+        input.sbumpc();
+        SkipSpaces();
+        ReadValue(value);
+      }
+    }
+  }
+}
+
+int EventReader::SkipSpaces() {
+  int c;
+  while ((c = input.sgetc()) != EOF && isspace(c)) {
+    input.sbumpc();
+  }
+  return c;
+}
+
+void EventReader::ReadName(string& name) {
+  name.clear();
+  for (int c; IsNameChar(c = input.sgetc()); input.sbumpc()) {
+    name.push_back(static_cast<char>(c));
+  }
+}
+
+void EventReader::ReadValue(string& value) {
+  const int quote = input.sgetc();
+  if (quote != '"' && quote != '\'') {
+    ReadName(value);
+    return;
+  }
+  input.sbumpc();
+
+  for (int c; (c = input.sbumpc()) != EOF && c != quote; ) {
+    if (c != '&') {
+      value.push_back(static_cast<char>(c));
+      continue;
+    }
+    string entity;
+    while ((c = input.sbumpc()) != EOF && c != ';' && entity.size() < 8) {
+      entity.push_back(static_cast<char>(c));
+    }
+    if (entity == "lt") {
+      value.push_back('<');
+    } else if (entity == "gt") {
+      value.push_back('>');
+    } else if (entity == "amp") {
+      value.push_back('&');
+    } else if (entity == "quot") {
+      value.push_back('"');
+    } else if (entity == "apos") {
+      value.push_back('\'');
+    } else {
+      value.append("&").append(entity).append(";");
+    }
+  }
+}
+
+void EventReader::SkipPast(string_view marker) {
+  string tail;
+  for (int c; tail != marker && (c = input.sbumpc()) != EOF; ) {
+    tail.push_back(static_cast<char>(c));
+    if (tail.size() > marker.size()) {
+      tail.erase(tail.begin());
+    }
+  }
+}
+
+void WriteEscaped(string_view value, string& out) {
+  for (char c : value) {
+    switch (c) {
+      case '<': out += "&lt;"; break;
+      case '>': out += "&gt;"; break;
+      case '&': out += "&amp;"; break;
+      case '"': out += "&quot;"; break;
+      default: out.push_back(c);
+    }
+  }
+}
+
+}
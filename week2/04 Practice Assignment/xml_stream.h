@@ -0,0 +1,47 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Xml {
+
+// Событие потокового разбора. Буферы строк переиспользуются между
+// вызовами EventReader::Next, поэтому память не растёт с размером входа
+struct Event {
+  enum class Type {
+    StartElement,
+    EndElement,
+  };
+
+  Type type;
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> attrs;
+  size_t attr_count = 0;
+
+  const std::string* Attribute(std::string_view attr_name) const;
+};
+
+// Читает XML как последовательность открывающих и закрывающих тегов,
+// не строя дерево документа. Текст, комментарии и объявления пропускаются
+class EventReader {
+public:
+  explicit EventReader(std::istream& input);
+
+  bool Next(Event& event);
+
+private:
+  std::streambuf& input;
+  bool pending_end = false;
+
+  int SkipSpaces();
+  void ReadName(std::string& name);
+  void ReadValue(std::string& value);
+  void SkipPast(std::string_view marker);
+};
+
+void WriteEscaped(std::string_view value, std::string& out);
+
+}
@@ -0,0 +1,98 @@
+#include "int_reader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+  // Пробел, перевод строки, табуляция и терминатор одним сравнением
+  bool IsSeparator(char c) {
+    return static_cast<unsigned char>(c) <= ' ';
+  }
+
+  unsigned Digit(char c) {
+    return static_cast<unsigned char>(c) - static_cast<unsigned>('0');
+  }
+
+}
+
+IntReader::IntReader(std::streambuf& input, size_t block_size)
+    : input(input)
+    // Блок должен вмещать любую корректную запись числа целиком
+    , block_size(max<size_t>(block_size, 32))
+    , buffer(this->block_size + 1) {
+}
+
+size_t IntReader::Read(std::span<int> out) {
+  size_t count = 0;
+  while (count < out.size()) {
+    if (begin == limit && !Refill()) {
+      break;
+    }
+
+    const char* p = buffer.data() + begin;
+    const char* const stop = buffer.data() + limit;
+    while (count < out.size()) {
+      while (p < stop && IsSeparator(*p)) {
+        ++p;
+      }
+      if (p == stop) {
+        break;
+      }
+
+      const bool negative = *p == '-';
+      p += negative || *p == '+';
+      const char* const digits = p;
+      // Число заканчивается разделителем или терминатором, поэтому цикл
+      // по цифрам не нуждается в проверке границы
+      uint64_t value = 0;
+      for (unsigned digit; (digit = Digit(*p)) <= 9; ++p) {
+        value = value * 10 + digit;
+      }
+      if (p == digits || !IsSeparator(*p)) {
+        throw invalid_argument("IntReader: unexpected character");
+      }
+      if (p - digits > 19 || value > static_cast<uint64_t>(numeric_limits<int>::max()) + negative) {
+        throw out_of_range("IntReader: value does not fit into int");
+      }
+      out[count++] = static_cast<int>(negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value));
+    }
+    begin = p - buffer.data();
+  }
+  return count;
+}
+
+bool IntReader::Refill() {
+  // Недочитанный хвост блока - начало числа, переносим его в начало буфера
+  memmove(buffer.data(), buffer.data() + begin, end - begin);
+  end -= begin;
+  begin = 0;
+
+  while (!eof) {
+    const auto got = input.sgetn(buffer.data() + end, static_cast<streamsize>(block_size - end));
+    end += static_cast<size_t>(got);
+    eof = got == 0;
+    if (eof) {
+      break;
+    }
+    limit = end;
+    while (limit > 0 && !IsSeparator(buffer[limit - 1])) {
+      --limit;
+    }
+    if (limit > 0) {
+      return true;
+    }
+    if (end == block_size) {
+      throw out_of_range("IntReader: token longer than block");
+    }
+  }
+
+  buffer[end] = '\0';
+  limit = end;
+  return begin < end;
+}
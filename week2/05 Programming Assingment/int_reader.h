@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <streambuf>
+#include <vector>
+
+// Быстрое чтение целых чисел, разделённых пробельными символами.
+// Вход читается блоками через streambuf::sgetn, поэтому чтение продолжается
+// ровно с того места, где остановился istream, работавший с тем же буфером.
+// Некорректный ввод приводит к исключению, а не к молчаливой остановке
+class IntReader {
+public:
+    // block_size меньше 32 байт увеличивается до 32
+    explicit IntReader(std::streambuf &input, size_t block_size = 1 << 16);
+
+    // Заполняет out очередными числами и возвращает их количество.
+    // Меньше out.size() возвращается только в конце ввода
+    size_t Read(std::span<int> out);
+
+private:
+    std::streambuf &input;
+    size_t block_size;
+    // Блок и байт-терминатор за ним
+    std::vector<char> buffer;
+    // Неразобранные байты [begin, end); до limit лежат только целые числа
+    size_t begin = 0;
+    size_t limit = 0;
+    size_t end = 0;
+    bool eof = false;
+
+    // Подкачивает следующий блок; false, если разбирать больше нечего
+    bool Refill();
+};
+
+void TestIntReader();
@@ -0,0 +1,73 @@
+#include "int_reader.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Сравнение IntReader с operator>> на файле заданного размера:
+//   g++ -std=c++20 -O2 int_reader.cpp int_reader_benchmark.cpp
+//   ./a.out 10240 /tmp/ints.txt   # 10 ГБ
+// Файл создаётся, если его ещё нет
+int main(int argc, char* argv[]) {
+  const uint64_t size_mb = argc > 1 ? stoull(argv[1]) : 256;
+  const string path = argc > 2 ? argv[2] : "/tmp/int_reader_benchmark.txt";
+
+  if (!ifstream(path)) {
+    ofstream output(path, ios::binary);
+    mt19937 gen(1);
+    uniform_int_distribution<int> dist(-1000000000, 1000000000);
+    string block;
+    for (uint64_t written = 0; written < size_mb << 20; written += block.size()) {
+      block.clear();
+      while (block.size() < (1 << 20)) {
+        block += to_string(dist(gen));
+        block += ' ';
+      }
+      output << block;
+    }
+  }
+
+  const double megabytes = static_cast<double>(ifstream(path, ios::binary | ios::ate).tellg()) / (1 << 20);
+
+  auto measure = [&path, megabytes](const string& name, auto read_all) {
+    ifstream input(path, ios::binary);
+    const auto start = chrono::steady_clock::now();
+    const auto [count, checksum] = read_all(input);
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    cout << setw(12) << name << ": " << count << " values, checksum " << checksum << ", "
+         << fixed << setprecision(2) << elapsed.count() << " s, "
+         << megabytes / elapsed.count() << " MB/s" << endl;
+  };
+
+  measure("operator>>", [](istream& input) {
+    uint64_t count = 0;
+    int64_t checksum = 0;
+    for (int value; input >> value; ) {
+      ++count;
+      checksum += value;
+    }
+    return pair(count, checksum);
+  });
+
+  measure("IntReader", [](istream& input) {
+    IntReader reader(*input.rdbuf());
+    vector<int> batch(4096);
+    uint64_t count = 0;
+    int64_t checksum = 0;
+    while (size_t read = reader.Read(batch)) {
+      count += read;
+      for (size_t i = 0; i < read; ++i) {
+        checksum += batch[i];
+      }
+    }
+    return pair(count, checksum);
+  });
+
+  return 0;
+}
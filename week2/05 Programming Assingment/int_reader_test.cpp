@@ -0,0 +1,67 @@
+#include "int_reader.h"
+#include "test_runner.h"
+
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+vector<int> ReadAll(const string &text, size_t block_size, size_t batch_size) {
+    istringstream input(text);
+    IntReader reader(*input.rdbuf(), block_size);
+    vector<int> result;
+    vector<int> batch(batch_size);
+    while (size_t count = reader.Read(batch)) {
+        result.insert(result.end(), batch.begin(), batch.begin() + count);
+    }
+    return result;
+}
+
+template <typename Exception>
+bool Throws(const string &text, size_t block_size = 64) {
+    try {
+        ReadAll(text, block_size, 16);
+    } catch (const Exception &) {
+        return true;
+    }
+    return false;
+}
+
+void TestIntReader() {
+    const string text = "  12 -7\n+3\t0 2147483647 -2147483648\r\n 0042 -0000000000000000005 8";
+    const vector<int> expected = {12, -7, 3, 0, numeric_limits<int>::max(), numeric_limits<int>::min(), 42, -5, 8};
+
+    // Маленькие блоки и пачки проверяют числа на границах блоков
+    for (size_t block_size : {1, 32, 33, 40, 1 << 16}) {
+        for (size_t batch_size : {1, 3, 100}) {
+            AssertEqual(
+                    ReadAll(text, block_size, batch_size), expected,
+                    "block=" + to_string(block_size) + " batch=" + to_string(batch_size)
+            );
+        }
+    }
+    ASSERT_EQUAL(ReadAll("", 32, 4), vector<int>());
+    ASSERT_EQUAL(ReadAll(" \n ", 32, 4), vector<int>());
+    ASSERT_EQUAL(ReadAll("5", 32, 4), vector<int>({5}));
+
+    // Чтение продолжается с места, где остановился istream
+    istringstream input("3 sum min max 1 2 3");
+    int count;
+    string name;
+    input >> count >> name >> name >> name;
+    IntReader reader(*input.rdbuf(), 4);
+    vector<int> batch(8);
+    batch.resize(reader.Read(batch));
+    ASSERT_EQUAL(batch, vector<int>({1, 2, 3}));
+
+    ASSERT(Throws<out_of_range>("2147483648"));
+    ASSERT(Throws<out_of_range>("-2147483649"));
+    ASSERT(Throws<out_of_range>("99999999999999999999999"));
+    ASSERT(Throws<out_of_range>("1 " + string(40, '1'), 32));
+    ASSERT(Throws<invalid_argument>("1 2x 3"));
+    ASSERT(Throws<invalid_argument>("1 - 3"));
+    ASSERT(Throws<invalid_argument>("1,2"));
+}
@@ -1,8 +1,22 @@
 #include "test_runner.h"
+#include "int_reader.h"
 #include "stats_aggregator.h"
+#include "stats_sketches.h"
+#include "stats_windows.h"
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <random>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <thread>
+#include <vector>
 #include <iostream>
 #include <unordered_map>
 #include <functional>
@@ -10,16 +24,33 @@ using namespace std;
 
 void TestAll();
 
-unique_ptr<StatsAggregator> ReadAggregators(istream& input) {
-  const unordered_map<string, std::function<unique_ptr<StatsAggregator>()>> known_builders = {
+using AggregatorFactory = function<unique_ptr<StatsAggregator>()>;
+
+// Читает список агрегаторов и возвращает фабрику их композиции: параллельному
+// режиму нужен отдельный экземпляр на каждый кусок потока
+AggregatorFactory ReadAggregators(istream& input) {
+  const unordered_map<string, AggregatorFactory> known_builders = {
     {"sum", [] { return make_unique<StatsAggregators::Sum>(); }},
     {"min", [] { return make_unique<StatsAggregators::Min>(); }},
     {"max", [] { return make_unique<StatsAggregators::Max>(); }},
     {"avg", [] { return make_unique<StatsAggregators::Average>(); }},
-    {"mode", [] { return make_unique<StatsAggregators::Mode>(); }}
+    {"mode", [] { return make_unique<StatsAggregators::Mode>(); }},
+    {"median", [] { return make_unique<StatsAggregators::Quantile>(0.5, "Median"); }},
+    {"p90", [] { return make_unique<StatsAggregators::Quantile>(0.9, "P90"); }},
+    {"p99", [] { return make_unique<StatsAggregators::Quantile>(0.99, "P99"); }},
+    {"distinct", [] { return make_unique<StatsAggregators::Distinct>(); }},
+    {"approx_mode", [] { return make_unique<StatsAggregators::ApproxMode>(); }}
+  };
+
+  const unordered_map<string, function<unique_ptr<StatsAggregator>(size_t)>> known_windows = {
+    {"sum", [](size_t length) { return make_unique<StatsAggregators::WindowSum>(length); }},
+    {"min", [](size_t length) { return make_unique<StatsAggregators::WindowMin>(length); }},
+    {"max", [](size_t length) { return make_unique<StatsAggregators::WindowMax>(length); }},
+    {"avg", [](size_t length) { return make_unique<StatsAggregators::WindowAverage>(length); }},
+    {"mode", [](size_t length) { return make_unique<StatsAggregators::WindowMode>(length); }}
   };
 
-  auto result = make_unique<StatsAggregators::Composite>();
+  vector<AggregatorFactory> builders;
 
   int aggr_count;
   input >> aggr_count;
@@ -27,25 +58,175 @@ unique_ptr<StatsAggregator> ReadAggregators(istream& input) {
   string line;
   for (int i = 0; i < aggr_count; ++i) {
     input >> line;
-    result->Add(known_builders.at(line)());
+
+    // min@100 - последние 100 значений, min@10s и min@500ms - последние 10 секунд и 500 мс
+    const size_t at = line.find('@');
+    if (at == string::npos) {
+      builders.push_back(known_builders.at(line));
+      continue;
+    }
+
+    const string name = line.substr(0, at);
+    const char* const end = line.data() + line.size();
+    size_t length = 0;
+    const auto [unit, error] = from_chars(line.data() + at + 1, end, length);
+    if (error != errc() || length == 0) {
+      throw invalid_argument("bad window length: " + line);
+    }
+
+    const string_view suffix(unit, end - unit);
+    if (suffix.empty()) {
+      builders.push_back([builder = known_windows.at(name), length] { return builder(length); });
+    } else if (suffix == "s" || suffix == "ms") {
+      const chrono::milliseconds duration(suffix == "s" ? length * 1000 : length);
+      builders.push_back([builder = known_builders.at(name), duration] {
+        return make_unique<StatsAggregators::TimeWindow>(builder, duration);
+      });
+    } else {
+      throw invalid_argument("bad window unit: " + line);
+    }
+  }
+
+  return [builders = move(builders)] {
+    auto result = make_unique<StatsAggregators::Composite>();
+    for (const auto& builder : builders) {
+      result->Add(builder());
+    }
+    return result;
+  };
+}
+
+// Пачка помещается в L1-кеш, поэтому проходы всех агрегаторов по ней дешёвые
+const size_t batch_size = 4096;
+
+void ProcessInBatches(StatsAggregator& aggr, span<const int> values) {
+  for (size_t pos = 0; pos < values.size(); pos += batch_size) {
+    aggr.Process(values.subspan(pos, min(batch_size, values.size() - pos)));
+  }
+}
+
+// Входной поток делится на куски по chunk_size значений. Каждый кусок
+// агрегируется в отдельной задаче, частичные результаты сливаются через
+// Merge строго в порядке кусков. В работе одновременно не больше
+// max_in_flight кусков, поэтому память не зависит от длины входа
+unique_ptr<StatsAggregator> AggregateParallel(
+    istream& input, const AggregatorFactory& factory, size_t max_in_flight, size_t chunk_size = 1 << 16
+) {
+  IntReader reader(*input.rdbuf());
+  auto result = factory();
+  deque<future<unique_ptr<StatsAggregator>>> in_flight;
+  auto reduce_front = [&] {
+    result->Merge(*in_flight.front().get());
+    in_flight.pop_front();
+  };
+
+  for (;;) {
+    vector<int> chunk(chunk_size);
+    chunk.resize(reader.Read(chunk));
+    if (chunk.empty()) {
+      break;
+    }
+    if (max_in_flight <= 1) {
+      // С одним потоком слияния - чистые накладные расходы
+      ProcessInBatches(*result, chunk);
+      continue;
+    }
+    if (in_flight.size() == max_in_flight) {
+      reduce_front();
+    }
+    in_flight.push_back(async(launch::async, [&factory, chunk = move(chunk)] {
+      auto partial = factory();
+      ProcessInBatches(*partial, chunk);
+      return partial;
+    }));
+  }
+  while (!in_flight.empty()) {
+    reduce_front();
   }
 
   return result;
 }
 
 int main() {
-  TestAll();
+  // Синхронизированный с stdio cin читает посимвольно через getc, а после
+  // запуска первого потока каждый getc ещё и берёт блокировку. Без
+  // синхронизации IntReader забирает stdin из буфера cin большими блоками
+  ios::sync_with_stdio(false);
 
-  auto stats_aggregator = ReadAggregators(cin);
+  TestAll();
 
-  for (int value; cin >> value; ) {
-    stats_aggregator->Process(value);
+  // IntReader не останавливается молча на некорректном вводе, как cin >> value,
+  // а бросает исключение: сообщаем о нём и завершаемся с ошибкой
+  try {
+    const auto factory = ReadAggregators(cin);
+    const size_t threads = max(1u, thread::hardware_concurrency());
+    AggregateParallel(cin, factory, threads)->PrintValue(cout);
+  } catch (const exception& e) {
+    cerr << "Error: " << e.what() << endl;
+    return 1;
   }
-  stats_aggregator->PrintValue(cout);
 
   return 0;
 }
 
+void TestAggregateParallel() {
+  istringstream spec("7 sum min max avg mode distinct approx_mode");
+  const auto factory = ReadAggregators(spec);
+
+  // Мало различных значений, чтобы в моде были ничьи на границах кусков
+  mt19937 gen(17);
+  uniform_int_distribution<int> dist(-20, 20);
+  string input;
+  vector<int> values;
+  for (int i = 0; i < 5000; ++i) {
+    values.push_back(dist(gen));
+    input += to_string(values.back()) + ' ';
+  }
+
+  ostringstream expected;
+  auto sequential = factory();
+  ProcessInBatches(*sequential, values);
+  sequential->PrintValue(expected);
+
+  for (size_t chunk_size : {5, 100, 4096, 10000}) {
+    for (size_t max_in_flight : {1, 2, 3}) {
+      istringstream stream(input);
+      ostringstream output;
+      AggregateParallel(stream, factory, max_in_flight, chunk_size)->PrintValue(output);
+      ASSERT_EQUAL(output.str(), expected.str());
+    }
+  }
+
+  istringstream empty;
+  ostringstream output;
+  AggregateParallel(empty, factory, 2)->PrintValue(output);
+  string expected_empty = "Sum is 0\nMin is undefined\nMax is undefined\nAverage is undefined\nMode is undefined\n";
+  expected_empty += "Distinct is 0\nApproximate mode is undefined\n";
+  ASSERT_EQUAL(output.str(), expected_empty);
+}
+
+void TestReadWindowedAggregators() {
+  istringstream spec("4 min@3 avg@2 mode@10s sum@500ms");
+  auto aggr = ReadAggregators(spec)();
+  for (int value : {5, 1, 4, 4, 2}) {
+    aggr->Process(value);
+  }
+  ostringstream output;
+  aggr->PrintValue(output);
+  ASSERT_EQUAL(output.str(), "Last 3: Min is 2\nLast 2: Average is 3\nLast 10s: Mode is 4\nLast 500ms: Sum is 16\n");
+
+  for (const char* bad : {"1 min@0", "1 min@x", "1 min@5h", "1 median@5"}) {
+    istringstream bad_spec(bad);
+    bool thrown = false;
+    try {
+      ReadAggregators(bad_spec);
+    } catch (const exception&) {
+      thrown = true;
+    }
+    AssertEqual(thrown, true, bad);
+  }
+}
+
 void TestAll() {
   TestRunner tr;
   RUN_TEST(tr, StatsAggregators::TestSum);
@@ -54,4 +235,20 @@ void TestAll() {
   RUN_TEST(tr, StatsAggregators::TestAverage);
   RUN_TEST(tr, StatsAggregators::TestMode);
   RUN_TEST(tr, StatsAggregators::TestComposite);
+  RUN_TEST(tr, StatsAggregators::TestBatch);
+  RUN_TEST(tr, StatsAggregators::TestStatic);
+  RUN_TEST(tr, StatsAggregators::TestKernels);
+  RUN_TEST(tr, StatsAggregators::TestWideSum);
+  RUN_TEST(tr, StatsAggregators::TestMerge);
+  RUN_TEST(tr, StatsAggregators::TestMergeModeTies);
+  RUN_TEST(tr, StatsAggregators::TestKllSketch);
+  RUN_TEST(tr, StatsAggregators::TestQuantile);
+  RUN_TEST(tr, StatsAggregators::TestDistinct);
+  RUN_TEST(tr, StatsAggregators::TestApproxMode);
+  RUN_TEST(tr, StatsAggregators::TestWindowCount);
+  RUN_TEST(tr, StatsAggregators::TestWindowMerge);
+  RUN_TEST(tr, StatsAggregators::TestTimeWindow);
+  RUN_TEST(tr, TestIntReader);
+  RUN_TEST(tr, TestAggregateParallel);
+  RUN_TEST(tr, TestReadWindowedAggregators);
 }
@@ -1,4 +1,7 @@
 #include "stats_aggregator.h"
+#include "stats_kernels.h"
+
+#include <stdexcept>
 
 using namespace std;
 
@@ -18,6 +21,22 @@ void StatsAggregators::Composite::Process(int value) {
   }
 }
 
+void StatsAggregators::Composite::Process(std::span<const int> values) {
+  for (auto& aggr : aggregators) {
+    aggr->Process(values);
+  }
+}
+
+void StatsAggregators::Composite::Merge(const StatsAggregator& other) {
+  const auto& rhs = dynamic_cast<const Composite&>(other);
+  if (rhs.aggregators.size() != aggregators.size()) {
+    throw invalid_argument("Composite::Merge: different number of aggregators");
+  }
+  for (size_t i = 0; i < aggregators.size(); ++i) {
+    aggregators[i]->Merge(*rhs.aggregators[i]);
+  }
+}
+
 void StatsAggregators::Composite::PrintValue(std::ostream& output) const {
   for (const auto& aggr : aggregators) {
     aggr->PrintValue(output);
@@ -33,6 +52,14 @@ void StatsAggregators::Sum::Process(int value) {
   sum += value;
 }
 
+void StatsAggregators::Sum::Process(std::span<const int> values) {
+  sum += StatsKernels::Sum(values);
+}
+
+void StatsAggregators::Sum::Merge(const StatsAggregator& other) {
+  sum += dynamic_cast<const Sum&>(other).sum;
+}
+
 void StatsAggregators::Sum::PrintValue(std::ostream& out) const {
   out << "Sum is " << sum;
 }
@@ -43,6 +70,19 @@ void StatsAggregators::Min::Process(int value) {
   }
 }
 
+void StatsAggregators::Min::Process(std::span<const int> values) {
+  if (values.empty()) {
+    return;
+  }
+  Process(StatsKernels::Min(values));
+}
+
+void StatsAggregators::Min::Merge(const StatsAggregator& other) {
+  if (const auto& rhs = dynamic_cast<const Min&>(other); rhs.current_min) {
+    Process(*rhs.current_min);
+  }
+}
+
 void StatsAggregators::Min::PrintValue(std::ostream& out) const {
   out << "Min is " << current_min;
 }
@@ -53,6 +93,19 @@ void StatsAggregators::Max::Process(int value) {
   }
 }
 
+void StatsAggregators::Max::Process(std::span<const int> values) {
+  if (values.empty()) {
+    return;
+  }
+  Process(StatsKernels::Max(values));
+}
+
+void StatsAggregators::Max::Merge(const StatsAggregator& other) {
+  if (const auto& rhs = dynamic_cast<const Max&>(other); rhs.current_max) {
+    Process(*rhs.current_max);
+  }
+}
+
 void StatsAggregators::Max::PrintValue(std::ostream& out) const {
   out << "Max is " << current_max;
 }
@@ -62,6 +115,17 @@ void StatsAggregators::Average::Process(int value) {
   ++total;
 }
 
+void StatsAggregators::Average::Process(std::span<const int> values) {
+  sum += StatsKernels::Sum(values);
+  total += static_cast<int64_t>(values.size());
+}
+
+void StatsAggregators::Average::Merge(const StatsAggregator& other) {
+  const auto& rhs = dynamic_cast<const Average&>(other);
+  sum += rhs.sum;
+  total += rhs.total;
+}
+
 void StatsAggregators::Average::PrintValue(std::ostream& out) const {
   out << "Average is ";
   if (total == 0) {
@@ -72,10 +136,44 @@ void StatsAggregators::Average::PrintValue(std::ostream& out) const {
 }
 
 void StatsAggregators::Mode::Process(int value) {
-  int current_count = ++count[value];
-  if (!mode || current_count > count[*mode]) {
+  Entry& entry = count[value];
+  ++entry.count;
+  entry.last_position = processed++;
+  if (entry.count > mode_count) {
     mode = value;
+    mode_count = entry.count;
+  }
+}
+
+void StatsAggregators::Mode::Process(std::span<const int> values) {
+  for (int value : values) {
+    Process(value);
+  }
+}
+
+void StatsAggregators::Mode::Merge(const StatsAggregator& other) {
+  const auto& rhs = dynamic_cast<const Mode&>(other);
+  // Значение, которого нет в rhs, не могло обогнать текущую моду ни по
+  // частоте, ни по позиции, поэтому претенденты - только мода и значения из rhs
+  int64_t mode_position = mode ? count.at(*mode).last_position : 0;
+  for (const auto& [value, entry] : rhs.count) {
+    Entry& merged = count[value];
+    merged.count += entry.count;
+    merged.last_position = processed + entry.last_position;
+    if (value == mode) {
+      mode_position = merged.last_position;
+      mode_count = merged.count;
+    }
+  }
+  for (const auto& [value, entry] : rhs.count) {
+    const Entry& merged = count.at(value);
+    if (merged.count > mode_count || (merged.count == mode_count && merged.last_position < mode_position)) {
+      mode = value;
+      mode_count = merged.count;
+      mode_position = merged.last_position;
+    }
   }
+  processed += rhs.processed;
 }
 
 void StatsAggregators::Mode::PrintValue(std::ostream& out) const {
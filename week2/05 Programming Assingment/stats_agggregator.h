@@ -1,11 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <ostream>
 #include <limits>
 #include <memory>
 #include <vector>
 #include <optional>
+#include <span>
+#include <tuple>
 #include <unordered_map>
+#include <utility>
 
 struct StatsAggregator {
   virtual ~StatsAggregator() {
@@ -13,24 +17,46 @@ struct StatsAggregator {
 
   virtual void Process(int value) = 0;
   virtual void PrintValue(std::ostream& out) const = 0;
+
+  // Обработка сразу пачки значений: один виртуальный вызов на пачку вместо
+  // вызова на каждое значение. По умолчанию значения обрабатываются по одному
+  virtual void Process(std::span<const int> values) {
+    for (int value : values) {
+      Process(value);
+    }
+  }
+
+  // Добавляет к состоянию результат агрегатора того же типа, обработавшего
+  // значения, которые идут в потоке сразу после наших. Так независимо
+  // посчитанные куски потока сводятся в ответ, совпадающий с последовательным.
+  // Для агрегатора другого типа бросает std::bad_cast
+  virtual void Merge(const StatsAggregator& other) = 0;
 };
 
 namespace StatsAggregators {
 
-    class Sum : public StatsAggregator {
+    class Sum final : public StatsAggregator {
     public:
         void Process(int value) override;
 
+        void Process(std::span<const int> values) override;
+
+        void Merge(const StatsAggregator &other) override;
+
         void PrintValue(std::ostream &out) const override;
 
     private:
-        int sum = 0;
+        int64_t sum = 0;
     };
 
-    class Min : public StatsAggregator {
+    class Min final : public StatsAggregator {
     public:
         void Process(int value) override;
 
+        void Process(std::span<const int> values) override;
+
+        void Merge(const StatsAggregator &other) override;
+
         void PrintValue(std::ostream &out) const override;
 
     private:
@@ -40,42 +66,68 @@ namespace StatsAggregators {
         std::optional<int> current_min;
     };
 
-    class Max : public StatsAggregator {
+    class Max final : public StatsAggregator {
     public:
         void Process(int value) override;
 
+        void Process(std::span<const int> values) override;
+
+        void Merge(const StatsAggregator &other) override;
+
         void PrintValue(std::ostream &out) const override;
 
     private:
         std::optional<int> current_max;
     };
 
-    class Average : public StatsAggregator {
+    class Average final : public StatsAggregator {
     public:
         void Process(int value) override;
 
+        void Process(std::span<const int> values) override;
+
+        void Merge(const StatsAggregator &other) override;
+
         void PrintValue(std::ostream &out) const override;
 
     private:
-        int sum = 0;
-        int total = 0;
+        int64_t sum = 0;
+        int64_t total = 0;
     };
 
-    class Mode : public StatsAggregator {
+    class Mode final : public StatsAggregator {
     public:
         void Process(int value) override;
 
+        void Process(std::span<const int> values) override;
+
+        void Merge(const StatsAggregator &other) override;
+
         void PrintValue(std::ostream &out) const override;
 
     private:
-        std::unordered_map<int, int> count;
+        // При равенстве частот модой остаётся значение, раньше набравшее свою
+        // частоту, то есть значение с самым ранним последним вхождением.
+        // Поэтому кроме частоты храним позицию последнего вхождения
+        struct Entry {
+            int count = 0;
+            int64_t last_position = 0;
+        };
+
+        std::unordered_map<int, Entry> count;
         std::optional<int> mode;
+        int mode_count = 0;
+        int64_t processed = 0;
     };
 
     class Composite : public StatsAggregator {
     public:
         void Process(int value) override;
 
+        void Process(std::span<const int> values) override;
+
+        void Merge(const StatsAggregator &other) override;
+
         void PrintValue(std::ostream &output) const override;
 
         void Add(std::unique_ptr<StatsAggregator> aggr);
@@ -84,6 +136,38 @@ namespace StatsAggregators {
         std::vector<std::unique_ptr<StatsAggregator>> aggregators;
     };
 
+    // Статически скомпонованный агрегатор: набор агрегаторов известен при
+    // компиляции, поэтому их вызовы не проходят через таблицу виртуальных функций
+    template <typename... Aggregators>
+    class Static final : public StatsAggregator {
+    public:
+        void Process(int value) override {
+            std::apply([value](auto &... aggr) { (aggr.Process(value), ...); }, aggregators);
+        }
+
+        void Process(std::span<const int> values) override {
+            std::apply([values](auto &... aggr) { (aggr.Process(values), ...); }, aggregators);
+        }
+
+        void Merge(const StatsAggregator &other) override {
+            MergeImpl(dynamic_cast<const Static &>(other), std::index_sequence_for<Aggregators...>());
+        }
+
+        void PrintValue(std::ostream &output) const override {
+            std::apply([&output](const auto &... aggr) {
+                ((aggr.PrintValue(output), output << '\n'), ...);
+            }, aggregators);
+        }
+
+    private:
+        std::tuple<Aggregators...> aggregators;
+
+        template <size_t... I>
+        void MergeImpl(const Static &other, std::index_sequence<I...>) {
+            (std::get<I>(aggregators).Merge(std::get<I>(other.aggregators)), ...);
+        }
+    };
+
     void TestSum();
 
     void TestMin();
@@ -96,4 +180,16 @@ namespace StatsAggregators {
 
     void TestComposite();
 
+    void TestBatch();
+
+    void TestStatic();
+
+    void TestKernels();
+
+    void TestWideSum();
+
+    void TestMerge();
+
+    void TestMergeModeTies();
+
 }
@@ -1,7 +1,15 @@
 #include "stats_aggregator.h"
+#include "stats_kernels.h"
+#include "stats_sketches.h"
+#include "stats_windows.h"
 #include "test_runner.h"
 
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
 #include <sstream>
+#include <typeinfo>
 
 using namespace std;
 
@@ -98,3 +106,426 @@ void StatsAggregators::TestComposite() {
     expected += "Mode is 16\n";
     ASSERT_EQUAL(PrintedValue(aggr), expected);
 }
+
+void StatsAggregators::TestBatch() {
+    const vector<int> values = {3, 8, -1, 16, 16, 8, 8, 2};
+
+    Composite by_one;
+    Composite by_batch;
+    for (Composite *aggr : {&by_one, &by_batch}) {
+        aggr->Add(make_unique<Sum>());
+        aggr->Add(make_unique<Min>());
+        aggr->Add(make_unique<Max>());
+        aggr->Add(make_unique<Average>());
+        aggr->Add(make_unique<Mode>());
+    }
+
+    for (int value : values) {
+        by_one.Process(value);
+    }
+    by_batch.Process(span<const int>(values.data(), 3));
+    by_batch.Process(span<const int>());
+    by_batch.Process(span<const int>(values).subspan(3));
+
+    ASSERT_EQUAL(PrintedValue(by_batch), PrintedValue(by_one));
+    ASSERT_EQUAL(PrintedValue(by_batch), "Sum is 60\nMin is -1\nMax is 16\nAverage is 7\nMode is 8\n");
+}
+
+void StatsAggregators::TestStatic() {
+    Static<Sum, Min, Max, Average, Mode> aggr;
+    ASSERT_EQUAL(
+            PrintedValue(aggr),
+            "Sum is 0\nMin is undefined\nMax is undefined\nAverage is undefined\nMode is undefined\n"
+    );
+
+    const vector<int> values = {3, 8, -1, 16};
+    aggr.Process(span<const int>(values));
+    aggr.Process(16);
+
+    string expected = "Sum is 42\n";
+    expected += "Min is -1\n";
+    expected += "Max is 16\n";
+    expected += "Average is 8\n";
+    expected += "Mode is 16\n";
+    ASSERT_EQUAL(PrintedValue(aggr), expected);
+}
+
+void StatsAggregators::TestKernels() {
+    // Длины вокруг ширины векторов, чтобы проверить и основной цикл, и хвост
+    mt19937 gen(7);
+    uniform_int_distribution<int> dist(numeric_limits<int>::min(), numeric_limits<int>::max());
+    for (size_t size : {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 1000, 4099}) {
+        vector<int> values(size);
+        for (int &value : values) {
+            value = dist(gen);
+        }
+        const int64_t expected_sum = accumulate(values.begin(), values.end(), int64_t{0});
+        const int expected_min = *min_element(values.begin(), values.end());
+        const int expected_max = *max_element(values.begin(), values.end());
+        for (const StatsKernels::Kernels &kernels : StatsKernels::AvailableKernels()) {
+            const string hint = string(kernels.name) + " size=" + to_string(size);
+            AssertEqual(kernels.sum(values), expected_sum, hint + " sum");
+            AssertEqual(kernels.min(values), expected_min, hint + " min");
+            AssertEqual(kernels.max(values), expected_max, hint + " max");
+        }
+    }
+}
+
+void StatsAggregators::TestWideSum() {
+    const vector<int> values(8, numeric_limits<int>::max());
+
+    Sum sum;
+    sum.Process(span<const int>(values));
+    sum.Process(numeric_limits<int>::max());
+    ASSERT_EQUAL(PrintedValue(sum), "Sum is " + to_string(9 * int64_t{numeric_limits<int>::max()}));
+
+    Average average;
+    average.Process(span<const int>(values));
+    average.Process(numeric_limits<int>::max());
+    ASSERT_EQUAL(PrintedValue(average), "Average is " + to_string(numeric_limits<int>::max()));
+}
+
+void StatsAggregators::TestMerge() {
+    const vector<int> values = {3, 8, -1, 16, 16, 8, 2, -7, 8, 16};
+
+    auto make_composite = [] {
+        auto aggr = make_unique<Composite>();
+        aggr->Add(make_unique<Sum>());
+        aggr->Add(make_unique<Min>());
+        aggr->Add(make_unique<Max>());
+        aggr->Add(make_unique<Average>());
+        aggr->Add(make_unique<Mode>());
+        return aggr;
+    };
+
+    auto whole = make_composite();
+    whole->Process(span<const int>(values));
+    const string expected = PrintedValue(*whole);
+
+    for (size_t split = 0; split <= values.size(); ++split) {
+        auto left = make_composite();
+        auto right = make_composite();
+        left->Process(span<const int>(values).first(split));
+        right->Process(span<const int>(values).subspan(split));
+        left->Merge(*right);
+        AssertEqual(PrintedValue(*left), expected, "split=" + to_string(split));
+    }
+
+    Static<Sum, Mode> left;
+    Static<Sum, Mode> right;
+    left.Process(span<const int>(values).first(4));
+    right.Process(span<const int>(values).subspan(4));
+    left.Merge(right);
+    ASSERT_EQUAL(PrintedValue(left), "Sum is 69\nMode is 8\n");
+
+    bool thrown = false;
+    try {
+        Sum sum;
+        sum.Merge(Min());
+    } catch (const bad_cast &) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void StatsAggregators::TestMergeModeTies() {
+    // В потоке 1 2 2 1 обе частоты равны 2, но двойку первой набрала 2
+    Mode left;
+    Mode right;
+    left.Process(1);
+    left.Process(2);
+    right.Process(2);
+    right.Process(1);
+    left.Merge(right);
+    ASSERT_EQUAL(PrintedValue(left), "Mode is 2");
+
+    // Слияние нескольких кусков подряд: 5 | 7 7 | 5 | 9 9 9 5
+    vector<vector<int>> chunks = {{5}, {7, 7}, {5}, {9, 9, 9, 5}};
+    Mode merged;
+    Mode sequential;
+    for (const auto &chunk : chunks) {
+        Mode partial;
+        partial.Process(span<const int>(chunk));
+        merged.Merge(partial);
+        sequential.Process(span<const int>(chunk));
+        ASSERT_EQUAL(PrintedValue(merged), PrintedValue(sequential));
+    }
+    ASSERT_EQUAL(PrintedValue(merged), "Mode is 9");
+
+    Mode empty;
+    merged.Merge(empty);
+    ASSERT_EQUAL(PrintedValue(merged), "Mode is 9");
+}
+
+void StatsAggregators::TestKllSketch() {
+    const int n = 200000;
+    vector<int> values(n);
+    iota(values.begin(), values.end(), 0);
+    shuffle(values.begin(), values.end(), mt19937(3));
+
+    KllSketch whole;
+    vector<KllSketch> parts(4);
+    for (int i = 0; i < n; ++i) {
+        whole.Add(values[i]);
+        parts[i % parts.size()].Add(values[i]);
+    }
+    KllSketch merged;
+    for (const KllSketch &part : parts) {
+        merged.Merge(part);
+    }
+
+    ASSERT_EQUAL(whole.Count(), n);
+    ASSERT_EQUAL(merged.Count(), n);
+    ASSERT(whole.RetainedItems() < 1000);
+    ASSERT(merged.RetainedItems() < 1000);
+
+    // Значения совпадают с рангами, поэтому ошибку ранга видно напрямую
+    for (double q : {0.01, 0.1, 0.5, 0.9, 0.99}) {
+        const string hint = "q=" + to_string(q);
+        AssertEqual(abs(whole.Quantile(q) - q * n) < 0.01 * n, true, hint);
+        AssertEqual(abs(merged.Quantile(q) - q * n) < 0.01 * n, true, hint + " merged");
+    }
+
+    // Пока уровень 0 не переполнен, ответы точные
+    KllSketch small;
+    for (int value : {5, 1, 4, 2, 3}) {
+        small.Add(value);
+    }
+    ASSERT_EQUAL(small.Quantile(0.0), 1);
+    ASSERT_EQUAL(small.Quantile(0.5), 3);
+    ASSERT_EQUAL(small.Quantile(1.0), 5);
+}
+
+void StatsAggregators::TestQuantile() {
+    Quantile median(0.5, "Median");
+    Quantile p90(0.9, "P90");
+    ASSERT_EQUAL(PrintedValue(median), "Median is undefined");
+
+    const vector<int> values = {7, 3, 9, 1, 5, 2, 8, 4, 6};
+    median.Process(span<const int>(values));
+    p90.Process(span<const int>(values));
+    ASSERT_EQUAL(PrintedValue(median), "Median is 5");
+    ASSERT_EQUAL(PrintedValue(p90), "P90 is 9");
+
+    Quantile other(0.5, "Median");
+    for (int value : {10, 11, 12, 13, 14, 15, 16, 17, 18}) {
+        other.Process(value);
+    }
+    median.Merge(other);
+    ASSERT_EQUAL(PrintedValue(median), "Median is 9");
+}
+
+void StatsAggregators::TestDistinct() {
+    Distinct empty;
+    ASSERT_EQUAL(PrintedValue(empty), "Distinct is 0");
+
+    Distinct small;
+    for (int i = 0; i < 10000; ++i) {
+        small.Process(i % 1000);
+    }
+    ASSERT(abs(small.Estimate() - 1000) <= 10);
+
+    // Две перекрывающиеся половины: слияние считает объединение
+    Distinct left;
+    Distinct right;
+    Distinct whole;
+    const int n = 300000;
+    for (int i = 0; i < n; ++i) {
+        (i < n * 3 / 5 ? left : right).Process(i);
+        whole.Process(i);
+        if (i % 2 == 0) {
+            right.Process(i);
+        }
+    }
+    left.Merge(right);
+    ASSERT_EQUAL(left.Estimate(), whole.Estimate());
+    ASSERT(abs(whole.Estimate() - n) < 0.03 * n);
+}
+
+void StatsAggregators::TestApproxMode() {
+    ApproxMode empty;
+    ASSERT_EQUAL(PrintedValue(empty), "Approximate mode is undefined");
+
+    // 42 составляет 10% потока, остальное - шум из миллиона значений
+    mt19937 gen(11);
+    uniform_int_distribution<int> noise(0, 1000000);
+    vector<int> values;
+    for (int i = 0; i < 200000; ++i) {
+        values.push_back(i % 10 == 0 ? 42 : noise(gen));
+    }
+
+    ApproxMode whole;
+    ApproxMode left;
+    ApproxMode right;
+    whole.Process(span<const int>(values));
+    left.Process(span<const int>(values).first(values.size() / 3));
+    right.Process(span<const int>(values).subspan(values.size() / 3));
+    left.Merge(right);
+
+    ASSERT_EQUAL(PrintedValue(whole), "Approximate mode is 42");
+    ASSERT_EQUAL(PrintedValue(left), "Approximate mode is 42");
+    ASSERT(whole.EstimateCount(42) >= 20000);
+    ASSERT(left.EstimateCount(42) >= 20000);
+
+    // Пока различных значений не больше capacity, счётчики точные
+    ApproxMode exact(4);
+    for (int value : {1, 2, 2, 3, 3, 3}) {
+        exact.Process(value);
+    }
+    ASSERT_EQUAL(exact.EstimateCount(3), 3);
+    ASSERT_EQUAL(exact.EstimateCount(2), 2);
+    ASSERT_EQUAL(PrintedValue(exact), "Approximate mode is 3");
+}
+
+namespace {
+
+    // Эталон: обычный агрегатор по последним length значениям
+    template <typename Aggregator>
+    string PrintedOverTail(const vector<int> &values, size_t length) {
+        Aggregator aggr;
+        const size_t start = values.size() > length ? values.size() - length : 0;
+        aggr.Process(span<const int>(values).subspan(start));
+        return PrintedValue(aggr);
+    }
+
+}
+
+void StatsAggregators::TestWindowCount() {
+    ASSERT_EQUAL(PrintedValue(WindowMin(3)), "Last 3: Min is undefined");
+    ASSERT_EQUAL(PrintedValue(WindowAverage(3)), "Last 3: Average is undefined");
+
+    mt19937 gen(5);
+    uniform_int_distribution<int> dist(-10, 10);
+    for (size_t length : {1, 2, 5, 16}) {
+        WindowSum sum(length);
+        WindowMin min(length);
+        WindowMax max(length);
+        WindowAverage average(length);
+        WindowMode mode(length);
+
+        vector<int> values;
+        for (int i = 0; i < 200; ++i) {
+            values.push_back(dist(gen));
+            for (StatsAggregator *aggr : initializer_list<StatsAggregator *>{&sum, &min, &max, &average, &mode}) {
+                aggr->Process(values.back());
+            }
+
+            const string prefix = "Last " + to_string(length) + ": ";
+            const string hint = "length=" + to_string(length) + " i=" + to_string(i);
+            AssertEqual(PrintedValue(sum), prefix + PrintedOverTail<Sum>(values, length), hint);
+            AssertEqual(PrintedValue(min), prefix + PrintedOverTail<Min>(values, length), hint);
+            AssertEqual(PrintedValue(max), prefix + PrintedOverTail<Max>(values, length), hint);
+            AssertEqual(PrintedValue(average), prefix + PrintedOverTail<Average>(values, length), hint);
+            AssertEqual(PrintedValue(mode), prefix + PrintedOverTail<Mode>(values, length), hint);
+        }
+    }
+}
+
+void StatsAggregators::TestWindowMerge() {
+    const vector<int> values = {4, 9, 1, 7, 7, 3, 8, 2, 6, 5, 5};
+    const size_t length = 4;
+
+    for (size_t split = 0; split <= values.size(); ++split) {
+        const auto left = span<const int>(values).first(split);
+        const auto right = span<const int>(values).subspan(split);
+        const string hint = "split=" + to_string(split);
+
+        auto check = [&](auto whole, auto lhs, auto rhs) {
+            whole.Process(span<const int>(values));
+            lhs.Process(left);
+            rhs.Process(right);
+            lhs.Merge(rhs);
+            AssertEqual(PrintedValue(lhs), PrintedValue(whole), hint);
+        };
+        check(WindowSum(length), WindowSum(length), WindowSum(length));
+        check(WindowMin(length), WindowMin(length), WindowMin(length));
+        check(WindowMax(length), WindowMax(length), WindowMax(length));
+        check(WindowAverage(length), WindowAverage(length), WindowAverage(length));
+        check(WindowMode(length), WindowMode(length), WindowMode(length));
+    }
+}
+
+void StatsAggregators::TestTimeWindow() {
+    using namespace chrono;
+
+    steady_clock::time_point now{seconds(1000)};
+    auto clock = [&now] { return now; };
+    auto make_window = [&clock] {
+        return TimeWindow([] { return make_unique<Min>(); }, seconds(10), 10, clock);
+    };
+
+    TimeWindow window = make_window();
+    ASSERT_EQUAL(PrintedValue(window), "Last 10s: Min is undefined");
+
+    window.Process(1);
+    now += seconds(3);
+    window.Process(5);
+    ASSERT_EQUAL(PrintedValue(window), "Last 10s: Min is 1");
+
+    // Через 10 секунд корзина с единицей выпадает из окна
+    now += seconds(7);
+    ASSERT_EQUAL(PrintedValue(window), "Last 10s: Min is 5");
+    window.Process(span<const int>(vector<int>{7, 6}));
+    ASSERT_EQUAL(PrintedValue(window), "Last 10s: Min is 5");
+    now += seconds(4);
+    ASSERT_EQUAL(PrintedValue(window), "Last 10s: Min is 6");
+    now += seconds(60);
+    ASSERT_EQUAL(PrintedValue(window), "Last 10s: Min is undefined");
+
+    // Слияние раскладывает корзины rhs по их времени
+    TimeWindow lhs = make_window();
+    TimeWindow rhs = make_window();
+    lhs.Process(3);
+    rhs.Process(4);
+    now += seconds(5);
+    rhs.Process(2);
+    lhs.Merge(rhs);
+    ASSERT_EQUAL(PrintedValue(lhs), "Last 10s: Min is 2");
+    now += seconds(5);
+    ASSERT_EQUAL(PrintedValue(lhs), "Last 10s: Min is 2");
+    now += seconds(5);
+    ASSERT_EQUAL(PrintedValue(lhs), "Last 10s: Min is undefined");
+
+    // Часы rhs убежали на целое окно вперёд, и его корзина заняла слот
+    // текущей корзины lhs: новые значения lhs попадают в неё
+    TimeWindow ahead([] { return make_unique<Min>(); }, seconds(10), 10, [&now] { return now + seconds(10); });
+    ahead.Process(9);
+    lhs.Process(5);
+    lhs.Merge(ahead);
+    lhs.Process(3);
+    ASSERT_EQUAL(PrintedValue(lhs), "Last 10s: Min is undefined");
+    now += seconds(10);
+    ASSERT_EQUAL(PrintedValue(lhs), "Last 10s: Min is 3");
+
+    // Окно, не делящееся на 10 корзин, округляется вверх до целой корзины:
+    // 15 мс - это 8 корзин по 2 мс, то есть 16 мс
+    now = steady_clock::time_point{milliseconds(1'000'000)};
+    TimeWindow odd([] { return make_unique<Min>(); }, milliseconds(15), 10, clock);
+    odd.Process(1);
+    now += milliseconds(15);
+    ASSERT_EQUAL(PrintedValue(odd), "Last 15ms: Min is 1");
+    now += milliseconds(1);
+    ASSERT_EQUAL(PrintedValue(odd), "Last 15ms: Min is undefined");
+
+    // Простая длина даёт 10 корзин по 1001 мс, а не 10007 корзин по 1 мс
+    now = steady_clock::time_point{milliseconds(1001 * 1000)};
+    TimeWindow prime([] { return make_unique<Min>(); }, milliseconds(10007), 10, clock);
+    prime.Process(1);
+    now += milliseconds(10009);
+    ASSERT_EQUAL(PrintedValue(prime), "Last 10007ms: Min is 1");
+    now += milliseconds(1);
+    ASSERT_EQUAL(PrintedValue(prime), "Last 10007ms: Min is undefined");
+
+    TimeWindow short_window([] { return make_unique<Min>(); }, milliseconds(5), 10, clock);
+    short_window.Process(2);
+    now += milliseconds(4);
+    ASSERT_EQUAL(PrintedValue(short_window), "Last 5ms: Min is 2");
+    now += milliseconds(1);
+    ASSERT_EQUAL(PrintedValue(short_window), "Last 5ms: Min is undefined");
+
+    // Окно нулевой длины ведёт себя как окно длины 1
+    WindowMin empty_min(0);
+    empty_min.Process(3);
+    empty_min.Process(4);
+    ASSERT_EQUAL(PrintedValue(empty_min), "Last 1: Min is 4");
+}
@@ -0,0 +1,167 @@
+#include "stats_kernels.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define STATS_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace StatsKernels {
+
+    namespace {
+
+        int64_t SumScalar(std::span<const int> values) {
+            int64_t sum = 0;
+            for (int value : values) {
+                sum += value;
+            }
+            return sum;
+        }
+
+        int MinScalar(std::span<const int> values) {
+            int result = values[0];
+            for (int value : values) {
+                result = std::min(result, value);
+            }
+            return result;
+        }
+
+        int MaxScalar(std::span<const int> values) {
+            int result = values[0];
+            for (int value : values) {
+                result = std::max(result, value);
+            }
+            return result;
+        }
+
+#ifdef STATS_KERNELS_X86
+
+        // SSE2 не умеет ни знакового расширения до 64 бит, ни pminsd:
+        // оба действия собираем из сравнений и перестановок
+        __attribute__((target("sse2")))
+        int64_t SumSse2(std::span<const int> values) {
+            const int *data = values.data();
+            const size_t n = values.size();
+            __m128i acc = _mm_setzero_si128();
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                const __m128i sign = _mm_srai_epi32(v, 31);
+                acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, sign));
+                acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, sign));
+            }
+            alignas(16) int64_t lanes[2];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+            return lanes[0] + lanes[1] + SumScalar(values.subspan(i));
+        }
+
+        template <bool IsMin>
+        __attribute__((target("sse2")))
+        int ReduceSse2(std::span<const int> values) {
+            const int *data = values.data();
+            const size_t n = values.size();
+            if (n < 4) {
+                return IsMin ? MinScalar(values) : MaxScalar(values);
+            }
+            __m128i acc = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+            size_t i = 4;
+            for (; i + 4 <= n; i += 4) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                const __m128i take = IsMin ? _mm_cmplt_epi32(v, acc) : _mm_cmpgt_epi32(v, acc);
+                acc = _mm_or_si128(_mm_and_si128(take, v), _mm_andnot_si128(take, acc));
+            }
+            alignas(16) int lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+            int result = IsMin ? MinScalar(lanes) : MaxScalar(lanes);
+            for (; i < n; ++i) {
+                result = IsMin ? std::min(result, data[i]) : std::max(result, data[i]);
+            }
+            return result;
+        }
+
+        int MinSse2(std::span<const int> values) {
+            return ReduceSse2<true>(values);
+        }
+
+        int MaxSse2(std::span<const int> values) {
+            return ReduceSse2<false>(values);
+        }
+
+        __attribute__((target("avx2")))
+        int64_t SumAvx2(std::span<const int> values) {
+            const int *data = values.data();
+            const size_t n = values.size();
+            __m256i acc_lo = _mm256_setzero_si256();
+            __m256i acc_hi = _mm256_setzero_si256();
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                acc_lo = _mm256_add_epi64(acc_lo, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+                acc_hi = _mm256_add_epi64(acc_hi, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+            }
+            alignas(32) int64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc_lo, acc_hi));
+            return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumScalar(values.subspan(i));
+        }
+
+        template <bool IsMin>
+        __attribute__((target("avx2")))
+        int ReduceAvx2(std::span<const int> values) {
+            const int *data = values.data();
+            const size_t n = values.size();
+            if (n < 8) {
+                return IsMin ? MinScalar(values) : MaxScalar(values);
+            }
+            __m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+            size_t i = 8;
+            for (; i + 8 <= n; i += 8) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                acc = IsMin ? _mm256_min_epi32(acc, v) : _mm256_max_epi32(acc, v);
+            }
+            alignas(32) int lanes[8];
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+            int result = IsMin ? MinScalar(lanes) : MaxScalar(lanes);
+            for (; i < n; ++i) {
+                result = IsMin ? std::min(result, data[i]) : std::max(result, data[i]);
+            }
+            return result;
+        }
+
+        int MinAvx2(std::span<const int> values) {
+            return ReduceAvx2<true>(values);
+        }
+
+        int MaxAvx2(std::span<const int> values) {
+            return ReduceAvx2<false>(values);
+        }
+
+#endif
+
+        std::vector<Kernels> DetectKernels() {
+            std::vector<Kernels> kernels = {{"scalar", SumScalar, MinScalar, MaxScalar}};
+#ifdef STATS_KERNELS_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("sse2")) {
+                kernels.push_back({"sse2", SumSse2, MinSse2, MaxSse2});
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                kernels.push_back({"avx2", SumAvx2, MinAvx2, MaxAvx2});
+            }
+#endif
+            return kernels;
+        }
+
+    }
+
+    const std::vector<Kernels> &AvailableKernels() {
+        static const std::vector<Kernels> kernels = DetectKernels();
+        return kernels;
+    }
+
+    const Kernels &BestKernels() {
+        static const Kernels &best = AvailableKernels().back();
+        return best;
+    }
+
+}
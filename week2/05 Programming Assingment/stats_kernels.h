@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Горизонтальные сумма, минимум и максимум по пачке int.
+// Сумма накапливается в 64 битах и не переполняется на длинных потоках.
+// Min и Max требуют непустую пачку
+namespace StatsKernels {
+
+    struct Kernels {
+        const char *name;
+        int64_t (*sum)(std::span<const int> values);
+        int (*min)(std::span<const int> values);
+        int (*max)(std::span<const int> values);
+    };
+
+    // Все реализации, которые поддерживает текущий процессор: scalar, sse2, avx2
+    const std::vector<Kernels> &AvailableKernels();
+
+    // Самая быстрая из доступных реализаций, выбирается один раз при первом вызове
+    const Kernels &BestKernels();
+
+    inline int64_t Sum(std::span<const int> values) {
+        return BestKernels().sum(values);
+    }
+
+    inline int Min(std::span<const int> values) {
+        return BestKernels().min(values);
+    }
+
+    inline int Max(std::span<const int> values) {
+        return BestKernels().max(values);
+    }
+
+}
@@ -0,0 +1,62 @@
+#include "stats_kernels.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+using namespace std;
+
+// Результаты сохраняются в volatile, чтобы компилятор не выбросил вызовы ядер
+volatile int64_t sink = 0;
+
+// Сравнение реализаций ядер на пачках разного размера.
+// Для каждого размера обрабатывается примерно одинаковое число значений,
+// выводится время на одно значение в наносекундах:
+//   g++ -std=c++20 -O2 stats_kernels.cpp stats_kernels_benchmark.cpp
+int main() {
+  const size_t values_per_run = 1 << 26;
+
+  mt19937 gen(42);
+  uniform_int_distribution<int> dist(-1000000, 1000000);
+  vector<int> values(1 << 20);
+  for (int& value : values) {
+    value = dist(gen);
+  }
+
+  cout << setw(8) << "batch";
+  for (const auto& kernels : StatsKernels::AvailableKernels()) {
+    cout << setw(12) << string(kernels.name) + ".sum" << setw(12) << string(kernels.name) + ".min";
+  }
+  cout << '\n' << fixed << setprecision(3);
+
+  for (size_t batch_size = 16; batch_size <= values.size(); batch_size *= 4) {
+    const span<const int> batch(values.data(), batch_size);
+    const size_t repeats = values_per_run / batch_size;
+
+    cout << setw(8) << batch_size;
+    for (const auto& kernels : StatsKernels::AvailableKernels()) {
+      int64_t checksum = 0;
+      auto start = chrono::steady_clock::now();
+      for (size_t i = 0; i < repeats; ++i) {
+        checksum += kernels.sum(batch);
+      }
+      auto sum_time = chrono::steady_clock::now() - start;
+
+      start = chrono::steady_clock::now();
+      for (size_t i = 0; i < repeats; ++i) {
+        checksum += kernels.min(batch);
+      }
+      auto min_time = chrono::steady_clock::now() - start;
+
+      const double values_processed = static_cast<double>(repeats * batch_size);
+      cout << setw(12) << chrono::duration<double, nano>(sum_time).count() / values_processed
+           << setw(12) << chrono::duration<double, nano>(min_time).count() / values_processed;
+      sink = checksum;
+    }
+    cout << '\n';
+  }
+
+  return 0;
+}
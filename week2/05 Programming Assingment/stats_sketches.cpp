@@ -0,0 +1,277 @@
+#include "stats_sketches.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+using namespace std;
+
+StatsAggregators::KllSketch::KllSketch(int k) : k(k) {
+}
+
+void StatsAggregators::KllSketch::Add(int value) {
+  if (levels.empty()) {
+    levels.emplace_back();
+  }
+  levels[0].push_back(value);
+  ++count;
+  if (levels[0].size() >= Capacity(0)) {
+    Compress();
+  }
+}
+
+void StatsAggregators::KllSketch::Merge(const KllSketch& other) {
+  if (levels.size() < other.levels.size()) {
+    levels.resize(other.levels.size());
+  }
+  for (size_t level = 0; level < other.levels.size(); ++level) {
+    levels[level].insert(levels[level].end(), other.levels[level].begin(), other.levels[level].end());
+  }
+  count += other.count;
+  Compress();
+}
+
+int StatsAggregators::KllSketch::Quantile(double q) const {
+  vector<pair<int, int64_t>> weighted;
+  weighted.reserve(RetainedItems());
+  for (size_t level = 0; level < levels.size(); ++level) {
+    for (int value : levels[level]) {
+      weighted.emplace_back(value, int64_t{1} << level);
+    }
+  }
+  sort(weighted.begin(), weighted.end());
+
+  const double target = q * static_cast<double>(count);
+  int64_t rank = 0;
+  for (const auto& [value, weight] : weighted) {
+    rank += weight;
+    if (static_cast<double>(rank) >= target) {
+      return value;
+    }
+  }
+  return weighted.back().first;
+}
+
+int64_t StatsAggregators::KllSketch::Count() const {
+  return count;
+}
+
+size_t StatsAggregators::KllSketch::RetainedItems() const {
+  size_t result = 0;
+  for (const auto& level : levels) {
+    result += level.size();
+  }
+  return result;
+}
+
+size_t StatsAggregators::KllSketch::Capacity(size_t level) const {
+  // Нижние уровни получают геометрически меньше места, чем верхний, но не
+  // меньше 8 значений: иначе сжатие запускалось бы почти на каждом Add
+  const size_t depth = levels.size() - 1 - level;
+  const double capacity = ceil(k * pow(2.0 / 3.0, static_cast<double>(depth)));
+  return max<size_t>(8, static_cast<size_t>(capacity));
+}
+
+void StatsAggregators::KllSketch::Compress() {
+  for (size_t level = 0; level < levels.size(); ++level) {
+    if (levels[level].size() < Capacity(level)) {
+      continue;
+    }
+    if (level + 1 == levels.size()) {
+      levels.emplace_back();
+    }
+    auto& items = levels[level];
+    auto& next = levels[level + 1];
+
+    // Случайный выбор чётных или нечётных позиций делает оценку ранга несмещённой
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    const size_t offset = random_state & 1;
+
+    sort(items.begin(), items.end());
+    const size_t paired = items.size() & ~size_t{1};
+    for (size_t i = offset; i < paired; i += 2) {
+      next.push_back(items[i]);
+    }
+    if (paired < items.size()) {
+      items = {items.back()};
+    } else {
+      items.clear();
+    }
+  }
+}
+
+StatsAggregators::Quantile::Quantile(double q, string label) : q(q), label(move(label)) {
+}
+
+void StatsAggregators::Quantile::Process(int value) {
+  sketch.Add(value);
+}
+
+void StatsAggregators::Quantile::Merge(const StatsAggregator& other) {
+  sketch.Merge(dynamic_cast<const Quantile&>(other).sketch);
+}
+
+void StatsAggregators::Quantile::PrintValue(std::ostream& out) const {
+  out << label << " is ";
+  if (sketch.Count() == 0) {
+    out << "undefined";
+  } else {
+    out << sketch.Quantile(q);
+  }
+}
+
+namespace {
+
+  uint64_t Mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+  }
+
+}
+
+void StatsAggregators::Distinct::Process(int value) {
+  const uint64_t hash = Mix(static_cast<uint32_t>(value));
+  const size_t index = hash >> (64 - precision);
+  // Сторожевой бит ограничивает длину серии нулей, если остаток хеша нулевой
+  const uint64_t rest = (hash << precision) | (uint64_t{1} << (precision - 1));
+  const uint8_t rank = static_cast<uint8_t>(countl_zero(rest) + 1);
+  registers[index] = max(registers[index], rank);
+}
+
+void StatsAggregators::Distinct::Merge(const StatsAggregator& other) {
+  const auto& rhs = dynamic_cast<const Distinct&>(other);
+  for (size_t i = 0; i < registers.size(); ++i) {
+    registers[i] = max(registers[i], rhs.registers[i]);
+  }
+}
+
+int64_t StatsAggregators::Distinct::Estimate() const {
+  const double m = static_cast<double>(registers.size());
+  double harmonic = 0;
+  size_t zeros = 0;
+  for (uint8_t rank : registers) {
+    harmonic += ldexp(1.0, -rank);
+    zeros += rank == 0;
+  }
+  const double alpha = 0.7213 / (1 + 1.079 / m);
+  const double estimate = alpha * m * m / harmonic;
+  // На малых мощностях точнее линейный подсчёт по пустым регистрам
+  if (estimate <= 2.5 * m && zeros > 0) {
+    return llround(m * log(m / static_cast<double>(zeros)));
+  }
+  return llround(estimate);
+}
+
+void StatsAggregators::Distinct::PrintValue(std::ostream& out) const {
+  out << "Distinct is " << Estimate();
+}
+
+StatsAggregators::ApproxMode::ApproxMode(size_t capacity) : capacity(capacity) {
+  heap.reserve(capacity);
+  position.reserve(capacity);
+}
+
+void StatsAggregators::ApproxMode::Process(int value) {
+  if (auto it = position.find(value); it != position.end()) {
+    ++heap[it->second].count;
+    SiftDown(it->second);
+  } else if (heap.size() < capacity) {
+    heap.push_back({1, value});
+    position[value] = heap.size() - 1;
+    SiftUp(heap.size() - 1);
+  } else {
+    position.erase(heap[0].value);
+    heap[0] = {heap[0].count + 1, value};
+    position[value] = 0;
+    SiftDown(0);
+  }
+}
+
+void StatsAggregators::ApproxMode::Merge(const StatsAggregator& other) {
+  const auto& rhs = dynamic_cast<const ApproxMode&>(other);
+  // Значение, не попавшее в заполненную таблицу, встречалось там не чаще её
+  // минимума: добавляя минимум, сохраняем оценки сверху
+  const int64_t own_floor = heap.size() == capacity ? heap[0].count : 0;
+  const int64_t rhs_floor = rhs.heap.size() == rhs.capacity ? rhs.heap[0].count : 0;
+
+  vector<Counter> merged;
+  merged.reserve(heap.size() + rhs.heap.size());
+  for (const Counter& counter : heap) {
+    const int64_t rhs_count = rhs.EstimateCount(counter.value);
+    merged.push_back({counter.count + (rhs_count > 0 ? rhs_count : rhs_floor), counter.value});
+  }
+  for (const Counter& counter : rhs.heap) {
+    if (!position.count(counter.value)) {
+      merged.push_back({counter.count + own_floor, counter.value});
+    }
+  }
+
+  auto by_count_desc = [](const Counter& first, const Counter& second) {
+    return first.count > second.count;
+  };
+  if (merged.size() > capacity) {
+    nth_element(merged.begin(), merged.begin() + capacity, merged.end(), by_count_desc);
+    merged.resize(capacity);
+  }
+  // Массив, отсортированный по возрастанию, уже является минимальной кучей
+  sort(merged.begin(), merged.end(), [](const Counter& first, const Counter& second) {
+    return first.count < second.count;
+  });
+
+  heap = move(merged);
+  position.clear();
+  for (size_t i = 0; i < heap.size(); ++i) {
+    position[heap[i].value] = i;
+  }
+}
+
+void StatsAggregators::ApproxMode::PrintValue(std::ostream& out) const {
+  out << "Approximate mode is ";
+  if (heap.empty()) {
+    out << "undefined";
+    return;
+  }
+  auto best = max_element(heap.begin(), heap.end(), [](const Counter& lhs, const Counter& rhs) {
+    return lhs.count < rhs.count || (lhs.count == rhs.count && lhs.value > rhs.value);
+  });
+  out << best->value;
+}
+
+int64_t StatsAggregators::ApproxMode::EstimateCount(int value) const {
+  auto it = position.find(value);
+  return it == position.end() ? 0 : heap[it->second].count;
+}
+
+void StatsAggregators::ApproxMode::SiftDown(size_t index) {
+  for (;;) {
+    size_t smallest = index;
+    for (size_t child : {2 * index + 1, 2 * index + 2}) {
+      if (child < heap.size() && heap[child].count < heap[smallest].count) {
+        smallest = child;
+      }
+    }
+    if (smallest == index) {
+      return;
+    }
+    Swap(index, smallest);
+    index = smallest;
+  }
+}
+
+void StatsAggregators::ApproxMode::SiftUp(size_t index) {
+  while (index > 0 && heap[index].count < heap[(index - 1) / 2].count) {
+    Swap(index, (index - 1) / 2);
+    index = (index - 1) / 2;
+  }
+}
+
+void StatsAggregators::ApproxMode::Swap(size_t lhs, size_t rhs) {
+  swap(heap[lhs], heap[rhs]);
+  position[heap[lhs].value] = lhs;
+  position[heap[rhs].value] = rhs;
+}
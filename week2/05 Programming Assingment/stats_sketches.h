@@ -0,0 +1,126 @@
+#pragma once
+
+#include "stats_aggregator.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Приближённые агрегаторы с ограниченной памятью. В отличие от Mode их
+// состояние не растёт с числом различных значений, и все они поддерживают Merge
+namespace StatsAggregators {
+
+    // KLL-скетч квантилей: уровень h хранит значения весом 2^h. Переполненный
+    // уровень сортируется, и каждое второе значение поднимается выше.
+    // Ошибка ранга порядка 1.7 / k, память O(k)
+    class KllSketch {
+    public:
+        explicit KllSketch(int k = 200);
+
+        void Add(int value);
+
+        void Merge(const KllSketch &other);
+
+        // Значение ранга q * Count(); скетч должен быть непустым
+        int Quantile(double q) const;
+
+        int64_t Count() const;
+
+        size_t RetainedItems() const;
+
+    private:
+        int k;
+        int64_t count = 0;
+        std::vector<std::vector<int>> levels;
+        uint64_t random_state = 0x9E3779B97F4A7C15ull;
+
+        size_t Capacity(size_t level) const;
+
+        void Compress();
+    };
+
+    class Quantile final : public StatsAggregator {
+    public:
+        // label печатается перед значением: "Median", "P90"
+        Quantile(double q, std::string label);
+
+        using StatsAggregator::Process;
+
+        void Process(int value) override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+    private:
+        double q;
+        std::string label;
+        KllSketch sketch;
+    };
+
+    // HyperLogLog с 2^14 регистрами: около 16 КБ и 0.8% стандартной ошибки
+    class Distinct final : public StatsAggregator {
+    public:
+        using StatsAggregator::Process;
+
+        void Process(int value) override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+        int64_t Estimate() const;
+
+    private:
+        static constexpr int precision = 14;
+
+        std::array<uint8_t, 1 << precision> registers{};
+    };
+
+    // Space-Saving: не больше capacity счётчиков, при промахе вытесняется
+    // минимальный, и его значение наследует новый элемент. Значения с
+    // частотой больше n / capacity гарантированно остаются в таблице
+    class ApproxMode final : public StatsAggregator {
+    public:
+        explicit ApproxMode(size_t capacity = 1024);
+
+        using StatsAggregator::Process;
+
+        void Process(int value) override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+        // Оценка частоты сверху; 0, если значение не отслеживается
+        int64_t EstimateCount(int value) const;
+
+    private:
+        struct Counter {
+            int64_t count;
+            int value;
+        };
+
+        size_t capacity;
+        // Минимальная куча по count и позиция каждого значения в ней
+        std::vector<Counter> heap;
+        std::unordered_map<int, size_t> position;
+
+        void SiftDown(size_t index);
+
+        void SiftUp(size_t index);
+
+        void Swap(size_t lhs, size_t rhs);
+    };
+
+    void TestKllSketch();
+
+    void TestQuantile();
+
+    void TestDistinct();
+
+    void TestApproxMode();
+
+}
@@ -0,0 +1,200 @@
+#include "stats_windows.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+  void PrintOptional(ostream& out, const optional<int>& value) {
+    if (value) {
+      out << *value;
+    } else {
+      out << "undefined";
+    }
+  }
+
+  // length / bucket_count с округлением вверх. Подбирать делитель length
+  // нельзя: для простой длины он вырождается в корзины по 1 мс
+  chrono::milliseconds BucketWidth(chrono::milliseconds length, size_t bucket_count) {
+    const auto count = static_cast<chrono::milliseconds::rep>(max<size_t>(bucket_count, 1));
+    return chrono::milliseconds((length.count() + count - 1) / count);
+  }
+
+}
+
+StatsAggregators::RingBuffer::RingBuffer(size_t capacity) : values(max<size_t>(capacity, 1)) {
+}
+
+optional<int> StatsAggregators::RingBuffer::Push(int value) {
+  optional<int> evicted;
+  if (size == values.size()) {
+    evicted = values[next];
+  } else {
+    ++size;
+  }
+  values[next] = value;
+  next = (next + 1) % values.size();
+  return evicted;
+}
+
+size_t StatsAggregators::RingBuffer::Size() const {
+  return size;
+}
+
+size_t StatsAggregators::RingBuffer::Capacity() const {
+  return values.size();
+}
+
+StatsAggregators::WindowSum::WindowSum(size_t length) : window(length) {
+}
+
+void StatsAggregators::WindowSum::Process(int value) {
+  if (auto evicted = window.Push(value)) {
+    sum -= *evicted;
+  }
+  sum += value;
+}
+
+void StatsAggregators::WindowSum::Merge(const StatsAggregator& other) {
+  dynamic_cast<const WindowSum&>(other).window.ForEach([this](int value) {
+    Process(value);
+  });
+}
+
+void StatsAggregators::WindowSum::PrintValue(std::ostream& out) const {
+  out << "Last " << window.Capacity() << ": Sum is " << sum;
+}
+
+StatsAggregators::WindowAverage::WindowAverage(size_t length) : window(length) {
+}
+
+void StatsAggregators::WindowAverage::Process(int value) {
+  if (auto evicted = window.Push(value)) {
+    sum -= *evicted;
+  }
+  sum += value;
+}
+
+void StatsAggregators::WindowAverage::Merge(const StatsAggregator& other) {
+  dynamic_cast<const WindowAverage&>(other).window.ForEach([this](int value) {
+    Process(value);
+  });
+}
+
+void StatsAggregators::WindowAverage::PrintValue(std::ostream& out) const {
+  out << "Last " << window.Capacity() << ": Average is ";
+  if (window.Size() == 0) {
+    out << "undefined";
+  } else {
+    out << sum / static_cast<int64_t>(window.Size());
+  }
+}
+
+void StatsAggregators::WindowMin::PrintValue(std::ostream& out) const {
+  out << "Last " << Length() << ": Min is ";
+  PrintOptional(out, Value());
+}
+
+void StatsAggregators::WindowMax::PrintValue(std::ostream& out) const {
+  out << "Last " << Length() << ": Max is ";
+  PrintOptional(out, Value());
+}
+
+StatsAggregators::WindowMode::WindowMode(size_t length) : window(length) {
+}
+
+void StatsAggregators::WindowMode::Process(int value) {
+  window.Push(value);
+}
+
+void StatsAggregators::WindowMode::Merge(const StatsAggregator& other) {
+  dynamic_cast<const WindowMode&>(other).window.ForEach([this](int value) {
+    Process(value);
+  });
+}
+
+void StatsAggregators::WindowMode::PrintValue(std::ostream& out) const {
+  Mode mode;
+  window.ForEach([&mode](int value) {
+    mode.Process(value);
+  });
+  out << "Last " << window.Capacity() << ": ";
+  mode.PrintValue(out);
+}
+
+StatsAggregators::TimeWindow::TimeWindow(
+    Factory factory, std::chrono::milliseconds length, size_t bucket_count, Clock clock
+)
+    : factory(move(factory))
+    , length(max(length, chrono::milliseconds(1)))
+    , bucket_width(BucketWidth(this->length, bucket_count))
+    , clock(move(clock))
+    , buckets(static_cast<size_t>((this->length + bucket_width - chrono::milliseconds(1)) / bucket_width)) {
+}
+
+void StatsAggregators::TimeWindow::Process(int value) {
+  CurrentBucket()->Process(value);
+}
+
+void StatsAggregators::TimeWindow::Process(std::span<const int> values) {
+  CurrentBucket()->Process(values);
+}
+
+void StatsAggregators::TimeWindow::Merge(const StatsAggregator& other) {
+  const auto& rhs = dynamic_cast<const TimeWindow&>(other);
+  for (const Bucket& bucket : rhs.buckets) {
+    if (bucket.id < 0) {
+      continue;
+    }
+    if (StatsAggregator* target = BucketFor(bucket.id)) {
+      target->Merge(*bucket.aggr);
+    }
+  }
+}
+
+void StatsAggregators::TimeWindow::PrintValue(std::ostream& out) const {
+  const int64_t now = CurrentId();
+  const int64_t bucket_count = static_cast<int64_t>(buckets.size());
+
+  auto merged = factory();
+  for (int64_t id = now - bucket_count + 1; id <= now; ++id) {
+    const Bucket& bucket = buckets[static_cast<size_t>(id % bucket_count)];
+    if (bucket.id == id) {
+      merged->Merge(*bucket.aggr);
+    }
+  }
+
+  out << "Last ";
+  if (length.count() % 1000 == 0) {
+    out << length.count() / 1000 << "s";
+  } else {
+    out << length.count() << "ms";
+  }
+  out << ": ";
+  merged->PrintValue(out);
+}
+
+int64_t StatsAggregators::TimeWindow::CurrentId() const {
+  return chrono::duration_cast<chrono::milliseconds>(clock().time_since_epoch()) / bucket_width;
+}
+
+StatsAggregator* StatsAggregators::TimeWindow::CurrentBucket() {
+  const int64_t id = CurrentId();
+  if (StatsAggregator* bucket = BucketFor(id)) {
+    return bucket;
+  }
+  return buckets[static_cast<size_t>(id % static_cast<int64_t>(buckets.size()))].aggr.get();
+}
+
+StatsAggregator* StatsAggregators::TimeWindow::BucketFor(int64_t id) {
+  Bucket& bucket = buckets[static_cast<size_t>(id % static_cast<int64_t>(buckets.size()))];
+  if (bucket.id > id) {
+    return nullptr;
+  }
+  if (bucket.id < id) {
+    bucket.id = id;
+    bucket.aggr = factory();
+  }
+  return bucket.aggr.get();
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "stats_aggregator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Агрегаторы по скользящему окну: последние N значений или последние T
+// секунд потока. Обновление за амортизированное O(1) на значение
+namespace StatsAggregators {
+
+    // Последние capacity значений в порядке поступления
+    class RingBuffer {
+    public:
+        explicit RingBuffer(size_t capacity);
+
+        // Добавляет значение и возвращает вытесненное, если буфер был полон
+        std::optional<int> Push(int value);
+
+        size_t Size() const;
+
+        size_t Capacity() const;
+
+        // Вызывает f для значений от самого старого к самому новому
+        template <typename F>
+        void ForEach(F f) const {
+            const size_t start = size < values.size() ? 0 : next;
+            for (size_t i = 0; i < size; ++i) {
+                f(values[(start + i) % values.size()]);
+            }
+        }
+
+    private:
+        std::vector<int> values;
+        size_t next = 0;
+        size_t size = 0;
+    };
+
+    class WindowSum final : public StatsAggregator {
+    public:
+        explicit WindowSum(size_t length);
+
+        using StatsAggregator::Process;
+
+        void Process(int value) override;
+
+        // Окно последних значений потока rhs вытесняет наше, поэтому
+        // достаточно проиграть сохранённые в нём значения
+        void Merge(const StatsAggregator &other) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+    private:
+        RingBuffer window;
+        int64_t sum = 0;
+    };
+
+    class WindowAverage final : public StatsAggregator {
+    public:
+        explicit WindowAverage(size_t length);
+
+        using StatsAggregator::Process;
+
+        void Process(int value) override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+    private:
+        RingBuffer window;
+        int64_t sum = 0;
+    };
+
+    // Монотонная очередь: хранит только значения, которые ещё могут стать
+    // экстремумом окна, то есть не перекрытые более новым и не худшим.
+    // Окно нулевой длины, как и в RingBuffer, считается окном длины 1
+    template <typename Compare>
+    class WindowExtremum : public StatsAggregator {
+    public:
+        explicit WindowExtremum(size_t length) : length(std::max<size_t>(length, 1)) {
+        }
+
+        using StatsAggregator::Process;
+
+        void Process(int value) override {
+            Push(processed++, value);
+        }
+
+        // Кандидаты rhs - подпоследовательность его окна, содержащая экстремум
+        // любого его суффикса, поэтому их достаточно протолкнуть через нашу очередь
+        void Merge(const StatsAggregator &other) override {
+            const auto &rhs = dynamic_cast<const WindowExtremum &>(other);
+            for (const auto &[position, value] : rhs.candidates) {
+                Push(processed + position, value);
+            }
+            processed += rhs.processed;
+        }
+
+        std::optional<int> Value() const {
+            if (candidates.empty()) {
+                return std::nullopt;
+            }
+            return candidates.front().second;
+        }
+
+    protected:
+        size_t Length() const {
+            return length;
+        }
+
+    private:
+        size_t length;
+        int64_t processed = 0;
+        std::deque<std::pair<int64_t, int>> candidates;
+
+        void Push(int64_t position, int value) {
+            while (!candidates.empty() && !Compare()(candidates.back().second, value)) {
+                candidates.pop_back();
+            }
+            candidates.emplace_back(position, value);
+            while (candidates.front().first + static_cast<int64_t>(length) <= position) {
+                candidates.pop_front();
+            }
+        }
+    };
+
+    class WindowMin final : public WindowExtremum<std::less<int>> {
+    public:
+        using WindowExtremum::WindowExtremum;
+
+        void PrintValue(std::ostream &out) const override;
+    };
+
+    class WindowMax final : public WindowExtremum<std::greater<int>> {
+    public:
+        using WindowExtremum::WindowExtremum;
+
+        void PrintValue(std::ostream &out) const override;
+    };
+
+    // Мода окна с той же трактовкой ничьих, что у Mode: при печати значения
+    // окна проигрываются в Mode, поэтому печать стоит O(N), а обновление O(1)
+    class WindowMode final : public StatsAggregator {
+    public:
+        explicit WindowMode(size_t length);
+
+        using StatsAggregator::Process;
+
+        void Process(int value) override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+    private:
+        RingBuffer window;
+    };
+
+    // Окно последних T по времени поверх любого агрегатора с Merge. Окно
+    // делится на корзины одинаковой ширины, в каждой свой экземпляр агрегатора;
+    // при печати живые корзины сливаются по порядку. Ширина корзины - T /
+    // bucket_count с округлением вверх, корзин не больше bucket_count. Окно
+    // покрывает целое число корзин, поэтому может быть длиннее T меньше
+    // чем на ширину корзины
+    class TimeWindow final : public StatsAggregator {
+    public:
+        using Clock = std::function<std::chrono::steady_clock::time_point()>;
+        using Factory = std::function<std::unique_ptr<StatsAggregator>()>;
+
+        TimeWindow(
+                Factory factory, std::chrono::milliseconds length, size_t bucket_count = 10,
+                Clock clock = std::chrono::steady_clock::now
+        );
+
+        void Process(int value) override;
+
+        // Время читается один раз на пачку
+        void Process(std::span<const int> values) override;
+
+        void Merge(const StatsAggregator &other) override;
+
+        void PrintValue(std::ostream &out) const override;
+
+    private:
+        struct Bucket {
+            int64_t id = -1;
+            std::unique_ptr<StatsAggregator> aggr;
+        };
+
+        Factory factory;
+        std::chrono::milliseconds length;
+        std::chrono::milliseconds bucket_width;
+        Clock clock;
+        std::vector<Bucket> buckets;
+
+        int64_t CurrentId() const;
+
+        // Корзина с номером id; устаревшее содержимое слота сбрасывается.
+        // nullptr, если слот уже занят более новой корзиной
+        StatsAggregator *BucketFor(int64_t id);
+
+        // Корзина для новых значений. Если слот текущей корзины занят более
+        // новой, пришедшей через Merge от окна с убежавшими вперёд часами,
+        // значения пишутся в неё, а не теряются
+        StatsAggregator *CurrentBucket();
+    };
+
+    void TestWindowCount();
+
+    void TestWindowMerge();
+
+    void TestTimeWindow();
+
+}
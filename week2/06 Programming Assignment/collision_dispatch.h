@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+template <typename... Types>
+struct TypeList {
+};
+
+// Двойная диспетчеризация через таблицу: для списка типов при компиляции
+// строится таблица N x N указателей на функции, и проверка пары стоит одного
+// косвенного вызова по индексу [id первого][id второго]. Для пары (A, B)
+// вызывается найденная через ADL функция CollidePair(const A&, const B&),
+// поэтому самой таблице новый тип требует только добавления в список и своей
+// перегрузки или общего шаблона CollidePair. Интерфейс базового класса, как
+// CollideWith у GameObject, при этом приходится расширять отдельно.
+//
+// Поддерживаются два способа хранения: объекты общего базового класса,
+// зарегистрированные через Register, и std::variant<Types...>. Базовый класс
+// номера типа не хранит: Register берёт его из статического типа объекта при
+// создании, и Handle держит номер рядом с указателем
+template <typename List>
+class CollisionDispatcher;
+
+template <typename... Types>
+class CollisionDispatcher<TypeList<Types...>> {
+public:
+  static constexpr size_t type_count = sizeof...(Types);
+
+  static_assert(type_count > 0 && type_count <= 255, "type id must fit into uint8_t");
+
+  using Variant = std::variant<Types...>;
+
+  template <typename T>
+  static constexpr uint8_t TypeIdOf() {
+    constexpr bool matches[] = {std::is_same_v<T, Types>...};
+    for (size_t i = 0; i < type_count; ++i) {
+      if (matches[i]) {
+        return static_cast<uint8_t>(i);
+      }
+    }
+    throw "type is not in the list";
+  }
+
+  // Объект общего базового класса с номером его конкретного типа
+  template <typename Base>
+  struct Handle {
+    uint8_t type_id;
+    const Base* object;
+  };
+
+  // Номер берётся из статического типа T, поэтому таблица никогда не
+  // приведёт объект к чужому типу
+  template <typename Base, typename T>
+  static Handle<Base> Register(const T& object) {
+    return {TypeIdOf<T>(), &object};
+  }
+
+  template <typename Base>
+  static bool Collide(Handle<Base> first, Handle<Base> second) {
+    static constexpr auto table = MakeBaseTable<Base>(std::make_index_sequence<type_count * type_count>());
+    return table[first.type_id * type_count + second.type_id](*first.object, *second.object);
+  }
+
+  static bool Collide(const Variant& first, const Variant& second) {
+    static constexpr auto table = MakeVariantTable(std::make_index_sequence<type_count * type_count>());
+    return table[first.index() * type_count + second.index()](first, second);
+  }
+
+private:
+  template <size_t I>
+  using TypeAt = std::variant_alternative_t<I, Variant>;
+
+  template <typename Base, size_t I, size_t J>
+  static bool BaseEntry(const Base& first, const Base& second) {
+    return CollidePair(static_cast<const TypeAt<I>&>(first), static_cast<const TypeAt<J>&>(second));
+  }
+
+  template <size_t I, size_t J>
+  static bool VariantEntry(const Variant& first, const Variant& second) {
+    return CollidePair(*std::get_if<I>(&first), *std::get_if<J>(&second));
+  }
+
+  template <typename Base, size_t... K>
+  static constexpr auto MakeBaseTable(std::index_sequence<K...>) {
+    using Entry = bool (*)(const Base&, const Base&);
+    return std::array<Entry, sizeof...(K)>{&BaseEntry<Base, K / type_count, K % type_count>...};
+  }
+
+  template <size_t... K>
+  static constexpr auto MakeVariantTable(std::index_sequence<K...>) {
+    using Entry = bool (*)(const Variant&, const Variant&);
+    return std::array<Entry, sizeof...(K)>{&VariantEntry<K / type_count, K % type_count>...};
+  }
+};
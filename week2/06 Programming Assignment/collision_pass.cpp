@@ -0,0 +1,115 @@
+#include "collision_pass.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+using namespace std;
+
+struct CollisionPass::Frame {
+  const vector<unique_ptr<GameObject>>& world;
+  const vector<CandidatePair>& candidates;
+  size_t chunk_size;
+  size_t chunk_count;
+  vector<vector<CandidatePair>> chunk_results;
+  atomic<size_t> next_chunk{0};
+};
+
+CollisionPass::CollisionPass(size_t thread_count, size_t chunk_size)
+  : chunk_size(chunk_size)
+{
+  if (chunk_size == 0) {
+    throw invalid_argument("CollisionPass: chunk size must be positive");
+  }
+  // Вызывающий поток тоже разбирает блоки, поэтому запускаем на один поток меньше
+  const size_t worker_count = max<size_t>(thread_count, 1) - 1;
+  workers.reserve(worker_count);
+  for (size_t i = 0; i < worker_count; ++i) {
+    workers.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+CollisionPass::~CollisionPass() {
+  {
+    lock_guard lock(mutex);
+    stopping = true;
+  }
+  frame_started.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+vector<CandidatePair> CollisionPass::CollidingPairs(
+  const vector<unique_ptr<GameObject>>& world,
+  const vector<CandidatePair>& candidates
+) {
+  const size_t chunk_count = (candidates.size() + chunk_size - 1) / chunk_size;
+  Frame current{world, candidates, chunk_size, chunk_count, vector<vector<CandidatePair>>(chunk_count)};
+
+  // Один блок быстрее разобрать самим, чем будить потоки
+  const bool parallel = !workers.empty() && chunk_count > 1;
+  if (parallel) {
+    {
+      lock_guard lock(mutex);
+      frame = &current;
+      ++frame_number;
+      busy_workers = workers.size();
+    }
+    frame_started.notify_all();
+  }
+  ProcessChunks(current);
+  if (parallel) {
+    unique_lock lock(mutex);
+    frame_finished.wait(lock, [this] { return busy_workers == 0; });
+    frame = nullptr;
+  }
+
+  size_t total = 0;
+  for (const auto& result : current.chunk_results) {
+    total += result.size();
+  }
+  vector<CandidatePair> colliding;
+  colliding.reserve(total);
+  for (const auto& result : current.chunk_results) {
+    colliding.insert(colliding.end(), result.begin(), result.end());
+  }
+  return colliding;
+}
+
+void CollisionPass::WorkerLoop() {
+  uint64_t seen_frame = 0;
+  for (;;) {
+    Frame* current;
+    {
+      unique_lock lock(mutex);
+      frame_started.wait(lock, [&] { return stopping || frame_number != seen_frame; });
+      if (stopping) {
+        return;
+      }
+      seen_frame = frame_number;
+      current = frame;
+    }
+    ProcessChunks(*current);
+    {
+      lock_guard lock(mutex);
+      if (--busy_workers == 0) {
+        frame_finished.notify_one();
+      }
+    }
+  }
+}
+
+void CollisionPass::ProcessChunks(Frame& frame) {
+  for (size_t chunk; (chunk = frame.next_chunk.fetch_add(1, memory_order_relaxed)) < frame.chunk_count;) {
+    const size_t begin = chunk * frame.chunk_size;
+    const size_t end = min(frame.candidates.size(), begin + frame.chunk_size);
+    auto& result = frame.chunk_results[chunk];
+    for (size_t i = begin; i < end; ++i) {
+      const auto [first, second] = frame.candidates[i];
+      if (Collide(*frame.world[first], *frame.world[second])) {
+        result.push_back(frame.candidates[i]);
+      }
+    }
+  }
+}
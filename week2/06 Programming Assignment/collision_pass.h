@@ -0,0 +1,57 @@
+#pragma once
+
+#include "game_object.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Пара индексов объектов мира, отобранная широкой фазой для точной проверки
+using CandidatePair = std::pair<uint32_t, uint32_t>;
+
+// Узкая фаза кадра: CollidingPairs возвращает пары из candidates, для которых
+// Collide истинно, в том же порядке, что и во входном списке.
+// Список режется на блоки по chunk_size пар, потоки забирают очередной блок
+// атомарным счётчиком, так что освободившийся поток сразу берёт работу у
+// отстающих. Каждый блок пишет в свой буфер, буферы склеиваются по номерам
+// блоков без блокировок, и результат не зависит от числа потоков.
+//
+// Рабочие потоки создаются один раз в конструкторе и между кадрами спят на
+// условной переменной, так что кадр не платит за запуск потоков. Вызывающий
+// поток разбирает блоки вместе с ними. Кадры одного объекта идут по очереди:
+// CollidingPairs нельзя вызывать из нескольких потоков одновременно
+class CollisionPass {
+public:
+  explicit CollisionPass(size_t thread_count, size_t chunk_size = 1024);
+  ~CollisionPass();
+
+  CollisionPass(const CollisionPass&) = delete;
+  CollisionPass& operator=(const CollisionPass&) = delete;
+
+  std::vector<CandidatePair> CollidingPairs(
+    const std::vector<std::unique_ptr<GameObject>>& world,
+    const std::vector<CandidatePair>& candidates
+  );
+
+private:
+  struct Frame;
+
+  size_t chunk_size;
+  std::vector<std::thread> workers;
+
+  std::mutex mutex;
+  std::condition_variable frame_started;
+  std::condition_variable frame_finished;
+  Frame* frame = nullptr;
+  uint64_t frame_number = 0;
+  size_t busy_workers = 0;
+  bool stopping = false;
+
+  void WorkerLoop();
+  static void ProcessChunks(Frame& frame);
+};
@@ -0,0 +1,177 @@
+#include "collision_world.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+  int64_t FloorDiv(int64_t value, int64_t divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+  }
+
+  void EraseId(vector<CollisionWorld::Id>& ids, CollisionWorld::Id id) {
+    auto it = find(ids.begin(), ids.end(), id);
+    *it = ids.back();
+    ids.pop_back();
+  }
+
+}
+
+uint64_t CollisionWorld::CellRange::CellCount() const {
+  return static_cast<uint64_t>(x_max - x_min + 1) * static_cast<uint64_t>(y_max - y_min + 1);
+}
+
+CollisionWorld::CollisionWorld(int cell_size, size_t large_object_cells)
+  : cell_size(cell_size)
+  , large_object_cells(large_object_cells)
+{
+  if (cell_size <= 0) {
+    throw invalid_argument("CollisionWorld: cell size must be positive");
+  }
+}
+
+void CollisionWorld::Reserve(size_t object_count) {
+  entries.reserve(object_count);
+  // Объект размером около ячейки задевает в среднем две-четыре ячейки, часть из них общие
+  cells.reserve(2 * object_count);
+}
+
+CollisionWorld::Id CollisionWorld::Insert(shared_ptr<const GameObject> object, const geo2d::Rectangle& box) {
+  Id id;
+  if (!free_ids.empty()) {
+    id = free_ids.back();
+    free_ids.pop_back();
+  } else {
+    id = static_cast<Id>(entries.size());
+    entries.emplace_back();
+  }
+
+  const CellRange range = CellsOf(box);
+  entries[id] = Entry{move(object), box, range, range.CellCount() > large_object_cells};
+  Link(id);
+  ++size;
+  return id;
+}
+
+void CollisionWorld::Move(Id id, shared_ptr<const GameObject> object, const geo2d::Rectangle& box) {
+  Entry& entry = entries.at(id).value();
+  const CellRange range = CellsOf(box);
+  const bool large = range.CellCount() > large_object_cells;
+
+  // Сдвиг внутри тех же ячеек - частый случай, списки ячеек не трогаем
+  const bool same_cells = large == entry.large && (large || (
+    range.x_min == entry.cells.x_min && range.x_max == entry.cells.x_max &&
+    range.y_min == entry.cells.y_min && range.y_max == entry.cells.y_max
+  ));
+  if (!same_cells) {
+    Unlink(id);
+  }
+  entry.object = move(object);
+  entry.box = box;
+  entry.cells = range;
+  entry.large = large;
+  if (!same_cells) {
+    Link(id);
+  }
+}
+
+void CollisionWorld::Remove(Id id) {
+  if (!entries.at(id)) {
+    throw out_of_range("CollisionWorld: no object with this id");
+  }
+  Unlink(id);
+  entries[id].reset();
+  free_ids.push_back(id);
+  --size;
+}
+
+bool CollisionWorld::AnyCollision(const GameObject& object, const geo2d::Rectangle& box) const {
+  for (Id id : large_objects) {
+    if (Collides(*entries[id], box, object)) {
+      return true;
+    }
+  }
+
+  const CellRange range = CellsOf(box);
+  if (range.CellCount() > cells.size()) {
+    // Запрос шире заселённой части мира: дешевле перебрать объекты
+    for (const auto& entry : entries) {
+      if (entry && !entry->large && Collides(*entry, box, object)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  for (int64_t x = range.x_min; x <= range.x_max; ++x) {
+    for (int64_t y = range.y_min; y <= range.y_max; ++y) {
+      auto cell = cells.find(CellKey(x, y));
+      if (cell == cells.end()) {
+        continue;
+      }
+      for (Id id : cell->second) {
+        const Entry& entry = *entries[id];
+        // Объект из нескольких ячеек проверяем только в первой общей с запросом
+        // ячейке, так обходимся без отметок о посещении
+        if (x != max(range.x_min, entry.cells.x_min) || y != max(range.y_min, entry.cells.y_min)) {
+          continue;
+        }
+        if (Collides(entry, box, object)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+size_t CollisionWorld::Size() const {
+  return size;
+}
+
+CollisionWorld::CellRange CollisionWorld::CellsOf(const geo2d::Rectangle& box) const {
+  return {
+    FloorDiv(box.Left(), cell_size), FloorDiv(box.Bottom(), cell_size),
+    FloorDiv(box.Right(), cell_size), FloorDiv(box.Top(), cell_size)
+  };
+}
+
+uint64_t CollisionWorld::CellKey(int64_t x, int64_t y) {
+  return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+
+void CollisionWorld::Link(Id id) {
+  const Entry& entry = *entries[id];
+  if (entry.large) {
+    large_objects.push_back(id);
+    return;
+  }
+  for (int64_t x = entry.cells.x_min; x <= entry.cells.x_max; ++x) {
+    for (int64_t y = entry.cells.y_min; y <= entry.cells.y_max; ++y) {
+      cells[CellKey(x, y)].push_back(id);
+    }
+  }
+}
+
+void CollisionWorld::Unlink(Id id) {
+  const Entry& entry = *entries[id];
+  if (entry.large) {
+    EraseId(large_objects, id);
+    return;
+  }
+  for (int64_t x = entry.cells.x_min; x <= entry.cells.x_max; ++x) {
+    for (int64_t y = entry.cells.y_min; y <= entry.cells.y_max; ++y) {
+      auto cell = cells.find(CellKey(x, y));
+      EraseId(cell->second, id);
+      if (cell->second.empty()) {
+        cells.erase(cell);
+      }
+    }
+  }
+}
+
+bool CollisionWorld::Collides(const Entry& entry, const geo2d::Rectangle& box, const GameObject& object) const {
+  return geo2d::Collide(entry.box, box) && Collide(*entry.object, object);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "game_object.h"
+#include "geo2d.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Широкая фаза поиска столкновений: равномерная сетка ячеек cell_size x cell_size.
+// Объект регистрируется во всех ячейках, которые задевает его охватывающий
+// прямоугольник, и точный Collide вызывается только для объектов из ячеек
+// запроса. Объекты, задевающие больше large_object_cells ячеек, хранятся
+// отдельным списком и проверяются при каждом запросе.
+//
+// Интерфейс GameObject геометрии не раскрывает, поэтому охватывающий
+// прямоугольник передаёт вызывающий код при вставке, перемещении и запросе
+class CollisionWorld {
+public:
+  using Id = uint32_t;
+
+  explicit CollisionWorld(int cell_size = 128, size_t large_object_cells = 64);
+
+  // Резервирует место под object_count объектов, чтобы вставка не перестраивала таблицу ячеек
+  void Reserve(size_t object_count);
+
+  Id Insert(std::shared_ptr<const GameObject> object, const geo2d::Rectangle& box);
+
+  // Заменяет объект с данным id на новый, например, на тот же юнит в новой позиции
+  void Move(Id id, std::shared_ptr<const GameObject> object, const geo2d::Rectangle& box);
+
+  void Remove(Id id);
+
+  // Сталкивается ли object хотя бы с одним объектом мира.
+  // Запросы не меняют состояние, их можно выполнять из нескольких потоков
+  bool AnyCollision(const GameObject& object, const geo2d::Rectangle& box) const;
+
+  size_t Size() const;
+
+private:
+  struct CellRange {
+    int64_t x_min, y_min, x_max, y_max;
+
+    uint64_t CellCount() const;
+  };
+
+  struct Entry {
+    std::shared_ptr<const GameObject> object;
+    geo2d::Rectangle box;
+    CellRange cells;
+    bool large;
+  };
+
+  int cell_size;
+  size_t large_object_cells;
+  std::vector<std::optional<Entry>> entries;
+  std::vector<Id> free_ids;
+  size_t size = 0;
+  std::unordered_map<uint64_t, std::vector<Id>> cells;
+  std::vector<Id> large_objects;
+
+  CellRange CellsOf(const geo2d::Rectangle& box) const;
+  static uint64_t CellKey(int64_t x, int64_t y);
+
+  void Link(Id id);
+  void Unlink(Id id);
+
+  bool Collides(const Entry& entry, const geo2d::Rectangle& box, const GameObject& object) const;
+};
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 namespace geo2d {
 
@@ -18,7 +19,7 @@ T Sqr(T x) { return x * x; }
 
 template <typename T>
 T Sign(T x) {
-  return x != 0 ? x / abs(x) : 0;
+  return x != 0 ? x / std::abs(x) : 0;
 }
 
 uint64_t DistanceSquared(Point p1, Point p2) {
@@ -39,11 +40,40 @@ int64_t ScalarProduct(Vector lhs, Vector rhs) {
   return static_cast<int64_t>(lhs.x) * rhs.x + static_cast<int64_t>(lhs.y) * rhs.y;
 }
 
+Rectangle BoundingBox(Point p) {
+  return {p, p};
+}
+
+Rectangle BoundingBox(Segment s) {
+  return {s.p1, s.p2};
+}
+
+Rectangle BoundingBox(Rectangle r) {
+  return r;
+}
+
+Rectangle BoundingBox(Circle c) {
+  auto clamp = [](int64_t value) {
+    return static_cast<int>(std::clamp<int64_t>(
+      value, std::numeric_limits<int>::min(), std::numeric_limits<int>::max()
+    ));
+  };
+  return {
+    {clamp(int64_t{c.center.x} - c.radius), clamp(int64_t{c.center.y} - c.radius)},
+    {clamp(int64_t{c.center.x} + c.radius), clamp(int64_t{c.center.y} + c.radius)}
+  };
+}
+
 bool Collide(Point p, Point q) {
   return p.x == q.x && p.y == q.y;
 }
 
 bool Collide(Point p, Segment s) {
+  // У отрезка нулевой длины все скалярные и векторные произведения ниже нулевые
+  if (Collide(s.p1, s.p2)) {
+    return Collide(p, s.p1);
+  }
+
   const Vector v1{s.p1, p};
   const Vector v2{s.p2, p};
 
@@ -111,6 +141,9 @@ bool Collide(Segment s, Circle c) { return Collide(c, s); }
 bool Collide(Circle c, Point p) { return Collide(p, c); }
 bool Collide(Circle c, Rectangle r) { return Collide(r, c); }
 bool Collide(Circle c, Segment s) {
+  if (Collide(s.p1, s.p2)) {
+    return Collide(s.p1, c);
+  }
   if (
     ScalarProduct(Vector{s.p1, s.p2}, Vector{s.p1, c.center}) >= 0 &&
     ScalarProduct(Vector{s.p2, s.p1}, Vector{s.p2, c.center}) >= 0
@@ -123,7 +156,7 @@ bool Collide(Circle c, Segment s) {
     // проведённая из c.center, равна 2S / |s.p1, s.p2|. Чтобы остаться в целых
     // числах, возведём сравниваемые величины в квадрат и сравним (2S)^ 2 с
     // R^2 * |s.p1, s.p2|^2
-    uint64_t double_triangle_square = abs(Vector{s.p1, s.p2} * Vector{s.p1, c.center});
+    uint64_t double_triangle_square = std::abs(Vector{s.p1, s.p2} * Vector{s.p1, c.center});
     return Sqr(double_triangle_square) <= Sqr<uint64_t>(c.radius) * DistanceSquared(s.p1, s.p2);
   } else {
     auto d = std::min(DistanceSquared(c.center, s.p1), DistanceSquared(c.center, s.p2));
@@ -51,6 +51,12 @@ struct Circle {
   uint32_t radius;
 };
 
+// Наименьший прямоугольник со сторонами вдоль осей, содержащий фигуру
+Rectangle BoundingBox(Point p);
+Rectangle BoundingBox(Segment s);
+Rectangle BoundingBox(Rectangle r);
+Rectangle BoundingBox(Circle c);
+
 bool Collide(Point p, Point q);
 bool Collide(Point p, Segment s);
 bool Collide(Point p, Rectangle r);
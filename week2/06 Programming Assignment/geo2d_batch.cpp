@@ -0,0 +1,418 @@
+#include "geo2d_batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GEO2D_BATCH_X86
+#include <immintrin.h>
+#endif
+
+namespace geo2d {
+
+void Points::Add(Point p) {
+  x.push_back(p.x);
+  y.push_back(p.y);
+}
+
+void Segments::Add(Segment s) {
+  x1.push_back(s.p1.x);
+  y1.push_back(s.p1.y);
+  x2.push_back(s.p2.x);
+  y2.push_back(s.p2.y);
+}
+
+void Rectangles::Add(Rectangle r) {
+  left.push_back(r.Left());
+  right.push_back(r.Right());
+  bottom.push_back(r.Bottom());
+  top.push_back(r.Top());
+}
+
+void Circles::Add(Circle c) {
+  x.push_back(c.center.x);
+  y.push_back(c.center.y);
+  radius.push_back(c.radius);
+}
+
+namespace {
+
+template <typename Shape, typename Batch>
+CollisionMask CollideBatchScalar(Shape shape, const Batch& batch) {
+  CollisionMask result((batch.Size() + 63) / 64);
+  for (size_t i = 0; i < batch.Size(); ++i) {
+    result[i / 64] |= static_cast<uint64_t>(Collide(shape, batch[i])) << (i % 64);
+  }
+  return result;
+}
+
+#ifdef GEO2D_BATCH_X86
+
+#define GEO2D_AVX2 __attribute__((target("avx2")))
+
+// Четыре 64-битные дорожки. Координаты в них знаково расширены, радиусы -
+// беззнаково, а логическое значение - это дорожка из одних нулей или единиц.
+// Все формулы повторяют скалярные из geo2d.cpp с теми же типами: int64 для
+// векторного и скалярного произведений, uint64 по модулю 2^64 для квадратов
+using Lanes = __m256i;
+
+GEO2D_AVX2 Lanes Broadcast(int value) {
+  return _mm256_set1_epi64x(value);
+}
+
+GEO2D_AVX2 Lanes BroadcastRadius(uint32_t value) {
+  return _mm256_set1_epi64x(value);
+}
+
+GEO2D_AVX2 Lanes LoadCoordinates(const int* values) {
+  return _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+}
+
+GEO2D_AVX2 Lanes LoadRadii(const uint32_t* values) {
+  return _mm256_cvtepu32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+}
+
+GEO2D_AVX2 Lanes Zero() { return _mm256_setzero_si256(); }
+GEO2D_AVX2 Lanes Add(Lanes a, Lanes b) { return _mm256_add_epi64(a, b); }
+GEO2D_AVX2 Lanes Sub(Lanes a, Lanes b) { return _mm256_sub_epi64(a, b); }
+GEO2D_AVX2 Lanes And(Lanes a, Lanes b) { return _mm256_and_si256(a, b); }
+GEO2D_AVX2 Lanes Or(Lanes a, Lanes b) { return _mm256_or_si256(a, b); }
+GEO2D_AVX2 Lanes Not(Lanes a) { return _mm256_xor_si256(a, _mm256_set1_epi64x(-1)); }
+GEO2D_AVX2 Lanes Equal(Lanes a, Lanes b) { return _mm256_cmpeq_epi64(a, b); }
+GEO2D_AVX2 Lanes Greater(Lanes a, Lanes b) { return _mm256_cmpgt_epi64(a, b); }
+GEO2D_AVX2 Lanes LessOrEqual(Lanes a, Lanes b) { return Not(Greater(a, b)); }
+
+// AVX2 сравнивает только знаковые числа, беззнаковое сравнение получаем сдвигом на 2^63
+GEO2D_AVX2 Lanes UnsignedLessOrEqual(Lanes a, Lanes b) {
+  const Lanes flip = _mm256_set1_epi64x(INT64_MIN);
+  return LessOrEqual(_mm256_xor_si256(a, flip), _mm256_xor_si256(b, flip));
+}
+
+GEO2D_AVX2 Lanes Select(Lanes condition, Lanes if_true, Lanes if_false) {
+  return _mm256_blendv_epi8(if_false, if_true, condition);
+}
+
+GEO2D_AVX2 Lanes Min(Lanes a, Lanes b) { return Select(Greater(a, b), b, a); }
+GEO2D_AVX2 Lanes Max(Lanes a, Lanes b) { return Select(Greater(a, b), a, b); }
+
+GEO2D_AVX2 Lanes Abs(Lanes a) {
+  const Lanes negative = Greater(Zero(), a);
+  return Sub(_mm256_xor_si256(a, negative), negative);
+}
+
+// Произведение младших 32 бит дорожек со знаком, результат 64-битный
+GEO2D_AVX2 Lanes MulSigned32(Lanes a, Lanes b) { return _mm256_mul_epi32(a, b); }
+GEO2D_AVX2 Lanes MulUnsigned32(Lanes a, Lanes b) { return _mm256_mul_epu32(a, b); }
+
+// Младшие 64 бита произведения 64-битных чисел, как у uint64_t * uint64_t
+GEO2D_AVX2 Lanes MulLow64(Lanes a, Lanes b) {
+  const Lanes cross = Add(
+    MulUnsigned32(_mm256_srli_epi64(a, 32), b),
+    MulUnsigned32(a, _mm256_srli_epi64(b, 32))
+  );
+  return Add(MulUnsigned32(a, b), _mm256_slli_epi64(cross, 32));
+}
+
+GEO2D_AVX2 uint64_t MoveMask(Lanes mask) {
+  return static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(mask)));
+}
+
+struct PointLanes {
+  Lanes x, y;
+};
+
+struct VectorLanes {
+  Lanes x, y;
+};
+
+struct SegmentLanes {
+  PointLanes p1, p2;
+};
+
+struct RectangleLanes {
+  Lanes left, right, bottom, top;
+
+  GEO2D_AVX2 PointLanes BottomLeft() const { return {left, bottom}; }
+  GEO2D_AVX2 PointLanes BottomRight() const { return {right, bottom}; }
+  GEO2D_AVX2 PointLanes TopRight() const { return {right, top}; }
+  GEO2D_AVX2 PointLanes TopLeft() const { return {left, top}; }
+};
+
+struct CircleLanes {
+  PointLanes center;
+  Lanes radius;
+};
+
+GEO2D_AVX2 PointLanes Broadcast(Point p) {
+  return {Broadcast(p.x), Broadcast(p.y)};
+}
+
+GEO2D_AVX2 SegmentLanes Broadcast(Segment s) {
+  return {Broadcast(s.p1), Broadcast(s.p2)};
+}
+
+GEO2D_AVX2 RectangleLanes Broadcast(Rectangle r) {
+  return {Broadcast(r.Left()), Broadcast(r.Right()), Broadcast(r.Bottom()), Broadcast(r.Top())};
+}
+
+GEO2D_AVX2 CircleLanes Broadcast(Circle c) {
+  return {Broadcast(c.center), BroadcastRadius(c.radius)};
+}
+
+GEO2D_AVX2 PointLanes Load(const Points& batch, size_t i) {
+  return {LoadCoordinates(&batch.x[i]), LoadCoordinates(&batch.y[i])};
+}
+
+GEO2D_AVX2 SegmentLanes Load(const Segments& batch, size_t i) {
+  return {
+    {LoadCoordinates(&batch.x1[i]), LoadCoordinates(&batch.y1[i])},
+    {LoadCoordinates(&batch.x2[i]), LoadCoordinates(&batch.y2[i])}
+  };
+}
+
+GEO2D_AVX2 RectangleLanes Load(const Rectangles& batch, size_t i) {
+  return {
+    LoadCoordinates(&batch.left[i]), LoadCoordinates(&batch.right[i]),
+    LoadCoordinates(&batch.bottom[i]), LoadCoordinates(&batch.top[i])
+  };
+}
+
+GEO2D_AVX2 CircleLanes Load(const Circles& batch, size_t i) {
+  return {{LoadCoordinates(&batch.x[i]), LoadCoordinates(&batch.y[i])}, LoadRadii(&batch.radius[i])};
+}
+
+// Разности координат меньше 2^31 по модулю, поэтому перемножаются как 32-битные
+GEO2D_AVX2 VectorLanes MakeVector(PointLanes from, PointLanes to) {
+  return {Sub(to.x, from.x), Sub(to.y, from.y)};
+}
+
+GEO2D_AVX2 Lanes VectorProduct(VectorLanes lhs, VectorLanes rhs) {
+  return Sub(MulSigned32(lhs.x, rhs.y), MulSigned32(rhs.x, lhs.y));
+}
+
+GEO2D_AVX2 Lanes ScalarProduct(VectorLanes lhs, VectorLanes rhs) {
+  return Add(MulSigned32(lhs.x, rhs.x), MulSigned32(lhs.y, rhs.y));
+}
+
+GEO2D_AVX2 Lanes DistanceSquared(PointLanes p1, PointLanes p2) {
+  const VectorLanes diff = MakeVector(p2, p1);
+  return ScalarProduct(diff, diff);
+}
+
+GEO2D_AVX2 Lanes RadiusSquared(Lanes radius) {
+  return MulUnsigned32(radius, radius);
+}
+
+// Sign(a) * Sign(b) <= 0
+GEO2D_AVX2 Lanes SignsDiffer(Lanes a, Lanes b) {
+  const Lanes both_positive = And(Greater(a, Zero()), Greater(b, Zero()));
+  const Lanes both_negative = And(Greater(Zero(), a), Greater(Zero(), b));
+  return Not(Or(both_positive, both_negative));
+}
+
+GEO2D_AVX2 Lanes CollideLanes(PointLanes p, PointLanes q) {
+  return And(Equal(p.x, q.x), Equal(p.y, q.y));
+}
+
+GEO2D_AVX2 Lanes CollideLanes(PointLanes p, SegmentLanes s) {
+  const VectorLanes v1 = MakeVector(s.p1, p);
+  const VectorLanes v2 = MakeVector(s.p2, p);
+  const Lanes on_segment = And(
+    And(
+      LessOrEqual(Zero(), ScalarProduct(v1, MakeVector(s.p1, s.p2))),
+      LessOrEqual(Zero(), ScalarProduct(v2, MakeVector(s.p2, s.p1)))
+    ),
+    Equal(VectorProduct(v1, MakeVector(s.p1, s.p2)), Zero())
+  );
+  return Select(CollideLanes(s.p1, s.p2), CollideLanes(p, s.p1), on_segment);
+}
+
+GEO2D_AVX2 Lanes CollideLanes(PointLanes p, RectangleLanes r) {
+  return And(
+    And(LessOrEqual(r.left, p.x), LessOrEqual(p.x, r.right)),
+    And(LessOrEqual(r.bottom, p.y), LessOrEqual(p.y, r.top))
+  );
+}
+
+GEO2D_AVX2 Lanes CollideLanes(PointLanes p, CircleLanes c) {
+  return UnsignedLessOrEqual(DistanceSquared(p, c.center), RadiusSquared(c.radius));
+}
+
+// У прямоугольников left <= right и bottom <= top, поэтому сравнение
+// min(right) >= max(left) из Collide раскладывается на два сравнения
+GEO2D_AVX2 Lanes CollideLanes(RectangleLanes r1, RectangleLanes r2) {
+  return And(
+    And(LessOrEqual(r1.left, r2.right), LessOrEqual(r2.left, r1.right)),
+    And(LessOrEqual(r1.bottom, r2.top), LessOrEqual(r2.bottom, r1.top))
+  );
+}
+
+GEO2D_AVX2 Lanes CollideLanes(SegmentLanes s1, SegmentLanes s2) {
+  const RectangleLanes first_bounding_box{
+    Min(s1.p1.x, s1.p2.x), Max(s1.p1.x, s1.p2.x), Min(s1.p1.y, s1.p2.y), Max(s1.p1.y, s1.p2.y)
+  };
+  const RectangleLanes second_bounding_box{
+    Min(s2.p1.x, s2.p2.x), Max(s2.p1.x, s2.p2.x), Min(s2.p1.y, s2.p2.y), Max(s2.p1.y, s2.p2.y)
+  };
+
+  const VectorLanes v1 = MakeVector(s1.p1, s1.p2);
+  const VectorLanes v2 = MakeVector(s2.p1, s2.p2);
+
+  return And(
+    CollideLanes(first_bounding_box, second_bounding_box),
+    And(
+      SignsDiffer(VectorProduct(v1, MakeVector(s1.p1, s2.p1)), VectorProduct(v1, MakeVector(s1.p1, s2.p2))),
+      SignsDiffer(VectorProduct(v2, MakeVector(s2.p1, s1.p1)), VectorProduct(v2, MakeVector(s2.p1, s1.p2)))
+    )
+  );
+}
+
+GEO2D_AVX2 Lanes CollideLanes(CircleLanes c, SegmentLanes s) {
+  const Lanes radius_squared = RadiusSquared(c.radius);
+  const VectorLanes direction = MakeVector(s.p1, s.p2);
+
+  const Lanes projection_inside = And(
+    LessOrEqual(Zero(), ScalarProduct(direction, MakeVector(s.p1, c.center))),
+    LessOrEqual(Zero(), ScalarProduct(MakeVector(s.p2, s.p1), MakeVector(s.p2, c.center)))
+  );
+
+  // Квадраты считаются по модулю 2^64, как в скалярной версии
+  const Lanes double_triangle_square = Abs(VectorProduct(direction, MakeVector(s.p1, c.center)));
+  const Lanes height_collides = UnsignedLessOrEqual(
+    MulLow64(double_triangle_square, double_triangle_square),
+    MulLow64(radius_squared, DistanceSquared(s.p1, s.p2))
+  );
+
+  // Квадраты расстояний меньше 2^63, знаковый минимум совпадает с беззнаковым
+  const Lanes end_collides = UnsignedLessOrEqual(
+    Min(DistanceSquared(c.center, s.p1), DistanceSquared(c.center, s.p2)),
+    radius_squared
+  );
+
+  return Select(
+    CollideLanes(s.p1, s.p2),
+    CollideLanes(s.p1, c),
+    Select(projection_inside, height_collides, end_collides)
+  );
+}
+
+GEO2D_AVX2 Lanes CollideLanes(RectangleLanes r, SegmentLanes s) {
+  return Or(
+    Or(CollideLanes(s.p1, r), CollideLanes(s.p2, r)),
+    Or(
+      Or(CollideLanes(s, SegmentLanes{r.BottomLeft(), r.BottomRight()}),
+         CollideLanes(s, SegmentLanes{r.BottomRight(), r.TopRight()})),
+      Or(CollideLanes(s, SegmentLanes{r.TopRight(), r.TopLeft()}),
+         CollideLanes(s, SegmentLanes{r.TopLeft(), r.BottomLeft()}))
+    )
+  );
+}
+
+GEO2D_AVX2 Lanes CollideLanesByEdges(RectangleLanes r, CircleLanes c) {
+  return Or(
+    CollideLanes(c.center, r),
+    Or(
+      Or(CollideLanes(c, SegmentLanes{r.BottomLeft(), r.BottomRight()}),
+         CollideLanes(c, SegmentLanes{r.BottomRight(), r.TopRight()})),
+      Or(CollideLanes(c, SegmentLanes{r.TopRight(), r.TopLeft()}),
+         CollideLanes(c, SegmentLanes{r.TopLeft(), r.BottomLeft()}))
+    )
+  );
+}
+
+// Без переполнений проверка по сторонам равносильна сравнению расстояния от
+// центра до прямоугольника с радиусом. Переполнений нет, если наибольшая
+// сторона L, наибольшее удаление D сторон от центра по осям и радиус r дают
+// L * D < 2^31 и L * r < 2^32: тогда (2S)^2 < 2L^2 * D^2 < 2^63 и r^2 * L^2 < 2^64.
+// Четвёрку, где условие нарушено хотя бы в одной дорожке, проверяем по сторонам
+GEO2D_AVX2 Lanes CollideLanes(RectangleLanes r, CircleLanes c) {
+  const Lanes to_left = Sub(r.left, c.center.x);
+  const Lanes to_right = Sub(c.center.x, r.right);
+  const Lanes to_bottom = Sub(r.bottom, c.center.y);
+  const Lanes to_top = Sub(c.center.y, r.top);
+
+  const Lanes side = Max(Sub(r.right, r.left), Sub(r.top, r.bottom));
+  const Lanes reach = Max(Max(Abs(to_left), Abs(to_right)), Max(Abs(to_bottom), Abs(to_top)));
+  const Lanes exact = And(
+    Greater(_mm256_set1_epi64x(int64_t{1} << 31), MulUnsigned32(side, reach)),
+    Greater(_mm256_set1_epi64x(int64_t{1} << 32), MulUnsigned32(side, c.radius))
+  );
+  if (MoveMask(exact) != 0xF) {
+    return CollideLanesByEdges(r, c);
+  }
+
+  const Lanes dx = Max(Max(to_left, to_right), Zero());
+  const Lanes dy = Max(Max(to_bottom, to_top), Zero());
+  return UnsignedLessOrEqual(Add(MulSigned32(dx, dx), MulSigned32(dy, dy)), RadiusSquared(c.radius));
+}
+
+// Сумма радиусов переполняется в uint32, как в скалярной версии
+GEO2D_AVX2 Lanes CollideLanes(CircleLanes c1, CircleLanes c2) {
+  const Lanes radius_sum = _mm256_and_si256(Add(c1.radius, c2.radius), _mm256_set1_epi64x(0xFFFFFFFF));
+  return UnsignedLessOrEqual(DistanceSquared(c1.center, c2.center), RadiusSquared(radius_sum));
+}
+
+GEO2D_AVX2 Lanes CollideLanes(SegmentLanes s, PointLanes p) { return CollideLanes(p, s); }
+GEO2D_AVX2 Lanes CollideLanes(RectangleLanes r, PointLanes p) { return CollideLanes(p, r); }
+GEO2D_AVX2 Lanes CollideLanes(CircleLanes c, PointLanes p) { return CollideLanes(p, c); }
+GEO2D_AVX2 Lanes CollideLanes(SegmentLanes s, RectangleLanes r) { return CollideLanes(r, s); }
+GEO2D_AVX2 Lanes CollideLanes(SegmentLanes s, CircleLanes c) { return CollideLanes(c, s); }
+GEO2D_AVX2 Lanes CollideLanes(CircleLanes c, RectangleLanes r) { return CollideLanes(r, c); }
+
+template <typename Shape, typename Batch>
+GEO2D_AVX2 CollisionMask CollideBatchAvx2(Shape shape, const Batch& batch) {
+  const size_t n = batch.Size();
+  CollisionMask result((n + 63) / 64);
+  const auto lanes = Broadcast(shape);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    result[i / 64] |= MoveMask(CollideLanes(lanes, Load(batch, i))) << (i % 64);
+  }
+  for (; i < n; ++i) {
+    result[i / 64] |= static_cast<uint64_t>(Collide(shape, batch[i])) << (i % 64);
+  }
+  return result;
+}
+
+bool HasAvx2() {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+#endif
+
+template <typename Shape, typename Batch>
+CollisionMask CollideBatchBest(Shape shape, const Batch& batch) {
+#ifdef GEO2D_BATCH_X86
+  if (HasAvx2()) {
+    return CollideBatchAvx2(shape, batch);
+  }
+#endif
+  return CollideBatchScalar(shape, batch);
+}
+
+}
+
+CollisionMask CollideBatch(Point p, const Points& batch) { return CollideBatchBest(p, batch); }
+CollisionMask CollideBatch(Point p, const Segments& batch) { return CollideBatchBest(p, batch); }
+CollisionMask CollideBatch(Point p, const Rectangles& batch) { return CollideBatchBest(p, batch); }
+CollisionMask CollideBatch(Point p, const Circles& batch) { return CollideBatchBest(p, batch); }
+CollisionMask CollideBatch(Segment s, const Points& batch) { return CollideBatchBest(s, batch); }
+CollisionMask CollideBatch(Segment s, const Segments& batch) { return CollideBatchBest(s, batch); }
+CollisionMask CollideBatch(Segment s, const Rectangles& batch) { return CollideBatchBest(s, batch); }
+CollisionMask CollideBatch(Segment s, const Circles& batch) { return CollideBatchBest(s, batch); }
+CollisionMask CollideBatch(Rectangle r, const Points& batch) { return CollideBatchBest(r, batch); }
+CollisionMask CollideBatch(Rectangle r, const Segments& batch) { return CollideBatchBest(r, batch); }
+CollisionMask CollideBatch(Rectangle r, const Rectangles& batch) { return CollideBatchBest(r, batch); }
+CollisionMask CollideBatch(Rectangle r, const Circles& batch) { return CollideBatchBest(r, batch); }
+CollisionMask CollideBatch(Circle c, const Points& batch) { return CollideBatchBest(c, batch); }
+CollisionMask CollideBatch(Circle c, const Segments& batch) { return CollideBatchBest(c, batch); }
+CollisionMask CollideBatch(Circle c, const Rectangles& batch) { return CollideBatchBest(c, batch); }
+CollisionMask CollideBatch(Circle c, const Circles& batch) { return CollideBatchBest(c, batch); }
+
+bool CollideBatchVectorized() {
+#ifdef GEO2D_BATCH_X86
+  return HasAvx2();
+#else
+  return false;
+#endif
+}
+
+}
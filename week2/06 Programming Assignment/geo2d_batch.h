@@ -0,0 +1,78 @@
+#pragma once
+
+#include "geo2d.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace geo2d {
+
+// Наборы фигур в виде структуры массивов: каждая координата хранится в своём
+// массиве, и пакетная проверка читает четыре фигуры одной загрузкой
+struct Points {
+  std::vector<int> x, y;
+
+  void Add(Point p);
+  size_t Size() const { return x.size(); }
+  Point operator [] (size_t i) const { return {x[i], y[i]}; }
+};
+
+struct Segments {
+  std::vector<int> x1, y1, x2, y2;
+
+  void Add(Segment s);
+  size_t Size() const { return x1.size(); }
+  Segment operator [] (size_t i) const { return {{x1[i], y1[i]}, {x2[i], y2[i]}}; }
+};
+
+struct Rectangles {
+  std::vector<int> left, right, bottom, top;
+
+  void Add(Rectangle r);
+  size_t Size() const { return left.size(); }
+  Rectangle operator [] (size_t i) const { return {{left[i], bottom[i]}, {right[i], top[i]}}; }
+};
+
+struct Circles {
+  std::vector<int> x, y;
+  std::vector<uint32_t> radius;
+
+  void Add(Circle c);
+  size_t Size() const { return x.size(); }
+  Circle operator [] (size_t i) const { return {{x[i], y[i]}, radius[i]}; }
+};
+
+// Бит i % 64 слова i / 64 равен Collide(shape, batch[i]), лишние биты последнего слова нулевые
+using CollisionMask = std::vector<uint64_t>;
+
+inline bool TestBit(const CollisionMask& mask, size_t i) {
+  return (mask[i / 64] >> (i % 64)) & 1;
+}
+
+// Проверка одной фигуры против всего набора. На процессорах с AVX2 четыре
+// фигуры набора проверяются за раз в 64-битных дорожках, иначе вызывается
+// скалярный Collide. Результат совпадает с Collide бит в бит, включая
+// переполнения uint64 в проверках окружности, если модуль всех координат
+// меньше 2^30 - на этом же диапазоне разности координат в Collide помещаются в int
+CollisionMask CollideBatch(Point p, const Points& batch);
+CollisionMask CollideBatch(Point p, const Segments& batch);
+CollisionMask CollideBatch(Point p, const Rectangles& batch);
+CollisionMask CollideBatch(Point p, const Circles& batch);
+CollisionMask CollideBatch(Segment s, const Points& batch);
+CollisionMask CollideBatch(Segment s, const Segments& batch);
+CollisionMask CollideBatch(Segment s, const Rectangles& batch);
+CollisionMask CollideBatch(Segment s, const Circles& batch);
+CollisionMask CollideBatch(Rectangle r, const Points& batch);
+CollisionMask CollideBatch(Rectangle r, const Segments& batch);
+CollisionMask CollideBatch(Rectangle r, const Rectangles& batch);
+CollisionMask CollideBatch(Rectangle r, const Circles& batch);
+CollisionMask CollideBatch(Circle c, const Points& batch);
+CollisionMask CollideBatch(Circle c, const Segments& batch);
+CollisionMask CollideBatch(Circle c, const Rectangles& batch);
+CollisionMask CollideBatch(Circle c, const Circles& batch);
+
+// Использует ли CollideBatch векторную реализацию на этом процессоре
+bool CollideBatchVectorized();
+
+}
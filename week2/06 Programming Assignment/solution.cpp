@@ -1,13 +1,32 @@
 #include "geo2d.h"
+#include "geo2d_batch.h"
 #include "game_object.h"
+#include "collision_world.h"
+#include "collision_dispatch.h"
+#include "collision_pass.h"
 
 #include "test_runner.h"
+#include "profile.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <vector>
 #include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
 
 using namespace std;
 
+using ObjectTypes = TypeList<Unit, Building, Tower, Fence>;
+using ObjectDispatcher = CollisionDispatcher<ObjectTypes>;
+
 template <typename T>
 struct Collider : GameObject {
     bool Collide(const GameObject& that) const override {
@@ -138,6 +157,33 @@ DEFINE_METHOD_COLLIDE_WITH(Fence, Building)
 DEFINE_METHOD_COLLIDE_WITH(Fence, Tower)
 DEFINE_METHOD_COLLIDE_WITH(Fence, Fence)
 
+// Табличная диспетчеризация: CollidePair для любой пары типов сводится
+// к geo2d::Collide от их геометрии
+geo2d::Point GeometryOf(const Unit& unit) {
+    return unit.GetPosition();
+}
+
+template <typename T>
+auto GeometryOf(const T& object) -> decltype(object.GetGeometry()) {
+    return object.GetGeometry();
+}
+
+template <typename First, typename Second>
+bool CollidePair(const First& first, const Second& second) {
+    return geo2d::Collide(GeometryOf(first), GeometryOf(second));
+}
+
+// Охватывающий прямоугольник объекта для широкой фазы: GameObject его не
+// раскрывает, поэтому он считается по конкретному типу при создании объекта
+template <typename T>
+geo2d::Rectangle BoundingBoxOf(const T& object) {
+    return geo2d::BoundingBox(GeometryOf(object));
+}
+
+geo2d::Rectangle BoundingBoxOf(const ObjectDispatcher::Variant& shape) {
+    return visit([](const auto& object) { return BoundingBoxOf(object); }, shape);
+}
+
 bool Collide(const GameObject& first, const GameObject& second) {
     return first.Collide(second);
 }
@@ -272,9 +318,476 @@ void TestSegmentCircleCollide() {
     ASSERT(!geo2d::Collide(c, Segment{{-5, 5}, {5, 5}}));
     ASSERT(!geo2d::Collide(c, Segment{{4, 4}, {5, 4}}));
     ASSERT(!geo2d::Collide(Circle{{10, 7}, 1}, Segment{{7, 3}, {9, 8}}));
+
+    // Отрезок нулевой длины ведёт себя как точка
+    ASSERT(geo2d::Collide(c, Segment{{4, 0}, {4, 0}}));
+    ASSERT(!geo2d::Collide(c, Segment{{9, 9}, {9, 9}}));
+    ASSERT(!geo2d::Collide(geo2d::Point{1, 1}, Segment{{9, 9}, {9, 9}}));
+    ASSERT(!geo2d::Collide(c, geo2d::Rectangle{{20, 5}, {30, 5}}));
+}
+
+ObjectDispatcher::Variant RandomShape(mt19937& gen, int world_size, int max_extent) {
+    using namespace geo2d;
+    uniform_int_distribution<int> coordinate(0, world_size);
+    uniform_int_distribution<int> extent(0, max_extent);
+    const Point p{coordinate(gen), coordinate(gen)};
+    const Point q{p.x + extent(gen), p.y + extent(gen)};
+    switch (gen() % 4) {
+        case 0:
+            return Unit(p);
+        case 1:
+            return Building(Rectangle{p, q});
+        case 2:
+            return Tower(Circle{p, static_cast<uint32_t>(extent(gen) / 2)});
+        default:
+            return Fence(Segment{p, {p.x + extent(gen) - max_extent / 2, q.y}});
+    }
+}
+
+struct PlacedObject {
+    shared_ptr<GameObject> object;
+    geo2d::Rectangle box;
+};
+
+PlacedObject RandomObject(mt19937& gen, int world_size, int max_extent) {
+    const auto shape = RandomShape(gen, world_size, max_extent);
+    return {
+        visit([](const auto& object) -> shared_ptr<GameObject> {
+            return make_shared<decay_t<decltype(object)>>(object);
+        }, shape),
+        BoundingBoxOf(shape)
+    };
+}
+
+bool AnyCollisionBruteForce(const vector<shared_ptr<GameObject>>& objects, const GameObject& object) {
+    for (const auto& other : objects) {
+        if (other && Collide(*other, object)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Случайный мир; охватывающие прямоугольники объектов кладутся в boxes
+vector<unique_ptr<GameObject>> RandomWorld(
+    mt19937& gen, size_t object_count, int world_size, int max_extent, vector<geo2d::Rectangle>& boxes
+) {
+    vector<unique_ptr<GameObject>> world;
+    world.reserve(object_count);
+    boxes.reserve(object_count);
+    for (size_t i = 0; i < object_count; ++i) {
+        const auto shape = RandomShape(gen, world_size, max_extent);
+        world.push_back(visit([](const auto& object) -> unique_ptr<GameObject> {
+            return make_unique<decay_t<decltype(object)>>(object);
+        }, shape));
+        boxes.push_back(BoundingBoxOf(shape));
+    }
+    return world;
+}
+
+// Простая широкая фаза для тестов и замеров: заметание по оси x, пары
+// с пересекающимися охватывающими прямоугольниками
+vector<CandidatePair> SweepCandidates(const vector<geo2d::Rectangle>& boxes) {
+    vector<uint32_t> order(boxes.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&boxes](uint32_t lhs, uint32_t rhs) {
+        return boxes[lhs].Left() < boxes[rhs].Left();
+    });
+
+    vector<CandidatePair> candidates;
+    for (size_t i = 0; i < order.size(); ++i) {
+        const auto& box = boxes[order[i]];
+        for (size_t j = i + 1; j < order.size() && boxes[order[j]].Left() <= box.Right(); ++j) {
+            if (geo2d::Collide(box, boxes[order[j]])) {
+                candidates.emplace_back(order[i], order[j]);
+            }
+        }
+    }
+    return candidates;
+}
+
+void TestCollisionWorld() {
+    mt19937 gen(2024);
+    // Маленькие ячейки, чтобы объекты занимали по несколько ячеек,
+    // и порог крупных объектов, чтобы в мире были и такие
+    CollisionWorld world(4, 6);
+    vector<shared_ptr<GameObject>> objects;
+    vector<CollisionWorld::Id> ids;
+
+    for (int step = 0; step < 3000; ++step) {
+        const int action = step < 300 ? 0 : static_cast<int>(gen() % 3);
+        if (action == 0 || ids.empty()) {
+            auto placed = RandomObject(gen, 200, 12);
+            const CollisionWorld::Id id = world.Insert(placed.object, placed.box);
+            if (id >= objects.size()) {
+                objects.resize(id + 1);
+            }
+            objects[id] = placed.object;
+            ids.push_back(id);
+        } else {
+            const size_t index = gen() % ids.size();
+            const CollisionWorld::Id id = ids[index];
+            if (action == 1) {
+                auto placed = RandomObject(gen, 200, 12);
+                objects[id] = placed.object;
+                world.Move(id, placed.object, placed.box);
+            } else {
+                world.Remove(id);
+                objects[id].reset();
+                ids[index] = ids.back();
+                ids.pop_back();
+            }
+        }
+
+        const auto query = RandomObject(gen, 220, 30);
+        AssertEqual(
+                world.AnyCollision(*query.object, query.box), AnyCollisionBruteForce(objects, *query.object),
+                "step " + to_string(step)
+        );
+    }
+    ASSERT_EQUAL(world.Size(), ids.size());
+
+    // Запрос крупнее всего мира и объекты с отрицательными координатами
+    using namespace geo2d;
+    CollisionWorld sparse;
+    const Unit unit(Point{-1000, -1000});
+    sparse.Insert(make_shared<Unit>(unit), BoundingBoxOf(unit));
+    const Building huge(Rectangle{{-2000, -2000}, {2000, 2000}});
+    ASSERT(sparse.AnyCollision(huge, BoundingBoxOf(huge)));
+    const Tower touching(Circle{{-1010, -1000}, 10});
+    ASSERT(sparse.AnyCollision(touching, BoundingBoxOf(touching)));
+    const Tower missing(Circle{{-1011, -1000}, 10});
+    ASSERT(!sparse.AnyCollision(missing, BoundingBoxOf(missing)));
+}
+
+void BenchmarkCollisionWorld() {
+    const int object_count = 1000000;
+    const int world_size = 1000000;
+    const int query_count = 100000;
+
+    mt19937 gen(7);
+    vector<PlacedObject> objects;
+    objects.reserve(object_count);
+    for (int i = 0; i < object_count; ++i) {
+        objects.push_back(RandomObject(gen, world_size, 100));
+    }
+    vector<PlacedObject> queries;
+    for (int i = 0; i < query_count; ++i) {
+        queries.push_back(RandomObject(gen, world_size, 100));
+    }
+
+    CollisionWorld world;
+    world.Reserve(object_count);
+    vector<CollisionWorld::Id> ids;
+    {
+        LOG_DURATION("CollisionWorld: insert 1M objects");
+        for (const auto& placed : objects) {
+            ids.push_back(world.Insert(placed.object, placed.box));
+        }
+    }
+
+    size_t collisions = 0;
+    {
+        LOG_DURATION("CollisionWorld: 100k AnyCollision queries");
+        for (const auto& query : queries) {
+            collisions += world.AnyCollision(*query.object, query.box);
+        }
+    }
+
+    vector<shared_ptr<GameObject>> object_list;
+    object_list.reserve(objects.size());
+    for (const auto& placed : objects) {
+        object_list.push_back(placed.object);
+    }
+    size_t brute_force_collisions = 0;
+    {
+        LOG_DURATION("Brute force: 20 of those queries");
+        for (size_t i = 0; i < 20; ++i) {
+            brute_force_collisions += AnyCollisionBruteForce(object_list, *queries[i].object);
+        }
+    }
+
+    {
+        LOG_DURATION("CollisionWorld: 100k moves");
+        for (int i = 0; i < query_count; ++i) {
+            world.Move(ids[i], queries[i].object, queries[i].box);
+        }
+    }
+    cerr << "Collisions found: " << collisions << " of " << query_count
+         << " (brute force sample: " << brute_force_collisions << " of 20)" << endl;
 }
 
-int main() {
+void TestDispatchTable() {
+    mt19937 gen(99);
+    vector<ObjectDispatcher::Variant> shapes;
+    vector<shared_ptr<GameObject>> objects;
+    vector<ObjectDispatcher::Handle<GameObject>> handles;
+    for (int i = 0; i < 300; ++i) {
+        shapes.push_back(RandomShape(gen, 60, 15));
+        visit([&](const auto& shape) {
+            auto object = make_shared<decay_t<decltype(shape)>>(shape);
+            handles.push_back(ObjectDispatcher::Register<GameObject>(*object));
+            objects.push_back(move(object));
+        }, shapes.back());
+    }
+
+    size_t collisions = 0;
+    for (size_t i = 0; i < objects.size(); ++i) {
+        ASSERT_EQUAL(static_cast<size_t>(handles[i].type_id), shapes[i].index());
+        ASSERT(handles[i].object == objects[i].get());
+        for (size_t j = 0; j < objects.size(); ++j) {
+            const bool expected = objects[i]->Collide(*objects[j]);
+            AssertEqual(ObjectDispatcher::Collide(handles[i], handles[j]), expected, to_string(i) + " " + to_string(j));
+            AssertEqual(ObjectDispatcher::Collide(shapes[i], shapes[j]), expected, to_string(i) + " " + to_string(j));
+            collisions += expected;
+        }
+    }
+    // Выборка должна содержать и пересечения, и промахи
+    ASSERT(collisions > objects.size());
+    ASSERT(collisions < objects.size() * objects.size() / 2);
+}
+
+void BenchmarkDispatch() {
+    const size_t object_count = 4096;
+    const size_t pair_count = 10000000;
+
+    mt19937 gen(5);
+    vector<ObjectDispatcher::Variant> shapes;
+    vector<unique_ptr<GameObject>> objects;
+    vector<ObjectDispatcher::Handle<GameObject>> handles;
+    for (size_t i = 0; i < object_count; ++i) {
+        shapes.push_back(RandomShape(gen, 2000, 100));
+        visit([&](const auto& shape) {
+            auto object = make_unique<decay_t<decltype(shape)>>(shape);
+            handles.push_back(ObjectDispatcher::Register<GameObject>(*object));
+            objects.push_back(move(object));
+        }, shapes.back());
+    }
+    vector<pair<uint32_t, uint32_t>> pairs(pair_count);
+    for (auto& [first, second] : pairs) {
+        first = gen() % object_count;
+        second = gen() % object_count;
+    }
+
+    size_t collisions = 0;
+    {
+        LOG_DURATION("Dispatch: Collider<T> + virtual CollideWith");
+        for (const auto& [first, second] : pairs) {
+            collisions += objects[first]->Collide(*objects[second]);
+        }
+    }
+    {
+        LOG_DURATION("Dispatch: table, pointer storage");
+        for (const auto& [first, second] : pairs) {
+            collisions -= ObjectDispatcher::Collide(handles[first], handles[second]);
+        }
+    }
+    {
+        LOG_DURATION("Dispatch: table, variant storage");
+        for (const auto& [first, second] : pairs) {
+            collisions += ObjectDispatcher::Collide(shapes[first], shapes[second]);
+        }
+    }
+    {
+        LOG_DURATION("Dispatch: std::visit, variant storage");
+        for (const auto& [first, second] : pairs) {
+            collisions -= visit([](const auto& lhs, const auto& rhs) {
+                return CollidePair(lhs, rhs);
+            }, shapes[first], shapes[second]);
+        }
+    }
+    // Все четыре способа считают одно и то же, поэтому сумма со знаками нулевая
+    cerr << "Dispatch checksum (must be 0): " << collisions << endl;
+}
+
+void TestCollideBatch() {
+    using namespace geo2d;
+    mt19937 gen(17);
+    size_t hits = 0;
+    // Малый масштаб даёт много касаний, совпадающих точек и коллинеарных отрезков,
+    // крупный проверяет переполнения квадратов расстояний и суммы радиусов
+    for (int scale : {8, 1000, (1 << 30) - 1}) {
+        uniform_int_distribution<int> coordinate(-scale, scale);
+        uniform_int_distribution<uint32_t> radius(0, scale > 1000 ? numeric_limits<uint32_t>::max() : scale);
+        auto random_point = [&] {
+            return Point{coordinate(gen), coordinate(gen)};
+        };
+        auto random_segment = [&] {
+            const Point p = random_point();
+            return Segment{p, gen() % 8 == 0 ? p : random_point()};
+        };
+        auto random_rectangle = [&] {
+            return Rectangle{random_point(), random_point()};
+        };
+        auto random_circle = [&] {
+            return Circle{random_point(), radius(gen)};
+        };
+
+        // Размер не кратен ни 4, ни 64: проверяются и хвост, и граница слов маски
+        Points points;
+        Segments segments;
+        Rectangles rectangles;
+        Circles circles;
+        for (int i = 0; i < 203; ++i) {
+            points.Add(random_point());
+            segments.Add(random_segment());
+            rectangles.Add(random_rectangle());
+            circles.Add(random_circle());
+        }
+
+        auto check = [&](auto shape, const auto& batch) {
+            const CollisionMask mask = CollideBatch(shape, batch);
+            ASSERT_EQUAL(mask.size(), (batch.Size() + 63) / 64);
+            ASSERT_EQUAL(mask.back() >> (batch.Size() % 64), 0u);
+            for (size_t i = 0; i < batch.Size(); ++i) {
+                const bool expected = geo2d::Collide(shape, batch[i]);
+                AssertEqual(TestBit(mask, i), expected, "scale " + to_string(scale) + ", item " + to_string(i));
+                hits += expected;
+            }
+        };
+        auto check_all = [&](auto shape) {
+            check(shape, points);
+            check(shape, segments);
+            check(shape, rectangles);
+            check(shape, circles);
+        };
+        for (int i = 0; i < 50; ++i) {
+            check_all(random_point());
+            check_all(random_segment());
+            check_all(random_rectangle());
+            check_all(random_circle());
+        }
+    }
+    ASSERT(hits > 0);
+
+    // В этих парах квадраты в Collide переполняются, и ответ отличается от
+    // точного геометрического: быстрый путь ядра обязан такие пары распознать.
+    // В первой переполняется (2S)^2, во второй r^2 * L^2
+    const vector<pair<Rectangle, Circle>> wrapped = {
+        {{{-107562875, -936158287}, {965270835, -310718629}}, {{168340400, 948837620}, 2}},
+        {{{-396177159, -768541162}, {400507686, 608413197}}, {{718603162, -187821400}, 78547565}},
+    };
+    for (const auto& [rectangle, circle] : wrapped) {
+        Rectangles same_rectangles;
+        for (int i = 0; i < 4; ++i) {
+            same_rectangles.Add(rectangle);
+        }
+        ASSERT(geo2d::Collide(rectangle, circle));
+        ASSERT_EQUAL(CollideBatch(circle, same_rectangles)[0], 0xFu);
+    }
+}
+
+void BenchmarkCollideBatch() {
+    using namespace geo2d;
+    const size_t rectangle_count = 1 << 20;
+    const int query_count = 64;
+
+    mt19937 gen(3);
+    uniform_int_distribution<int> coordinate(0, 100000);
+    uniform_int_distribution<int> extent(0, 500);
+    vector<Rectangle> rectangle_list;
+    Rectangles rectangles;
+    for (size_t i = 0; i < rectangle_count; ++i) {
+        const Point p{coordinate(gen), coordinate(gen)};
+        const Rectangle r{p, {p.x + extent(gen), p.y + extent(gen)}};
+        rectangle_list.push_back(r);
+        rectangles.Add(r);
+    }
+    vector<Circle> circles;
+    for (int i = 0; i < query_count; ++i) {
+        circles.push_back({{coordinate(gen), coordinate(gen)}, static_cast<uint32_t>(extent(gen))});
+    }
+
+    cerr << "CollideBatch vectorized: " << (CollideBatchVectorized() ? "yes" : "no") << endl;
+    size_t scalar_hits = 0;
+    {
+        LOG_DURATION("Circle vs 1M rectangles x 64: scalar Collide");
+        for (const Circle& c : circles) {
+            for (const Rectangle& r : rectangle_list) {
+                scalar_hits += geo2d::Collide(c, r);
+            }
+        }
+    }
+    size_t batch_hits = 0;
+    {
+        LOG_DURATION("Circle vs 1M rectangles x 64: CollideBatch");
+        for (const Circle& c : circles) {
+            for (uint64_t word : CollideBatch(c, rectangles)) {
+                batch_hits += __builtin_popcountll(word);
+            }
+        }
+    }
+    cerr << "Hits: " << scalar_hits << " scalar, " << batch_hits << " batch" << endl;
+}
+
+void TestCollidingPairs() {
+    mt19937 gen(40);
+    vector<geo2d::Rectangle> boxes;
+    const auto world = RandomWorld(gen, 3000, 1000, 40, boxes);
+    const auto candidates = SweepCandidates(boxes);
+
+    vector<CandidatePair> expected;
+    for (const auto& [first, second] : candidates) {
+        if (Collide(*world[first], *world[second])) {
+            expected.emplace_back(first, second);
+        }
+    }
+    ASSERT(!expected.empty());
+    ASSERT(expected.size() < candidates.size());
+
+    for (size_t thread_count : {1, 2, 3, 8}) {
+        for (size_t chunk_size : {1, 5, 1024, 1 << 20}) {
+            // Несколько кадров подряд на одних и тех же потоках
+            CollisionPass pass(thread_count, chunk_size);
+            for (int frame = 0; frame < 3; ++frame) {
+                Assert(
+                    pass.CollidingPairs(world, candidates) == expected,
+                    "threads " + to_string(thread_count) + ", chunk " + to_string(chunk_size)
+                        + ", frame " + to_string(frame)
+                );
+                ASSERT(pass.CollidingPairs(world, {}).empty());
+            }
+        }
+    }
+
+    try {
+        CollisionPass(2, 0);
+        ASSERT(false);
+    } catch (const invalid_argument&) {
+    }
+}
+
+void BenchmarkCollidingPairs() {
+    mt19937 gen(41);
+    vector<geo2d::Rectangle> boxes;
+    const auto world = RandomWorld(gen, 400000, 20000, 100, boxes);
+    const auto candidates = SweepCandidates(boxes);
+    const size_t hardware_threads = max(1u, thread::hardware_concurrency());
+
+    const int frame_count = 10;
+
+    size_t sequential = 0;
+    {
+        CollisionPass pass(1);
+        LOG_DURATION("Narrow phase: " + to_string(frame_count) + " frames of "
+            + to_string(candidates.size()) + " pairs, 1 thread");
+        for (int frame = 0; frame < frame_count; ++frame) {
+            sequential = pass.CollidingPairs(world, candidates).size();
+        }
+    }
+    size_t parallel = 0;
+    for (size_t thread_count : {size_t{4}, hardware_threads}) {
+        CollisionPass pass(thread_count);
+        LOG_DURATION("Narrow phase: " + to_string(frame_count) + " frames of "
+            + to_string(candidates.size()) + " pairs, threads: " + to_string(thread_count));
+        for (int frame = 0; frame < frame_count; ++frame) {
+            parallel = pass.CollidingPairs(world, candidates).size();
+        }
+    }
+    cerr << "Colliding pairs: " << sequential << " / " << parallel << endl;
+}
+
+int main(int argc, char* argv[]) {
     TestRunner tr;
     RUN_TEST(tr, TestAddingNewObjectOnMap);
     RUN_TEST(tr, TestVectorProduct);
@@ -282,5 +795,17 @@ int main() {
     RUN_TEST(tr, TestPointRectangleCollide);
     RUN_TEST(tr, TestSegmentSegmentCollide);
     RUN_TEST(tr, TestSegmentCircleCollide);
+    RUN_TEST(tr, TestCollisionWorld);
+    RUN_TEST(tr, TestDispatchTable);
+    RUN_TEST(tr, TestCollideBatch);
+    RUN_TEST(tr, TestCollidingPairs);
+
+    // Замеры идут несколько секунд, поэтому только по ./solution --benchmark
+    if (argc > 1 && string(argv[1]) == "--benchmark") {
+        BenchmarkCollisionWorld();
+        BenchmarkDispatch();
+        BenchmarkCollideBatch();
+        BenchmarkCollidingPairs();
+    }
     return 0;
 }
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Поля запроса ссылаются на байты, из которых он разобран, например, на
+// буфер соединения HttpServer, и действительны, пока этот буфер не изменился
+struct HttpRequest {
+    std::string_view method{}, path{}, body{};
+    std::map<std::string_view, std::string_view> get_params{};
+};
+
+enum class HttpCode {
+    Ok = 200,
+    NotFound = 404,
+    Found = 302,
+    BadRequest = 400,
+    PayloadTooLarge = 413,
+};
+
+inline std::ostream& operator<<(std::ostream& output, HttpCode code) {
+    switch (code) {
+        case HttpCode::Ok:
+            output << "200 OK";
+            break;
+        case HttpCode::Found:
+            output << "302 Found";
+            break;
+        case HttpCode::NotFound:
+            output << "404 Not found";
+            break;
+        case HttpCode::BadRequest:
+            output << "400 Bad request";
+            break;
+        case HttpCode::PayloadTooLarge:
+            output << "413 Payload too large";
+            break;
+        default:
+            throw std::invalid_argument("Unknown http code");
+    }
+    return output;
+}
+
+struct HttpHeader {
+    std::string name, value;
+};
+
+inline std::ostream& operator<<(std::ostream& output, const HttpHeader& h) {
+    return output << h.name << ": " << h.value;
+}
+
+class HttpResponse {
+public:
+    explicit HttpResponse(HttpCode code) : code(code) {
+    }
+
+    HttpResponse& AddHeader(std::string name, std::string value) {
+        headers.push_back(HttpHeader{std::move(name), std::move(value)});
+        return *this;
+    }
+
+    HttpResponse& SetContent(std::string a_content) {
+        content = std::move(a_content);
+        content_parts.clear();
+        return *this;
+    }
+
+    // Тело из кусков чужой памяти, которые отправляются без копирования. Память
+    // не должна меняться и освобождаться, пока ответ не отправлен.
+    // Заменяет тело, заданное SetContent
+    HttpResponse& SetContentParts(std::vector<std::string_view> parts) {
+        content.clear();
+        content_parts = std::move(parts);
+        return *this;
+    }
+
+    HttpResponse& SetCode(HttpCode a_code) {
+        code = a_code;
+        return *this;
+    }
+
+    HttpCode GetCode() const {
+        return code;
+    }
+
+    const std::vector<HttpHeader>& GetHeaders() const {
+        return headers;
+    }
+
+    size_t GetContentSize() const {
+        size_t size = content.size();
+        for (std::string_view part : content_parts) {
+            size += part.size();
+        }
+        return size;
+    }
+
+    std::string GetContent() const {
+        std::string result = content;
+        for (std::string_view part : content_parts) {
+            result += part;
+        }
+        return result;
+    }
+
+    // Забирают тело, чтобы отправить его без копирования
+    std::string TakeContent() && {
+        return std::move(content);
+    }
+
+    std::vector<std::string_view> TakeContentParts() && {
+        return std::move(content_parts);
+    }
+
+    // Content-Length выводится только для непустого тела, как требует формат задачи
+    friend std::ostream& operator << (std::ostream& output, const HttpResponse& resp) {
+        output << "HTTP/1.1 " << resp.code << '\n';
+        for (const auto& header : resp.headers) {
+            output << header << '\n';
+        }
+        if (const size_t size = resp.GetContentSize(); size > 0) {
+            output << "Content-Length: " << size << '\n';
+        }
+        output << '\n' << resp.content;
+        for (std::string_view part : resp.content_parts) {
+            output << part;
+        }
+        return output;
+    }
+
+private:
+    HttpCode code;
+    std::vector<HttpHeader> headers;
+    std::string content;
+    std::vector<std::string_view> content_parts;
+};
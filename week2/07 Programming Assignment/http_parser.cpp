@@ -0,0 +1,138 @@
+#include "http_parser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+using namespace std;
+
+namespace {
+
+    bool EqualNoCase(string_view lhs, string_view rhs) {
+        return lhs.size() == rhs.size() && equal(lhs.begin(), lhs.end(), rhs.begin(), [](char a, char b) {
+            return tolower(static_cast<unsigned char>(a)) == tolower(static_cast<unsigned char>(b));
+        });
+    }
+
+    string_view Trim(string_view s) {
+        while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+            s.remove_prefix(1);
+        }
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+            s.remove_suffix(1);
+        }
+        return s;
+    }
+
+    // Отрезает от text первую строку без перевода строки
+    string_view ReadLine(string_view& text) {
+        const size_t end = text.find('\n');
+        string_view line = text.substr(0, end);
+        text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        return line;
+    }
+
+    string_view ReadToken(string_view& text, char separator) {
+        const size_t end = text.find(separator);
+        const string_view token = text.substr(0, end);
+        text.remove_prefix(end == string_view::npos ? text.size() : end + 1);
+        return token;
+    }
+
+    // Позиция сразу за пустой строкой, завершающей заголовки, или npos
+    size_t FindHeaderEnd(string_view data, size_t from) {
+        for (size_t i = data.find('\n', from); i != string_view::npos; i = data.find('\n', i + 1)) {
+            if (i + 1 < data.size() && data[i + 1] == '\n') {
+                return i + 2;
+            }
+            if (i + 2 < data.size() && data[i + 1] == '\r' && data[i + 2] == '\n') {
+                return i + 3;
+            }
+        }
+        return string_view::npos;
+    }
+
+    void ParseQuery(string_view query, HttpRequest& request) {
+        while (!query.empty()) {
+            string_view value = ReadToken(query, '&');
+            const string_view name = ReadToken(value, '=');
+            if (!name.empty()) {
+                request.get_params[name] = value;
+            }
+        }
+    }
+
+}
+
+HttpRequestParser::Result HttpRequestParser::Parse(string_view data, HttpRequest& request) {
+    // Пустые строки перед запросом допускаются RFC 7230 и пропускаются
+    const size_t start = min(data.find_first_not_of("\r\n"), data.size());
+    const size_t header_end = FindHeaderEnd(data, max(scanned, start));
+    if (header_end == string_view::npos) {
+        if (data.size() - start > max_header_size) {
+            return {Status::TooLarge};
+        }
+        // Последний перевод строки мог оказаться началом пустой строки
+        scanned = max(data.size(), size_t{2}) - 2;
+        return {Status::Incomplete};
+    }
+    if (header_end - start > max_header_size) {
+        return {Status::TooLarge};
+    }
+
+    string_view head = data.substr(start, header_end - start);
+    string_view request_line = ReadLine(head);
+    const string_view method = ReadToken(request_line, ' ');
+    string_view target = ReadToken(request_line, ' ');
+    const string_view version = request_line;
+    if (method.empty() || target.empty() || version.substr(0, 7) != "HTTP/1.") {
+        return {Status::Invalid};
+    }
+
+    bool keep_alive = version == "HTTP/1.1";
+    size_t content_length = 0;
+    for (string_view line; !(line = ReadLine(head)).empty();) {
+        const size_t colon = line.find(':');
+        if (colon == string_view::npos) {
+            return {Status::Invalid};
+        }
+        const string_view name = Trim(line.substr(0, colon));
+        const string_view value = Trim(line.substr(colon + 1));
+        if (EqualNoCase(name, "Content-Length")) {
+            const auto [end, error] = from_chars(value.data(), value.data() + value.size(), content_length);
+            if (error != errc() || end != value.data() + value.size()) {
+                return {Status::Invalid};
+            }
+            if (content_length > max_body_size) {
+                return {Status::TooLarge};
+            }
+        } else if (EqualNoCase(name, "Transfer-Encoding")) {
+            // Тело частями не поддерживается
+            return {Status::Invalid};
+        } else if (EqualNoCase(name, "Connection")) {
+            if (EqualNoCase(value, "close")) {
+                keep_alive = false;
+            } else if (EqualNoCase(value, "keep-alive")) {
+                keep_alive = true;
+            }
+        }
+    }
+
+    if (data.size() - header_end < content_length) {
+        // Заголовки уже найдены: следующий поиск сразу упрётся в ту же пустую строку
+        scanned = header_end - 3;
+        return {Status::Incomplete};
+    }
+
+    request.method = method;
+    request.path = ReadToken(target, '?');
+    request.get_params.clear();
+    ParseQuery(target, request);
+    request.body = data.substr(header_end, content_length);
+
+    scanned = 0;
+    return {Status::Complete, header_end + content_length, keep_alive};
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "http.h"
+
+#include <cstddef>
+#include <string_view>
+
+// Пошаговый разбор запросов HTTP/1.x из потока байтов соединения.
+// Parse вызывается после каждого чтения из сокета; уже просмотренные байты
+// заголовков повторно не сканируются. Строки могут заканчиваться как "\r\n",
+// так и "\n". Поля HttpRequest ссылаются на переданный буфер, параметры
+// запроса не раскодируются из %XX
+class HttpRequestParser {
+public:
+    enum class Status {
+        Incomplete,
+        Complete,
+        Invalid,
+        // Заголовки длиннее max_header_size или тело длиннее max_body_size
+        TooLarge,
+    };
+
+    struct Result {
+        Status status;
+        // Длина разобранного запроса вместе с телом
+        size_t consumed = 0;
+        // Не закрывать соединение после ответа: HTTP/1.1 без "Connection: close"
+        // или HTTP/1.0 с "Connection: keep-alive"
+        bool keep_alive = false;
+    };
+
+    static constexpr size_t max_header_size = 8192;
+    static constexpr size_t max_body_size = 1 << 20;
+
+    // data должен начинаться с первого неразобранного запроса соединения
+    // и при повторных вызовах только дополняться в конце
+    Result Parse(std::string_view data, HttpRequest& request);
+
+private:
+    // Конец заголовков до этой позиции уже искали
+    size_t scanned = 0;
+};
+
+void TestHttpParser();
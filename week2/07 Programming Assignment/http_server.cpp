@@ -0,0 +1,291 @@
+#include "http_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+using namespace std;
+
+namespace {
+
+    // Пока у соединения столько неотправленных байтов, новые запросы из него не читаем
+    const size_t max_pending_output = 1 << 20;
+    const size_t min_read_size = 1 << 14;
+    const int max_events = 256;
+
+    [[noreturn]] void ThrowSystemError(const char* what) {
+        throw system_error(errno, generic_category(), what);
+    }
+
+    void CloseIfOpen(int& fd) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    bool WouldBlock() {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+
+}
+
+HttpServer::HttpServer(Handler handler, uint16_t port, const string& address)
+    : handler(move(handler)) {
+    try {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+            throw invalid_argument("HttpServer: bad IPv4 address " + address);
+        }
+
+        listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0) {
+            ThrowSystemError("socket");
+        }
+        const int one = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+        if (bind(listen_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+            ThrowSystemError("bind");
+        }
+        if (listen(listen_fd, SOMAXCONN) < 0) {
+            ThrowSystemError("listen");
+        }
+        socklen_t addr_size = sizeof(addr);
+        getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_size);
+        this->port = ntohs(addr.sin_port);
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd < 0 || stop_fd < 0) {
+            ThrowSystemError("epoll_create1/eventfd");
+        }
+        for (int fd : {listen_fd, stop_fd}) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+                ThrowSystemError("epoll_ctl");
+            }
+        }
+    } catch (...) {
+        CloseIfOpen(listen_fd);
+        CloseIfOpen(epoll_fd);
+        CloseIfOpen(stop_fd);
+        throw;
+    }
+}
+
+HttpServer::~HttpServer() {
+    for (const auto& [fd, connection] : connections) {
+        close(fd);
+    }
+    CloseIfOpen(listen_fd);
+    CloseIfOpen(epoll_fd);
+    CloseIfOpen(stop_fd);
+}
+
+uint16_t HttpServer::Port() const {
+    return port;
+}
+
+void HttpServer::Run() {
+    epoll_event events[max_events];
+    for (;;) {
+        const int count = epoll_wait(epoll_fd, events, max_events, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait");
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == stop_fd) {
+                uint64_t value;
+                [[maybe_unused]] auto ignored = read(stop_fd, &value, sizeof(value));
+                return;
+            }
+            if (fd == listen_fd) {
+                Accept();
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            Connection& connection = it->second;
+            bool open = (events[i].events & EPOLLERR) == 0;
+            if (open && (events[i].events & EPOLLOUT)) {
+                open = Write(fd, connection);
+            }
+            if (open && (events[i].events & (EPOLLIN | EPOLLHUP))) {
+                open = Read(fd, connection);
+            }
+            if (open) {
+                UpdateEvents(fd, connection);
+            } else {
+                Close(fd);
+            }
+        }
+    }
+}
+
+void HttpServer::Stop() {
+    const uint64_t value = 1;
+    [[maybe_unused]] auto ignored = write(stop_fd, &value, sizeof(value));
+}
+
+void HttpServer::Accept() {
+    for (;;) {
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // При нехватке дескрипторов новые соединения подождут в очереди listen
+            if (WouldBlock() || errno == EMFILE || errno == ENFILE) {
+                return;
+            }
+            ThrowSystemError("accept4");
+        }
+
+        // Ответы уходят сразу целиком, алгоритм Нейгла только добавил бы задержку
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        Connection& connection = connections[fd];
+        connection.events = EPOLLIN;
+        epoll_event event{};
+        event.events = connection.events;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            Close(fd);
+        }
+    }
+}
+
+bool HttpServer::Read(int fd, Connection& connection) {
+    for (;;) {
+        if (connection.input.size() - connection.input_end < min_read_size) {
+            // Недоразобранный хвост переносим в начало, а если места всё равно мало - растим буфер
+            const size_t pending = connection.input_end - connection.input_begin;
+            if (pending > 0) {
+                memmove(connection.input.data(), connection.input.data() + connection.input_begin, pending);
+            }
+            connection.input_begin = 0;
+            connection.input_end = pending;
+            if (connection.input.size() - pending < min_read_size) {
+                connection.input.resize(max(2 * connection.input.size(), pending + 4 * min_read_size));
+            }
+        }
+
+        const size_t space = connection.input.size() - connection.input_end;
+        const ssize_t received = recv(fd, connection.input.data() + connection.input_end, space, 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (WouldBlock()) {
+                break;
+            }
+            return false;
+        }
+        if (received == 0) {
+            // Клиент закончил отправку: дописываем ответы на то, что уже пришло
+            connection.close_after_write = true;
+            break;
+        }
+
+        connection.input_end += static_cast<size_t>(received);
+        ServeBuffered(connection);
+        // Неполное чтение означает, что сокет опустел
+        if (static_cast<size_t>(received) < space || connection.close_after_write ||
+            connection.output.PendingBytes() >= max_pending_output) {
+            break;
+        }
+    }
+    return Write(fd, connection);
+}
+
+bool HttpServer::Write(int fd, Connection& connection) {
+    if (!connection.output.WriteTo(fd)) {
+        return false;
+    }
+    return !connection.output.Empty() || !connection.close_after_write;
+}
+
+void HttpServer::ServeBuffered(Connection& connection) {
+    HttpRequest request;
+    while (!connection.close_after_write) {
+        const string_view data(
+            connection.input.data() + connection.input_begin,
+            connection.input_end - connection.input_begin
+        );
+        const auto result = connection.parser.Parse(data, request);
+        if (result.status == HttpRequestParser::Status::Incomplete) {
+            break;
+        }
+        if (result.status == HttpRequestParser::Status::Invalid ||
+            result.status == HttpRequestParser::Status::TooLarge) {
+            // Граница следующего запроса неизвестна, продолжать нельзя:
+            // отвечаем ошибкой и закрываем соединение
+            const HttpCode code = result.status == HttpRequestParser::Status::TooLarge
+                ? HttpCode::PayloadTooLarge
+                : HttpCode::BadRequest;
+            HttpResponse response(code);
+            response.AddHeader("Connection", "close");
+            connection.output.Push(move(response));
+            connection.close_after_write = true;
+            break;
+        }
+
+        try {
+            connection.output.Push(handler(request));
+        } catch (const exception&) {
+            connection.output.Push(HttpResponse(HttpCode::NotFound));
+        }
+        connection.input_begin += result.consumed;
+        connection.close_after_write = !result.keep_alive;
+    }
+    if (connection.input_begin == connection.input_end) {
+        connection.input_begin = connection.input_end = 0;
+    }
+}
+
+void HttpServer::UpdateEvents(int fd, Connection& connection) {
+    const size_t pending = connection.output.PendingBytes();
+    uint32_t events = 0;
+    if (!connection.close_after_write && pending < max_pending_output) {
+        events |= EPOLLIN;
+    }
+    if (pending > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events != connection.events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+        connection.events = events;
+    }
+}
+
+void HttpServer::Close(int fd) {
+    close(fd);
+    connections.erase(fd);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "http.h"
+#include "http_parser.h"
+#include "http_writer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Однопоточный HTTP/1.1 сервер на epoll с неблокирующими сокетами.
+// Соединения держатся открытыми между запросами (keep-alive), а несколько
+// запросов, пришедших одним пакетом, разбираются подряд и получают ответы
+// в том же порядке (pipelining). Запрос разбирается прямо в буфере соединения
+// и передаётся обработчику без копирования.
+// Ответ отправляется теми же байтами, что выводит operator<<(ostream&, const HttpResponse&),
+// то есть Content-Length есть только у ответов с непустым телом
+// Несколько серверов можно открыть на одном порту (SO_REUSEPORT) и запустить
+// каждый в своём потоке - тогда обработчик должен быть потокобезопасным
+class HttpServer {
+public:
+    using Handler = std::function<HttpResponse(const HttpRequest&)>;
+
+    // port 0 - выбрать свободный порт, его вернёт Port()
+    HttpServer(Handler handler, uint16_t port = 0, const std::string& address = "127.0.0.1");
+    ~HttpServer();
+
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    uint16_t Port() const;
+
+    // Обслуживает соединения, пока не будет вызван Stop
+    void Run();
+
+    // Можно вызывать из любого потока
+    void Stop();
+
+private:
+    struct Connection {
+        // Принятые, но ещё не разобранные байты - [input_begin, input_end)
+        std::vector<char> input;
+        size_t input_begin = 0;
+        size_t input_end = 0;
+        ResponseQueue output;
+        HttpRequestParser parser;
+        bool close_after_write = false;
+        // Маска событий, на которую сейчас подписан сокет
+        uint32_t events = 0;
+    };
+
+    Handler handler;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int stop_fd = -1;
+    uint16_t port = 0;
+    std::unordered_map<int, Connection> connections;
+
+    void Accept();
+    // false, если соединение закрыто
+    bool Read(int fd, Connection& connection);
+    bool Write(int fd, Connection& connection);
+    void ServeBuffered(Connection& connection);
+    void UpdateEvents(int fd, Connection& connection);
+    void Close(int fd);
+};
+
+void TestHttpServer();
@@ -0,0 +1,417 @@
+#include "http_parser.h"
+#include "http_server.h"
+#include "http_writer.h"
+#include "router.h"
+#include "test_runner.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+void TestHttpParser() {
+    using Status = HttpRequestParser::Status;
+
+    {
+        const string data =
+            "POST /add_comment?user_id=7&x=&flag HTTP/1.1\r\n"
+            "Host: localhost\r\n"
+            "content-length:  5 \r\n"
+            "\r\n"
+            "0 Hi!";
+        HttpRequestParser parser;
+        HttpRequest request;
+        const auto result = parser.Parse(data, request);
+        ASSERT(result.status == Status::Complete);
+        ASSERT_EQUAL(result.consumed, data.size());
+        ASSERT(result.keep_alive);
+        ASSERT_EQUAL(request.method, "POST");
+        ASSERT_EQUAL(request.path, "/add_comment");
+        ASSERT_EQUAL(request.body, "0 Hi!");
+        ASSERT_EQUAL(request.get_params.size(), 3u);
+        ASSERT_EQUAL(request.get_params.at("user_id"), "7");
+        ASSERT_EQUAL(request.get_params.at("x"), "");
+        ASSERT_EQUAL(request.get_params.at("flag"), "");
+        // Разбор без копирования: поля ссылаются на исходный буфер
+        ASSERT(request.body.data() == data.data() + data.size() - 5);
+    }
+    {
+        // Запрос приходит по байту: до последнего байта тела ответ - Incomplete
+        const string data = "POST /add_user HTTP/1.1\nContent-Length: 3\n\nabc";
+        HttpRequestParser parser;
+        HttpRequest request;
+        for (size_t size = 0; size < data.size(); ++size) {
+            AssertEqual(parser.Parse(string_view(data).substr(0, size), request).status == Status::Incomplete, true,
+                        "prefix " + to_string(size));
+        }
+        const auto result = parser.Parse(data, request);
+        ASSERT(result.status == Status::Complete);
+        ASSERT_EQUAL(request.body, "abc");
+    }
+    {
+        // Несколько запросов в одном буфере разбираются по очереди
+        const string data =
+            "\r\nGET /captcha HTTP/1.1\r\n\r\n"
+            "GET /user_comments?user_id=1 HTTP/1.0\r\n\r\n"
+            "GET /captcha HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"
+            "GET /captcha HTTP/1.1\r\nConnection: close\r\n\r\n";
+        HttpRequestParser parser;
+        HttpRequest request;
+        string_view rest = data;
+        vector<string> paths;
+        vector<bool> keep_alive;
+        for (;;) {
+            const auto result = parser.Parse(rest, request);
+            if (result.status != Status::Complete) {
+                ASSERT(result.status == Status::Incomplete);
+                break;
+            }
+            paths.emplace_back(request.path);
+            keep_alive.push_back(result.keep_alive);
+            rest.remove_prefix(result.consumed);
+        }
+        ASSERT(rest.empty());
+        ASSERT_EQUAL(paths, (vector<string>{"/captcha", "/user_comments", "/captcha", "/captcha"}));
+        ASSERT_EQUAL(keep_alive, (vector<bool>{true, false, true, false}));
+    }
+    {
+        HttpRequest request;
+        for (const string& data : {
+            string("GET\r\n\r\n"),
+            string("GET / FTP/1.1\r\n\r\n"),
+            string("GET / HTTP/1.1\r\nBroken header\r\n\r\n"),
+            string("POST / HTTP/1.1\r\nContent-Length: 12x\r\n\r\n"),
+            string("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"),
+        }) {
+            HttpRequestParser parser;
+            AssertEqual(parser.Parse(data, request).status == Status::Invalid, true, data.substr(0, 40));
+        }
+        for (const string& data : {
+            string("POST / HTTP/1.1\r\nContent-Length: 99999999\r\n\r\n"),
+            "GET /" + string(HttpRequestParser::max_header_size, 'a'),
+        }) {
+            HttpRequestParser parser;
+            AssertEqual(parser.Parse(data, request).status == Status::TooLarge, true, data.substr(0, 40));
+        }
+    }
+}
+
+namespace {
+
+    int ConnectTo(uint16_t port) {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+            close(fd);
+            throw runtime_error("connect failed");
+        }
+        // Зависший сервер не должен вешать тесты
+        timeval timeout{5, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+    void SendAll(int fd, string_view data) {
+        while (!data.empty()) {
+            const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (sent <= 0) {
+                throw runtime_error("send failed");
+            }
+            data.remove_prefix(static_cast<size_t>(sent));
+        }
+    }
+
+    // Читает ровно size байтов или всё до закрытия соединения, если оно наступит раньше
+    string Receive(int fd, size_t size) {
+        string result(size, '\0');
+        size_t received = 0;
+        while (received < size) {
+            const ssize_t got = recv(fd, result.data() + received, size - received, 0);
+            if (got <= 0) {
+                break;
+            }
+            received += static_cast<size_t>(got);
+        }
+        result.resize(received);
+        return result;
+    }
+
+    bool ClosedByPeer(int fd) {
+        char byte;
+        return recv(fd, &byte, 1, 0) == 0;
+    }
+
+    string Render(const HttpResponse& response) {
+        ostringstream output;
+        output << response;
+        return output.str();
+    }
+
+}
+
+void TestHttpServer() {
+    HttpServer server([](const HttpRequest& request) {
+        if (request.path == "/throw") {
+            throw out_of_range("no such user");
+        }
+        string content = string(request.method) + " " + string(request.path);
+        for (const auto& [name, value] : request.get_params) {
+            content += " " + string(name) + "=" + string(value);
+        }
+        if (!request.body.empty()) {
+            content += " [" + string(request.body) + "]";
+        }
+        return HttpResponse(HttpCode::Ok).AddHeader("X-Test", "1").SetContent(move(content));
+    });
+    thread loop([&server] { server.Run(); });
+
+    try {
+        const string echo = Render(HttpResponse(HttpCode::Ok).AddHeader("X-Test", "1").SetContent("GET /a"));
+        {
+            // Конвейер из трёх запросов, третий приходит двумя частями
+            const int fd = ConnectTo(server.Port());
+            SendAll(fd, "GET /a HTTP/1.1\r\n\r\nPOST /b?k=v HTTP/1.1\r\nContent-Length: 4\r\n\r\nbody");
+            SendAll(fd, "GET /c HTTP/1.1\r\n");
+            const string expected_first =
+                echo +
+                Render(HttpResponse(HttpCode::Ok).AddHeader("X-Test", "1").SetContent("POST /b k=v [body]"));
+            ASSERT_EQUAL(Receive(fd, expected_first.size()), expected_first);
+
+            SendAll(fd, "\r\nGET /throw HTTP/1.1\r\n\r\n");
+            const string expected_second =
+                Render(HttpResponse(HttpCode::Ok).AddHeader("X-Test", "1").SetContent("GET /c")) +
+                Render(HttpResponse(HttpCode::NotFound));
+            ASSERT_EQUAL(Receive(fd, expected_second.size()), expected_second);
+
+            // Соединение остаётся открытым до Connection: close
+            SendAll(fd, "GET /a HTTP/1.1\r\nConnection: close\r\n\r\nGET /ignored HTTP/1.1\r\n\r\n");
+            ASSERT_EQUAL(Receive(fd, echo.size()), echo);
+            ASSERT(ClosedByPeer(fd));
+            close(fd);
+        }
+        {
+            // На некорректный запрос сервер отвечает 400 и закрывает соединение,
+            // а предыдущие запросы конвейера получают свои ответы
+            const int fd = ConnectTo(server.Port());
+            SendAll(fd, "GET /a HTTP/1.1\r\n\r\nGARBAGE\r\n\r\nGET /ignored HTTP/1.1\r\n\r\n");
+            const string expected = echo + Render(HttpResponse(HttpCode::BadRequest).AddHeader("Connection", "close"));
+            ASSERT_EQUAL(Receive(fd, expected.size()), expected);
+            ASSERT(ClosedByPeer(fd));
+            close(fd);
+        }
+        {
+            // Слишком большое тело - 413
+            const int fd = ConnectTo(server.Port());
+            SendAll(fd, "POST /a HTTP/1.1\r\nContent-Length: 99999999\r\n\r\n");
+            const string expected = Render(HttpResponse(HttpCode::PayloadTooLarge).AddHeader("Connection", "close"));
+            ASSERT_EQUAL(Receive(fd, expected.size()), expected);
+            ASSERT(ClosedByPeer(fd));
+            close(fd);
+        }
+        {
+            // Много соединений одновременно, каждое с длинным конвейером
+            vector<int> fds;
+            for (int i = 0; i < 20; ++i) {
+                fds.push_back(ConnectTo(server.Port()));
+            }
+            string batch;
+            for (int i = 0; i < 500; ++i) {
+                batch += "GET /a HTTP/1.1\r\n\r\n";
+            }
+            for (int fd : fds) {
+                SendAll(fd, batch);
+            }
+            string expected;
+            for (int i = 0; i < 500; ++i) {
+                expected += echo;
+            }
+            for (int fd : fds) {
+                ASSERT(Receive(fd, expected.size()) == expected);
+                close(fd);
+            }
+        }
+    } catch (...) {
+        server.Stop();
+        loop.join();
+        throw;
+    }
+    server.Stop();
+    loop.join();
+}
+
+void TestResponseWriter() {
+    const string log = "first\nsecond\n" + string(300000, 'y') + "\n";
+    const string_view log_view = log;
+    const vector<HttpResponse> responses = {
+        HttpResponse(HttpCode::Ok).SetContentParts({log_view.substr(0, 6), {}, log_view.substr(6)}),
+        HttpResponse(HttpCode::Ok).SetContentParts({}),
+        HttpResponse(HttpCode::Ok),
+        HttpResponse(HttpCode::Ok).SetContent("0"),
+        HttpResponse(HttpCode::Found).AddHeader("Location", "/captcha"),
+        HttpResponse(HttpCode::NotFound),
+        HttpResponse(HttpCode::Ok).AddHeader("A", "1").AddHeader("B", "").SetContent(string(1234567, 'x')),
+        HttpResponse(HttpCode::Ok).SetContent("What's the answer?"),
+    };
+
+    string expected;
+    for (const auto& response : responses) {
+        string rendered;
+        AppendResponseHead(response, rendered);
+        rendered += response.GetContent();
+        ASSERT_EQUAL(rendered, Render(response));
+        expected += rendered;
+    }
+
+    // Через неблокирующий сокет с маленьким буфером: отправка обрывается
+    // посреди заголовков и тел, и очередь должна продолжить с того же байта
+    int fds[2];
+    ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    const int buffer_size = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+
+    ResponseQueue queue;
+    for (int round = 0; round < 3; ++round) {
+        for (auto response : responses) {
+            queue.Push(move(response));
+        }
+    }
+    ASSERT_EQUAL(queue.PendingBytes(), 3 * expected.size());
+
+    string received;
+    char chunk[1000];
+    while (!queue.Empty()) {
+        ASSERT(queue.WriteTo(fds[0]));
+        for (ssize_t got; (got = recv(fds[1], chunk, sizeof(chunk), 0)) > 0;) {
+            received.append(chunk, static_cast<size_t>(got));
+        }
+    }
+    for (ssize_t got; (got = recv(fds[1], chunk, sizeof(chunk), 0)) > 0;) {
+        received.append(chunk, static_cast<size_t>(got));
+    }
+    ASSERT_EQUAL(queue.PendingBytes(), 0u);
+    ASSERT(received == expected + expected + expected);
+
+    // Очередь не пустеет между отправками, и буфер заголовков сдвигается
+    // посреди недоотправленного заголовка
+    string long_expected;
+    received.clear();
+    for (int i = 0; i < 3000; ++i) {
+        HttpResponse response(HttpCode::Found);
+        response.AddHeader("Location", "/captcha/" + string(i % 97, 'z')).SetContent(to_string(i));
+        long_expected += Render(response);
+        queue.Push(move(response));
+        if (i % 3 == 0) {
+            // Читаем чуть медленнее, чем пишем
+            ASSERT(queue.WriteTo(fds[0]));
+            if (const ssize_t got = recv(fds[1], chunk, 300, 0); got > 0) {
+                received.append(chunk, static_cast<size_t>(got));
+            }
+        }
+    }
+    while (!queue.Empty()) {
+        ASSERT(queue.WriteTo(fds[0]));
+        for (ssize_t got; (got = recv(fds[1], chunk, sizeof(chunk), 0)) > 0;) {
+            received.append(chunk, static_cast<size_t>(got));
+        }
+    }
+    for (ssize_t got; (got = recv(fds[1], chunk, sizeof(chunk), 0)) > 0;) {
+        received.append(chunk, static_cast<size_t>(got));
+    }
+    ASSERT(received == long_expected);
+
+    close(fds[1]);
+    HttpResponse lost(HttpCode::Ok);
+    lost.SetContent("lost");
+    queue.Push(move(lost));
+    ASSERT(!queue.WriteTo(fds[0]));
+    close(fds[0]);
+}
+
+void TestRouter() {
+    Router<int> router;
+    router.Add("GET", "/captcha", 1);
+    router.Add("POST", "/captcha", 2);
+    router.Add("GET", "/", 3);
+    router.Add("GET", "/users/:id", 4);
+    router.Add("GET", "/users/me", 5);
+    router.Add("GET", "/users/:id/comments/:comment", 6);
+    router.Add("GET", "/files/latest/:version/info", 7);
+    router.Add("GET", "/files/:name/raw", 8);
+
+    const auto find = [&router](string_view method, string_view path) {
+        const auto match = router.Find(method, path);
+        return match ? *match.handler : 0;
+    };
+    ASSERT_EQUAL(find("GET", "/captcha"), 1);
+    ASSERT_EQUAL(find("POST", "/captcha"), 2);
+    ASSERT_EQUAL(find("GET", "/"), 3);
+    ASSERT_EQUAL(find("PUT", "/captcha"), 0);
+    for (const string_view path : {"", "captcha", "/captch", "/captcha/", "/captchaa", "//", "/users", "/users/", "/users/7/"}) {
+        AssertEqual(find("GET", path), 0, string(path));
+    }
+
+    // Точное совпадение сегмента важнее параметра
+    ASSERT_EQUAL(find("GET", "/users/me"), 5);
+    {
+        const auto match = router.Find("GET", "/users/7");
+        ASSERT_EQUAL(*match.handler, 4);
+        ASSERT_EQUAL(match.params.Size(), 1u);
+        ASSERT_EQUAL(match.params.Get("id"), "7");
+        ASSERT_EQUAL(match.params.Get("name"), "");
+    }
+    {
+        const string path = "/users/me/comments/15";
+        const auto match = router.Find("GET", path);
+        ASSERT_EQUAL(*match.handler, 6);
+        ASSERT_EQUAL(match.params[0].first, "id");
+        ASSERT_EQUAL(match.params[0].second, "me");
+        ASSERT_EQUAL(match.params[1].first, "comment");
+        ASSERT_EQUAL(match.params[1].second, "15");
+        // Значения ссылаются на путь запроса
+        ASSERT(match.params[1].second.data() == path.data() + path.size() - 2);
+    }
+    {
+        // "latest" совпадает со статическим сегментом, но дальше пути нет,
+        // и поиск возвращается к параметру :name
+        const auto match = router.Find("GET", "/files/latest/raw");
+        ASSERT_EQUAL(*match.handler, 8);
+        ASSERT_EQUAL(match.params.Get("name"), "latest");
+        ASSERT_EQUAL(find("GET", "/files/latest/3/info"), 7);
+        ASSERT_EQUAL(find("GET", "/files/old/3/info"), 0);
+    }
+
+    // Много статических маршрутов: все находятся, соседние пути - нет
+    Router<int> large;
+    for (int i = 0; i < 1000; ++i) {
+        large.Add(i % 2 ? "POST" : "GET", "/route" + to_string(i), i);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        const string path = "/route" + to_string(i);
+        const auto match = large.Find(i % 2 ? "POST" : "GET", path);
+        AssertEqual(match ? *match.handler : -1, i, path);
+        AssertEqual(static_cast<bool>(large.Find(i % 2 ? "GET" : "POST", path)), false, path);
+        AssertEqual(static_cast<bool>(large.Find("GET", path + "x")), false, path);
+    }
+
+    for (const auto& [method, path] : vector<pair<string, string>>{
+        {"GET", "/captcha"}, {"GET", "/users/:user"}, {"GET", "relative"}, {"GET", "/a/:"},
+    }) {
+        bool thrown = false;
+        try {
+            router.Add(method, path, 0);
+        } catch (const exception&) {
+            thrown = true;
+        }
+        Assert(thrown, "no exception for " + path);
+    }
+}
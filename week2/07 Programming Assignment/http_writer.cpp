@@ -0,0 +1,146 @@
+#include "http_writer.h"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+    // Больше элементов за один sendmsg не даёт выигрыша, а массив живёт на стеке
+    const size_t max_iov = 64;
+
+}
+
+string_view StatusLine(HttpCode code) {
+    switch (code) {
+        case HttpCode::Ok:
+            return "HTTP/1.1 200 OK\n";
+        case HttpCode::Found:
+            return "HTTP/1.1 302 Found\n";
+        case HttpCode::NotFound:
+            return "HTTP/1.1 404 Not found\n";
+        case HttpCode::BadRequest:
+            return "HTTP/1.1 400 Bad request\n";
+        case HttpCode::PayloadTooLarge:
+            return "HTTP/1.1 413 Payload too large\n";
+        default:
+            throw invalid_argument("Unknown http code");
+    }
+}
+
+void AppendResponseHead(const HttpResponse& response, string& out) {
+    out += StatusLine(response.GetCode());
+    for (const auto& header : response.GetHeaders()) {
+        out.append(header.name).append(": ").append(header.value) += '\n';
+    }
+    if (const size_t size = response.GetContentSize(); size > 0) {
+        char digits[20];
+        const char* const digits_end = to_chars(begin(digits), end(digits), size).ptr;
+        out.append("Content-Length: ").append(digits, digits_end - digits) += '\n';
+    }
+    out += '\n';
+}
+
+size_t ResponseQueue::Entry::PieceCount() const {
+    return 1 + parts.size();
+}
+
+string_view ResponseQueue::Entry::Piece(size_t index) const {
+    return index == 0 ? string_view(body) : parts[index - 1];
+}
+
+void ResponseQueue::Push(HttpResponse&& response) {
+    // Пока клиент читает ответы, очередь может не опустеть ни разу, и тогда
+    // отправленные заголовки копились бы в heads без конца. Сдвигаем буфер,
+    // когда отправленное начало занимает большую его часть: копирование
+    // остатка окупается тем, что он меньше удаляемого
+    if (head_sent >= compact_threshold && head_sent >= heads.size() / 2) {
+        heads.erase(0, head_sent);
+        for (Entry& entry : entries) {
+            entry.head_end -= head_sent;
+        }
+        head_sent = 0;
+    }
+
+    const size_t head_begin = heads.size();
+    AppendResponseHead(response, heads);
+    pending += heads.size() - head_begin + response.GetContentSize();
+    string body = move(response).TakeContent();
+    entries.push_back({heads.size(), move(body), move(response).TakeContentParts()});
+}
+
+bool ResponseQueue::Empty() const {
+    return entries.empty();
+}
+
+size_t ResponseQueue::PendingBytes() const {
+    return pending;
+}
+
+bool ResponseQueue::WriteTo(int fd) {
+    while (!entries.empty()) {
+        iovec iov[max_iov];
+        size_t count = 0;
+        size_t head_begin = head_sent;
+        size_t first_piece = piece_sent;
+        size_t offset = piece_offset;
+        for (auto it = entries.begin(); it != entries.end() && count < max_iov; ++it) {
+            if (head_begin < it->head_end) {
+                iov[count++] = {heads.data() + head_begin, it->head_end - head_begin};
+            }
+            for (size_t i = first_piece; i < it->PieceCount() && count < max_iov; ++i) {
+                const string_view piece = it->Piece(i).substr(offset);
+                if (!piece.empty()) {
+                    iov[count++] = {const_cast<char*>(piece.data()), piece.size()};
+                }
+                offset = 0;
+            }
+            head_begin = it->head_end;
+            first_piece = 0;
+        }
+
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        const ssize_t sent = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        Advance(static_cast<size_t>(sent));
+    }
+    heads.clear();
+    head_sent = 0;
+    return true;
+}
+
+void ResponseQueue::Advance(size_t sent) {
+    pending -= sent;
+    while (!entries.empty()) {
+        const Entry& front = entries.front();
+        const size_t head_part = min(sent, front.head_end - head_sent);
+        head_sent += head_part;
+        sent -= head_part;
+        if (head_sent < front.head_end) {
+            return;
+        }
+        for (; piece_sent < front.PieceCount(); ++piece_sent, piece_offset = 0) {
+            const size_t piece_part = min(sent, front.Piece(piece_sent).size() - piece_offset);
+            piece_offset += piece_part;
+            sent -= piece_part;
+            if (piece_offset < front.Piece(piece_sent).size()) {
+                return;
+            }
+        }
+        entries.pop_front();
+        piece_sent = 0;
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "http.h"
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Статусная строка ответа вместе с переводом строки, например "HTTP/1.1 200 OK\n"
+std::string_view StatusLine(HttpCode code);
+
+// Дописывает в out всё, что operator<<(ostream&, const HttpResponse&) выводит
+// перед телом: статусную строку, заголовки, Content-Length и пустую строку.
+// Вместе с телом получаются те же байты, что и у operator<<
+void AppendResponseHead(const HttpResponse& response, std::string& out);
+
+// Очередь ответов одного соединения. Заголовки всех ответов пишутся в один
+// буфер, который очищается, когда очередь опустела, и сдвигается, когда
+// отправленная часть переросла compact_threshold, а тела и куски тел
+// (SetContentParts) забираются из ответов без копирования и уходят в сокет
+// отдельными элементами sendmsg
+class ResponseQueue {
+public:
+    void Push(HttpResponse&& response);
+
+    bool Empty() const;
+    size_t PendingBytes() const;
+
+    // Отправляет в сокет сколько получится. Возвращает false при ошибке сокета;
+    // если сокет переполнен, возвращает true и оставляет остаток в очереди
+    bool WriteTo(int fd);
+
+private:
+    struct Entry {
+        // Заголовки ответа занимают heads до этой позиции
+        size_t head_end;
+        // Тело ответа - body, за которым идут parts
+        std::string body;
+        std::vector<std::string_view> parts;
+
+        size_t PieceCount() const;
+        std::string_view Piece(size_t index) const;
+    };
+
+    static constexpr size_t compact_threshold = 1 << 16;
+
+    std::string heads;
+    std::deque<Entry> entries;
+    // Отправленная часть heads, а у первого ответа - число отправленных
+    // кусков тела и байтов следующего куска
+    size_t head_sent = 0;
+    size_t piece_sent = 0;
+    size_t piece_offset = 0;
+    size_t pending = 0;
+
+    void Advance(size_t sent);
+};
+
+void TestResponseWriter();
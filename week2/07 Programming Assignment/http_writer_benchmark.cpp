@@ -0,0 +1,107 @@
+// Сравнение отправки ответов через operator<< в строковый поток и через
+// ResponseQueue. Ответы пишутся в сокет, из которого читает отдельный поток,
+// так что в замер входят и системные вызовы:
+//   http_writer_benchmark [responses=2000000] [body_size=83]
+
+#include "http_writer.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+    // Пачка, после которой сервер отправлял накопленные ответы: столько
+    // ответов приходит на один конвейер запросов
+    const size_t batch = 16;
+
+    HttpResponse MakeResponse(size_t i, const string& body) {
+        switch (i % 4) {
+            case 0:
+                return HttpResponse(HttpCode::Ok).SetContent(body);
+            case 1:
+                return HttpResponse(HttpCode::Found).AddHeader("Location", "/captcha");
+            case 2:
+                return HttpResponse(HttpCode::Ok);
+            default:
+                return HttpResponse(HttpCode::Ok).SetContent(to_string(i));
+        }
+    }
+
+    void SendAll(int fd, const string& data) {
+        for (size_t sent = 0; sent < data.size();) {
+            const ssize_t got = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (got <= 0) {
+                throw runtime_error("send failed");
+            }
+            sent += static_cast<size_t>(got);
+        }
+    }
+
+    double Measure(const string& name, size_t count, const function<void(int)>& run) {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        thread reader([fd = fds[1]] {
+            char buffer[1 << 16];
+            while (recv(fd, buffer, sizeof(buffer), 0) > 0) {
+            }
+        });
+
+        const auto start = steady_clock::now();
+        run(fds[0]);
+        const double seconds = duration<double>(steady_clock::now() - start).count();
+
+        shutdown(fds[0], SHUT_WR);
+        reader.join();
+        close(fds[0]);
+        close(fds[1]);
+
+        const double rate = count / seconds;
+        cout << setw(28) << left << name << fixed << setprecision(0) << rate << " responses/s" << endl;
+        return rate;
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    const size_t count = argc > 1 ? stoul(argv[1]) : 2000000;
+    const string body(argc > 2 ? stoul(argv[2]) : 83, 'x');
+
+    const double stream_rate = Measure("ostream + send", count, [&](int fd) {
+        ostringstream response_output;
+        string output;
+        for (size_t i = 0; i < count; ++i) {
+            response_output.str({});
+            response_output << MakeResponse(i, body);
+            output += response_output.str();
+            if ((i + 1) % batch == 0) {
+                SendAll(fd, output);
+                output.clear();
+            }
+        }
+        SendAll(fd, output);
+    });
+
+    const double queue_rate = Measure("ResponseQueue + sendmsg", count, [&](int fd) {
+        ResponseQueue queue;
+        for (size_t i = 0; i < count; ++i) {
+            queue.Push(MakeResponse(i, body));
+            if ((i + 1) % batch == 0 && !queue.WriteTo(fd)) {
+                throw runtime_error("sendmsg failed");
+            }
+        }
+        queue.WriteTo(fd);
+    });
+
+    cout << "Speedup: " << setprecision(2) << queue_rate / stream_rate << "x" << endl;
+}
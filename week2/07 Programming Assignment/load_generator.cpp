@@ -0,0 +1,306 @@
+// Нагрузочный клиент для HttpServer с CommentServer:
+//   load_generator <port> [connections=16] [pipeline=16] [seconds=5] [mixed|captcha]
+// Каждое соединение держит pipeline запросов в полёте и на каждый ответ
+// отправляет следующий запрос. Задержка запроса - время от его отправки до
+// получения ответа. В конце печатаются число запросов в секунду и перцентили задержки.
+// Сценарий mixed на каждом соединении создаёт пользователя и по кругу
+// шлёт /add_comment, /captcha и /checkcaptcha, сценарий captcha - только GET /captcha
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+    struct ParsedResponse {
+        int code = 0;
+        string_view content;
+        // Длина ответа вместе с заголовками
+        size_t size = 0;
+    };
+
+    // Ответ в начале data, если он пришёл целиком. Ответ без Content-Length
+    // считается ответом с пустым телом, так их пишет HttpServer
+    bool ParseResponse(string_view data, ParsedResponse& response) {
+        size_t header_end = string_view::npos;
+        for (size_t i = data.find('\n'); i != string_view::npos; i = data.find('\n', i + 1)) {
+            if (i + 1 < data.size() && data[i + 1] == '\n') {
+                header_end = i + 2;
+                break;
+            }
+            if (i + 2 < data.size() && data[i + 1] == '\r' && data[i + 2] == '\n') {
+                header_end = i + 3;
+                break;
+            }
+        }
+        if (header_end == string_view::npos) {
+            return false;
+        }
+
+        const string_view head = data.substr(0, header_end);
+        const size_t code_start = head.find(' ') + 1;
+        from_chars(head.data() + code_start, head.data() + head.size(), response.code);
+
+        size_t content_length = 0;
+        const string_view length_header = "\nContent-Length:";
+        if (const size_t pos = head.find(length_header); pos != string_view::npos) {
+            size_t value_start = pos + length_header.size();
+            while (head[value_start] == ' ') {
+                ++value_start;
+            }
+            from_chars(head.data() + value_start, head.data() + head.size(), content_length);
+        }
+        if (data.size() - header_end < content_length) {
+            return false;
+        }
+        response.content = data.substr(header_end, content_length);
+        response.size = header_end + content_length;
+        return true;
+    }
+
+    int Connect(uint16_t port) {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+            throw runtime_error(string("connect: ") + strerror(errno));
+        }
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+
+    string MakeRequest(string_view method, string_view target, string_view body = {}) {
+        string request;
+        request.append(method).append(" ").append(target).append(" HTTP/1.1\r\nHost: localhost\r\n");
+        if (!body.empty()) {
+            request.append("Content-Length: ").append(to_string(body.size())).append("\r\n");
+        }
+        return request.append("\r\n").append(body);
+    }
+
+    // Синхронный запрос на ещё блокирующем сокете, нужен только для подготовки
+    ParsedResponse RoundTrip(int fd, const string& request, string& buffer) {
+        if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) {
+            throw runtime_error("send failed");
+        }
+        buffer.clear();
+        ParsedResponse response;
+        char chunk[4096];
+        while (!ParseResponse(buffer, response)) {
+            const ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+            if (got <= 0) {
+                throw runtime_error("connection closed during setup");
+            }
+            buffer.append(chunk, static_cast<size_t>(got));
+        }
+        return response;
+    }
+
+    struct Connection {
+        int fd = -1;
+        // Запросы сценария, отправляются по кругу
+        vector<string> requests;
+        size_t next_request = 0;
+        deque<steady_clock::time_point> in_flight;
+        string input;
+        string output;
+        size_t written = 0;
+        bool want_write = false;
+    };
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: " << argv[0] << " <port> [connections=16] [pipeline=16] [seconds=5] [mixed|captcha]\n";
+        return 1;
+    }
+    const auto port = static_cast<uint16_t>(stoi(argv[1]));
+    const int connection_count = argc > 2 ? stoi(argv[2]) : 16;
+    const size_t pipeline = argc > 3 ? stoul(argv[3]) : 16;
+    const double seconds = argc > 4 ? stod(argv[4]) : 5;
+    const string scenario = argc > 5 ? argv[5] : "mixed";
+    if (connection_count <= 0 || pipeline == 0 || (scenario != "mixed" && scenario != "captcha")) {
+        cerr << "Bad arguments\n";
+        return 1;
+    }
+
+    const int epoll_fd = epoll_create1(0);
+    vector<Connection> connections(connection_count);
+    string buffer;
+    for (int i = 0; i < connection_count; ++i) {
+        Connection& connection = connections[i];
+        connection.fd = Connect(port);
+        if (scenario == "mixed") {
+            const auto user = RoundTrip(connection.fd, MakeRequest("POST", "/add_user"), buffer);
+            const string id(user.content);
+            connection.requests = {
+                MakeRequest("POST", "/add_comment", id + " Hello from connection " + to_string(i)),
+                MakeRequest("GET", "/captcha"),
+                MakeRequest("POST", "/checkcaptcha", id + " 42"),
+            };
+        } else {
+            connection.requests = {MakeRequest("GET", "/captcha")};
+        }
+
+        fcntl(connection.fd, F_SETFL, O_NONBLOCK);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<uint32_t>(i);
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection.fd, &event);
+    }
+
+    vector<int64_t> latencies;
+    size_t errors = 0;
+    const auto start = steady_clock::now();
+    const auto deadline = start + duration_cast<steady_clock::duration>(duration<double>(seconds));
+    const auto drain_timeout = 5s;
+    bool sending = true;
+
+    auto enqueue = [&](Connection& connection, size_t count) {
+        const auto now = steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            connection.output += connection.requests[connection.next_request];
+            connection.next_request = (connection.next_request + 1) % connection.requests.size();
+            connection.in_flight.push_back(now);
+        }
+    };
+
+    auto flush = [&](size_t index) {
+        Connection& connection = connections[index];
+        while (connection.written < connection.output.size()) {
+            const ssize_t sent = send(
+                connection.fd, connection.output.data() + connection.written,
+                connection.output.size() - connection.written, MSG_NOSIGNAL
+            );
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                throw runtime_error(string("send: ") + strerror(errno));
+            }
+            connection.written += static_cast<size_t>(sent);
+        }
+        if (connection.written == connection.output.size()) {
+            connection.output.clear();
+            connection.written = 0;
+        }
+        const bool want_write = !connection.output.empty();
+        if (want_write != connection.want_write) {
+            epoll_event event{};
+            event.events = EPOLLIN | (want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+            event.data.u32 = static_cast<uint32_t>(index);
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+            connection.want_write = want_write;
+        }
+    };
+
+    for (size_t i = 0; i < connections.size(); ++i) {
+        enqueue(connections[i], pipeline);
+        flush(i);
+    }
+
+    size_t outstanding = connections.size() * pipeline;
+    epoll_event events[256];
+    char chunk[1 << 16];
+    while (outstanding > 0) {
+        const auto now = steady_clock::now();
+        if (sending && now >= deadline) {
+            sending = false;
+        }
+        // После окончания замера ждём оставшиеся ответы, но не вечно
+        if (!sending && now >= deadline + drain_timeout) {
+            break;
+        }
+        const int count = epoll_wait(epoll_fd, events, 256, 100);
+        for (int e = 0; e < count; ++e) {
+            const size_t index = events[e].data.u32;
+            Connection& connection = connections[index];
+            if (events[e].events & EPOLLOUT) {
+                flush(index);
+            }
+            if (!(events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                continue;
+            }
+            const ssize_t got = recv(connection.fd, chunk, sizeof(chunk), 0);
+            if (got <= 0) {
+                if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    continue;
+                }
+                cerr << "Connection " << index << " closed by server\n";
+                outstanding -= connection.in_flight.size();
+                connection.in_flight.clear();
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection.fd, nullptr);
+                continue;
+            }
+            connection.input.append(chunk, static_cast<size_t>(got));
+
+            const auto received_at = steady_clock::now();
+            size_t parsed = 0;
+            size_t completed = 0;
+            ParsedResponse response;
+            while (!connection.in_flight.empty() && ParseResponse(string_view(connection.input).substr(parsed), response)) {
+                parsed += response.size;
+                errors += response.code == 404;
+                latencies.push_back(duration_cast<nanoseconds>(received_at - connection.in_flight.front()).count());
+                connection.in_flight.pop_front();
+                ++completed;
+            }
+            connection.input.erase(0, parsed);
+            outstanding -= completed;
+            if (sending) {
+                enqueue(connection, completed);
+                outstanding += completed;
+                flush(index);
+            }
+        }
+    }
+    const double elapsed = duration<double>(steady_clock::now() - start).count();
+
+    if (latencies.empty()) {
+        cerr << "No responses received\n";
+        return 1;
+    }
+    auto percentile = [&latencies](double p) {
+        const size_t k = min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()));
+        nth_element(latencies.begin(), latencies.begin() + k, latencies.end());
+        return latencies[k] / 1000.0;
+    };
+    cout << fixed << setprecision(1)
+         << "Requests: " << latencies.size() << " in " << elapsed << " s, "
+         << connection_count << " connections x " << pipeline << " pipelined\n"
+         << "Throughput: " << latencies.size() / elapsed << " requests/s\n"
+         << "Latency: p50 " << percentile(0.5) << " us, p99 " << percentile(0.99) << " us, max "
+         << percentile(1.0) << " us\n";
+    if (errors > 0) {
+        cout << "404 responses: " << errors << "\n";
+    }
+
+    for (const auto& connection : connections) {
+        close(connection.fd);
+    }
+    close(epoll_fd);
+}
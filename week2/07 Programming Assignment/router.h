@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Параметры пути найденного маршрута: для шаблона "/users/:id" и пути
+// "/users/7" это пара ("id", "7"). Имена ссылаются на маршрутизатор, значения -
+// на путь запроса, так что при поиске память не выделяется
+class PathParams {
+public:
+    static constexpr size_t max_size = 8;
+
+    size_t Size() const {
+        return size;
+    }
+
+    const std::pair<std::string_view, std::string_view>& operator[](size_t index) const {
+        return items[index];
+    }
+
+    // Пустая строка, если параметра с таким именем нет
+    std::string_view Get(std::string_view name) const {
+        for (size_t i = 0; i < size; ++i) {
+            if (items[i].first == name) {
+                return items[i].second;
+            }
+        }
+        return {};
+    }
+
+private:
+    template <typename Handler>
+    friend class Router;
+
+    std::array<std::pair<std::string_view, std::string_view>, max_size> items;
+    size_t size = 0;
+};
+
+// Таблица маршрутов: метод и путь запроса -> обработчик.
+// Маршруты без параметров лежат в таблице с идеальным хешированием (hash and
+// displace): у каждой корзины свой сдвиг, подобранный так, чтобы все ключи
+// попали в разные ячейки, и поиск - это один хеш пути и одно сравнение строк.
+// Маршруты с параметрами (":name" вместо сегмента пути) лежат в дереве
+// сегментов, где дети узла отсортированы, а точное совпадение сегмента важнее
+// параметра. Таблица перестраивается при каждом Add, так что маршруты
+// добавляются при запуске, а Find можно вызывать из нескольких потоков
+template <typename Handler>
+class Router {
+public:
+    struct Match {
+        const Handler* handler = nullptr;
+        PathParams params;
+
+        explicit operator bool() const {
+            return handler != nullptr;
+        }
+    };
+
+    Router() : nodes(1) {
+    }
+
+    // path начинается с '/', сегменты вида ":name" совпадают с любым непустым сегментом
+    void Add(std::string_view method, std::string_view path, Handler handler) {
+        if (path.empty() || path[0] != '/') {
+            throw std::invalid_argument("Router: path must start with '/': " + std::string(path));
+        }
+        std::vector<std::string> param_names;
+        ForEachSegment(path, [&param_names](std::string_view segment) {
+            if (!segment.empty() && segment[0] == ':') {
+                if (segment.size() == 1) {
+                    throw std::invalid_argument("Router: unnamed path parameter");
+                }
+                param_names.emplace_back(segment.substr(1));
+            }
+        });
+        if (param_names.size() > PathParams::max_size) {
+            throw std::invalid_argument("Router: too many path parameters in " + std::string(path));
+        }
+
+        if (param_names.empty()) {
+            AddStatic(method, path, std::move(handler));
+        } else {
+            AddDynamic(method, path, std::move(handler), std::move(param_names));
+        }
+    }
+
+    Match Find(std::string_view method, std::string_view path) const {
+        Match match;
+        if (!static_routes.empty()) {
+            const StaticRoute& route = static_routes[slots[Slot(Hash(method, path))]];
+            if (route.method == method && route.path == path) {
+                match.handler = &route.handler;
+                return match;
+            }
+        }
+        if (path.empty() || path[0] != '/') {
+            return match;
+        }
+        std::array<std::string_view, PathParams::max_size> values;
+        if (const Entry* entry = Walk(0, method, path, 1, values, 0)) {
+            match.handler = &entry->handler;
+            match.params.size = entry->param_names.size();
+            for (size_t i = 0; i < match.params.size; ++i) {
+                match.params.items[i] = {entry->param_names[i], values[i]};
+            }
+        }
+        return match;
+    }
+
+private:
+    struct StaticRoute {
+        std::string method, path;
+        Handler handler;
+    };
+
+    struct Entry {
+        std::string method;
+        Handler handler;
+        std::vector<std::string> param_names;
+    };
+
+    struct Node {
+        // Отсортированы по сегменту
+        std::vector<std::pair<std::string, uint32_t>> children;
+        uint32_t param_child = 0;
+        std::vector<Entry> entries;
+    };
+
+    static constexpr uint64_t displace_step = 0x9E3779B97F4A7C15ull;
+
+    std::vector<StaticRoute> static_routes;
+    // Номер маршрута в static_routes для каждой ячейки; пустые ячейки указывают
+    // на любой маршрут, и поиск отбрасывает их сравнением строк
+    std::vector<uint32_t> slots;
+    std::vector<uint64_t> displacements;
+    // Корень - nodes[0], поэтому 0 в param_child значит «нет ребёнка»
+    std::vector<Node> nodes;
+
+    template <typename Callback>
+    static void ForEachSegment(std::string_view path, Callback callback) {
+        for (size_t begin = 1; begin <= path.size();) {
+            const size_t end = std::min(path.find('/', begin), path.size());
+            callback(path.substr(begin, end - begin));
+            begin = end + 1;
+        }
+    }
+
+    static uint64_t Hash(std::string_view method, std::string_view path) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        const auto add = [&hash](char c) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+        };
+        for (char c : method) {
+            add(c);
+        }
+        add(' ');
+        for (char c : path) {
+            add(c);
+        }
+        return hash;
+    }
+
+    static uint64_t Mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    size_t Slot(uint64_t hash) const {
+        const uint64_t displacement = displacements[hash & (displacements.size() - 1)];
+        return Mix(hash + displacement * displace_step) & (slots.size() - 1);
+    }
+
+    void AddStatic(std::string_view method, std::string_view path, Handler handler) {
+        for (const StaticRoute& route : static_routes) {
+            if (route.method == method && route.path == path) {
+                throw std::invalid_argument("Router: duplicate route " + std::string(path));
+            }
+        }
+        static_routes.push_back({std::string(method), std::string(path), std::move(handler)});
+        size_t table_size = 2;
+        while (table_size < static_routes.size() * 2 || !BuildStaticTable(table_size)) {
+            table_size *= 2;
+            // Так бывает, только если у двух разных маршрутов совпали 64-битные хеши
+            if (table_size > static_routes.size() * 64) {
+                static_routes.pop_back();
+                BuildStaticTable(table_size);
+                throw std::logic_error("Router: hash collision for " + std::string(path));
+            }
+        }
+    }
+
+    // Раскладывает static_routes по table_size ячейкам без коллизий; false, если
+    // для какой-то корзины не нашлось сдвига и таблицу надо увеличить
+    bool BuildStaticTable(size_t table_size) {
+        const size_t route_count = static_routes.size();
+        size_t bucket_count = 1;
+        while (bucket_count * 2 < route_count) {
+            bucket_count *= 2;
+        }
+
+        std::vector<uint64_t> hashes(route_count);
+        std::vector<std::vector<uint32_t>> buckets(bucket_count);
+        for (size_t i = 0; i < route_count; ++i) {
+            hashes[i] = Hash(static_routes[i].method, static_routes[i].path);
+            buckets[hashes[i] & (bucket_count - 1)].push_back(static_cast<uint32_t>(i));
+        }
+        // Большие корзины раскладываем первыми, пока свободных ячеек больше
+        std::vector<uint32_t> order(bucket_count);
+        for (size_t i = 0; i < bucket_count; ++i) {
+            order[i] = static_cast<uint32_t>(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t lhs, uint32_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        slots.assign(table_size, 0);
+        displacements.assign(bucket_count, 0);
+        std::vector<bool> used(table_size);
+        std::vector<size_t> bucket_slots;
+        for (uint32_t bucket : order) {
+            bool placed = false;
+            for (uint64_t displacement = 0; !placed && displacement < 4 * table_size; ++displacement) {
+                displacements[bucket] = displacement;
+                bucket_slots.clear();
+                placed = true;
+                for (uint32_t route : buckets[bucket]) {
+                    const size_t slot = Slot(hashes[route]);
+                    if (used[slot] || std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+                        placed = false;
+                        break;
+                    }
+                    bucket_slots.push_back(slot);
+                }
+            }
+            if (!placed) {
+                return false;
+            }
+            for (size_t i = 0; i < bucket_slots.size(); ++i) {
+                used[bucket_slots[i]] = true;
+                slots[bucket_slots[i]] = buckets[bucket][i];
+            }
+        }
+        return true;
+    }
+
+    void AddDynamic(std::string_view method, std::string_view path, Handler handler,
+                    std::vector<std::string> param_names) {
+        uint32_t node = 0;
+        ForEachSegment(path, [this, &node](std::string_view segment) {
+            if (!segment.empty() && segment[0] == ':') {
+                if (nodes[node].param_child == 0) {
+                    nodes[node].param_child = NewNode();
+                }
+                node = nodes[node].param_child;
+                return;
+            }
+            auto& children = nodes[node].children;
+            auto it = LowerBound(children, segment);
+            if (it == children.end() || it->first != segment) {
+                const uint32_t child = NewNode();
+                // nodes могли переехать вместе с children
+                auto& new_children = nodes[node].children;
+                it = new_children.insert(LowerBound(new_children, segment), {std::string(segment), child});
+            }
+            node = it->second;
+        });
+        for (const Entry& entry : nodes[node].entries) {
+            if (entry.method == method) {
+                throw std::invalid_argument("Router: duplicate route " + std::string(path));
+            }
+        }
+        nodes[node].entries.push_back({std::string(method), std::move(handler), std::move(param_names)});
+    }
+
+    uint32_t NewNode() {
+        nodes.emplace_back();
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    template <typename Children>
+    static auto LowerBound(Children& children, std::string_view segment) {
+        return std::lower_bound(children.begin(), children.end(), segment,
+                                [](const auto& child, std::string_view value) {
+                                    return std::string_view(child.first) < value;
+                                });
+    }
+
+    // Ищет маршрут для сегментов пути, начиная с позиции begin; values[0, count) -
+    // значения параметров, собранные по дороге
+    const Entry* Walk(uint32_t node_index, std::string_view method, std::string_view path, size_t begin,
+                      std::array<std::string_view, PathParams::max_size>& values, size_t count) const {
+        const Node& node = nodes[node_index];
+        if (begin > path.size()) {
+            for (const Entry& entry : node.entries) {
+                if (entry.method == method) {
+                    return &entry;
+                }
+            }
+            return nullptr;
+        }
+
+        const size_t end = std::min(path.find('/', begin), path.size());
+        const std::string_view segment = path.substr(begin, end - begin);
+        if (const auto it = LowerBound(node.children, segment); it != node.children.end() && it->first == segment) {
+            if (const Entry* entry = Walk(it->second, method, path, end + 1, values, count)) {
+                return entry;
+            }
+        }
+        if (node.param_child != 0 && !segment.empty() && count < values.size()) {
+            values[count] = segment;
+            return Walk(node.param_child, method, path, end + 1, values, count + 1);
+        }
+        return nullptr;
+    }
+};
+
+void TestRouter();
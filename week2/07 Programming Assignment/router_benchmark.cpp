@@ -0,0 +1,125 @@
+// Поиск маршрута среди 1000 маршрутов: Router против цепочки сравнений строк,
+// как в прежнем CommentServer::ServeRequest, и против unordered_map с ключом
+// "метод путь", который приходится склеивать на каждый запрос:
+//   router_benchmark [lookups=2000000]
+
+#include "router.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+    const int route_count = 1000;
+
+    struct Route {
+        string method, path;
+    };
+
+    // Половина маршрутов статические, половина с параметром
+    vector<Route> MakeRoutes() {
+        vector<Route> routes;
+        for (int i = 0; i < route_count / 2; ++i) {
+            routes.push_back({i % 3 ? "GET" : "POST", "/api/v" + to_string(i % 4) + "/resource" + to_string(i)});
+            routes.push_back({"GET", "/api/v1/resource" + to_string(i) + "/:id/items"});
+        }
+        return routes;
+    }
+
+    // Запросы к существующим маршрутам вперемешку с промахами
+    vector<Route> MakeRequests(const vector<Route>& routes, size_t count) {
+        mt19937 gen(42);
+        vector<Route> requests;
+        requests.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            Route request = routes[gen() % routes.size()];
+            if (const size_t param = request.path.find(":id"); param != string::npos) {
+                request.path.replace(param, 3, to_string(gen() % 100000));
+            }
+            if (gen() % 8 == 0) {
+                request.path += "x";
+            }
+            requests.push_back(move(request));
+        }
+        return requests;
+    }
+
+    template <typename Find>
+    void Measure(const string& name, const vector<Route>& requests, Find find) {
+        size_t found = 0;
+        const auto start = steady_clock::now();
+        for (const Route& request : requests) {
+            found += find(request.method, request.path);
+        }
+        const double ns = duration<double, nano>(steady_clock::now() - start).count() / requests.size();
+        cout << setw(24) << left << name << fixed << setprecision(1) << ns << " ns/lookup, found " << found << endl;
+    }
+
+    // Сегмент шаблона ":id" совпадает с любым непустым сегментом пути
+    bool MatchPattern(string_view pattern, string_view path) {
+        while (!pattern.empty() && !path.empty()) {
+            const size_t pattern_end = min(pattern.find('/', 1), pattern.size());
+            const size_t path_end = min(path.find('/', 1), path.size());
+            const string_view segment = pattern.substr(0, pattern_end);
+            if (segment.substr(0, 2) == "/:" ? path_end < 2 : segment != path.substr(0, path_end)) {
+                return false;
+            }
+            pattern.remove_prefix(pattern_end);
+            path.remove_prefix(path_end);
+        }
+        return pattern.empty() && path.empty();
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+    const size_t count = argc > 1 ? stoul(argv[1]) : 2000000;
+    const vector<Route> routes = MakeRoutes();
+    const vector<Route> requests = MakeRequests(routes, count);
+
+    Router<int> router;
+    unordered_map<string, int> static_routes;
+    for (size_t i = 0; i < routes.size(); ++i) {
+        router.Add(routes[i].method, routes[i].path, static_cast<int>(i));
+        static_routes[routes[i].method + " " + routes[i].path] = static_cast<int>(i);
+    }
+
+    vector<Route> static_requests;
+    vector<Route> param_requests;
+    for (const Route& request : requests) {
+        (request.path.find("/items") == string::npos ? static_requests : param_requests).push_back(request);
+    }
+
+    const auto find_route = [&router](string_view method, string_view path) {
+        return static_cast<bool>(router.Find(method, path));
+    };
+    const auto find_in_chain = [&routes](string_view method, string_view path) {
+        for (const Route& route : routes) {
+            if (route.method == method && MatchPattern(route.path, path)) {
+                return true;
+            }
+        }
+        return false;
+    };
+    // Так находятся только статические маршруты
+    const auto find_in_map = [&static_routes](string_view method, string_view path) {
+        return static_routes.count(string(method) + " " + string(path)) > 0;
+    };
+
+    cout << "Static routes:" << endl;
+    Measure("Router", static_requests, find_route);
+    Measure("unordered_map", static_requests, find_in_map);
+    Measure("if-chain", static_requests, find_in_chain);
+    cout << "Routes with parameters:" << endl;
+    Measure("Router", param_requests, find_route);
+    Measure("if-chain", param_requests, find_in_chain);
+}
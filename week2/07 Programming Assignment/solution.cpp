@@ -1,22 +1,31 @@
+#include "http.h"
+#include "http_parser.h"
+#include "http_server.h"
+#include "router.h"
 #include "test_runner.h"
 
+#include <charconv>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <sstream>
 #include <utility>
 #include <map>
 #include <optional>
-#include <unordered_set>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <system_error>
+#include <thread>
 
 using namespace std;
 
-struct HttpRequest {
-    string method, path, body;
-    map<string, string> get_params;
-};
-
-pair<string, string> SplitBy(const string& what, const string& by) {
+pair<string_view, string_view> SplitBy(string_view what, string_view by) {
     size_t pos = what.find(by);
     if (by.size() < what.size() && pos < what.size() - by.size()) {
         return {what.substr(0, pos), what.substr(pos + by.size())};
@@ -25,151 +34,214 @@ pair<string, string> SplitBy(const string& what, const string& by) {
     }
 }
 
+// Число, занимающее всю строку s; nullopt для пустой строки, посторонних
+// символов и переполнения
 template<typename T>
-T FromString(const string& s) {
-    T x;
-    istringstream is(s);
-    is >> x;
+optional<T> FromString(string_view s) {
+    T x{};
+    const auto [ptr, ec] = from_chars(s.data(), s.data() + s.size(), x);
+    if (ec != errc() || ptr != s.data() + s.size()) {
+        return nullopt;
+    }
     return x;
 }
 
-enum class HttpCode {
-    Ok = 200,
-    NotFound = 404,
-    Found = 302,
+struct IdAndContent {
+    size_t id;
+    string_view content;
 };
 
-ostream& operator<<(ostream& output, HttpCode code) {
-    switch (code) {
-        case HttpCode::Ok:
-            output << "200 OK";
-            break;
-        case HttpCode::Found:
-            output << "302 Found";
-            break;
-        case HttpCode::NotFound:
-            output << "404 Not found";
-            break;
-        default:
-            throw invalid_argument("Unknown http code");
-    }
-    return output;
+optional<IdAndContent> ParseIdAndContent(string_view body) {
+    auto [id_string, content] = SplitBy(body, " ");
+    if (const auto id = FromString<size_t>(id_string)) {
+        return IdAndContent{*id, content};
+    }
+    return nullopt;
 }
 
-struct HttpHeader {
-    string name, value;
+struct LastCommentInfo {
+    size_t user_id, consecutive_count;
 };
 
-ostream& operator<<(ostream& output, const HttpHeader& h) {
-    return output << h.name << ": " << h.value;
-}
-
-class HttpResponse {
+// Комментарии пользователя подряд, каждый с завершающим '\n', то есть ровно в
+// том виде, в котором их отдаёт /user_comments. Память выделяется кусками,
+// которые растут вдвое до max_chunk_size, комментарий целиком лежит в одном
+// куске, а куски никогда не перемещаются. Поэтому записанная часть журнала
+// не меняется при дописывании и её можно отправлять без копирования
+class CommentLog {
 public:
-    explicit HttpResponse(HttpCode code) : code(code) {
-    }
-
-    HttpResponse& AddHeader(string name, string value) {
-        headers.push_back(HttpHeader{std::move(name), std::move(value)});
-        return *this;
-    }
-
-    HttpResponse& SetContent(string a_content) {
-        content = std::move(a_content);
-        return *this;
-    }
-
-    HttpResponse& SetCode(HttpCode a_code) {
-        code = a_code;
-        return *this;
+    void Append(string_view comment) {
+        const size_t size = comment.size() + 1;
+        if (chunks.empty() || chunks.back().capacity - chunks.back().size < size) {
+            const size_t next_capacity = chunks.empty()
+                ? min_chunk_size
+                : min(chunks.back().capacity * 2, max_chunk_size);
+            const size_t capacity = max(next_capacity, size);
+            chunks.push_back({unique_ptr<char[]>(new char[capacity]), capacity, 0});
+        }
+        Chunk& chunk = chunks.back();
+        copy(comment.begin(), comment.end(), chunk.data.get() + chunk.size);
+        chunk.data[chunk.size + comment.size()] = '\n';
+        chunk.size += size;
     }
 
-    friend ostream& operator << (ostream& output, const HttpResponse& resp) {
-        output << "HTTP/1.1 " << resp.code << '\n';
-        for (const auto& header : resp.headers) {
-            output << header << '\n';
+    // Записанные на данный момент комментарии, по куску на элемент
+    vector<string_view> Parts() const {
+        vector<string_view> parts;
+        parts.reserve(chunks.size());
+        for (const Chunk& chunk : chunks) {
+            parts.emplace_back(chunk.data.get(), chunk.size);
         }
-        if (!resp.content.empty()) {
-            output << "Content-Length: " << resp.content.size() << '\n';
-        }
-        return output << '\n' << resp.content;
+        return parts;
     }
 
 private:
-    HttpCode code;
-    vector<HttpHeader> headers;
-    string content;
-};
+    static constexpr size_t min_chunk_size = 64;
+    static constexpr size_t max_chunk_size = 1 << 16;
 
-pair<size_t, string> ParseIdAndContent(const string& body) {
-    auto [id_string, content] = SplitBy(body, " ");
-    return {FromString<size_t>(id_string), content};
-}
+    struct Chunk {
+        unique_ptr<char[]> data;
+        size_t capacity, size;
+    };
 
-struct LastCommentInfo {
-    size_t user_id, consecutive_count;
+    vector<Chunk> chunks;
 };
 
+// Состояние CommentServer, которое можно обслуживать из нескольких потоков.
+// Пользователи хранятся блоками, которые не перемещаются, поэтому поиск
+// пользователя не берёт блокировок, а комментарии каждого пользователя защищены
+// своим мьютексом: чтение комментариев одного пользователя не мешает записи
+// комментариев другого.
+// Правило «три комментария подряд» зависит от порядка всех комментариев, поэтому
+// решения о бане принимаются под одним мьютексом spam_mutex. Это короткая
+// секция без выделений памяти, а сам комментарий копируется уже под мьютексом
+// пользователя, который берётся до выхода из spam_mutex. Так комментарии каждого
+// пользователя сохраняются в том же порядке, в котором принимались решения,
+// и любой параллельный сценарий эквивалентен последовательному выполнению
+// запросов в порядке прохождения spam_mutex.
+// Тела ответов /user_comments ссылаются на журналы комментариев, поэтому
+// сервер должен жить, пока эти ответы не отправлены
 class CommentServer {
+public:
+    // Вызывается под spam_mutex для каждого запроса, изменившего состояние
+    // антиспама, в порядке их применения. Нужен, чтобы воспроизвести
+    // параллельный сценарий последовательно
+    using Journal = function<void(const HttpRequest&)>;
+
+    explicit CommentServer(Journal journal = {}) : journal(move(journal)) {
+    }
+
 private:
-    vector<vector<string>> comments_;
+    struct User {
+        mutable shared_mutex mutex;
+        CommentLog comments;
+        // Меняется и читается только под spam_mutex
+        bool banned = false;
+    };
+
+    static constexpr size_t block_bits = 12;
+    static constexpr size_t block_size = size_t(1) << block_bits;
+    static constexpr size_t max_blocks = size_t(1) << 16;
+
+    // Блоки заполняются под users_mutex, а user_count публикует их читателям
+    vector<unique_ptr<User[]>> user_blocks = vector<unique_ptr<User[]>>(max_blocks);
+    atomic<size_t> user_count = 0;
+    mutex users_mutex;
+
+    mutex spam_mutex;
     std::optional<LastCommentInfo> last_comment;
-    unordered_set<size_t> banned_users;
+    Journal journal;
+
+    User* FindUser(size_t user_id) {
+        if (user_id >= user_count.load(memory_order_acquire)) {
+            return nullptr;
+        }
+        return &user_blocks[user_id >> block_bits][user_id & (block_size - 1)];
+    }
 
 public:
     HttpResponse ServeRequest(const HttpRequest& req) {
-        if (req.method == "POST") {
-            if (req.path == "/add_user") {
-                return ServeAddUser(req);
-            } else if (req.path == "/add_comment") {
-                return ServeAddComment(req);
-            } else if (req.path == "/checkcaptcha") {
-                return ServeCheckCaptcha(req);
-            } else {
-                return HttpResponse(HttpCode::NotFound);
-            }
-        } else if (req.method == "GET") {
-            if (req.path == "/user_comments") {
-                return ServeUserComments(req);
-            } else if (req.path == "/captcha") {
-                return ServeCaptcha(req);
-            } else {
-                return HttpResponse(HttpCode::NotFound);
-            }
-        } else {
-            return HttpResponse(HttpCode::NotFound);
+        if (const auto route = Routes().Find(req.method, req.path)) {
+            return (this->*(*route.handler))(req);
         }
+        return HttpResponse(HttpCode::NotFound);
     }
 
 private:
+    using Handler = HttpResponse (CommentServer::*)(const HttpRequest&);
+
+    static const Router<Handler>& Routes() {
+        static const Router<Handler> routes = [] {
+            Router<Handler> routes;
+            routes.Add("POST", "/add_user", &CommentServer::ServeAddUser);
+            routes.Add("POST", "/add_comment", &CommentServer::ServeAddComment);
+            routes.Add("POST", "/checkcaptcha", &CommentServer::ServeCheckCaptcha);
+            routes.Add("GET", "/user_comments", &CommentServer::ServeUserComments);
+            routes.Add("GET", "/captcha", &CommentServer::ServeCaptcha);
+            return routes;
+        }();
+        return routes;
+    }
+
     HttpResponse ServeAddUser(const HttpRequest& request) {
-        comments_.emplace_back();
-        return HttpResponse(HttpCode::Ok).SetContent(to_string(comments_.size() - 1));
+        lock_guard guard(users_mutex);
+        const size_t user_id = user_count.load(memory_order_relaxed);
+        auto& block = user_blocks.at(user_id >> block_bits);
+        if (!block) {
+            block = make_unique<User[]>(block_size);
+        }
+        user_count.store(user_id + 1, memory_order_release);
+        return HttpResponse(HttpCode::Ok).SetContent(to_string(user_id));
     }
 
     HttpResponse ServeAddComment(const HttpRequest& request) {
-        auto [user_id, comment] = ParseIdAndContent(request.body);
-
-        if (!last_comment || last_comment->user_id != user_id) {
-            last_comment = LastCommentInfo {user_id, 1};
-        } else if (++last_comment->consecutive_count > 3) {
-            banned_users.insert(user_id);
+        const auto parsed = ParseIdAndContent(request.body);
+        if (!parsed) {
+            return HttpResponse(HttpCode::NotFound);
+        }
+        const auto [user_id, comment] = *parsed;
+        User* user = FindUser(user_id);
+        if (!user) {
+            return HttpResponse(HttpCode::NotFound);
         }
 
-        if (banned_users.count(user_id) == 0) {
-            comments_[user_id].push_back(comment);
-            return HttpResponse(HttpCode::Ok);
-        } else {
-            return HttpResponse(HttpCode::Found).AddHeader("Location", "/captcha");
+        unique_lock user_lock(user->mutex, defer_lock);
+        {
+            lock_guard guard(spam_mutex);
+            if (!last_comment || last_comment->user_id != user_id) {
+                last_comment = LastCommentInfo {user_id, 1};
+            } else if (++last_comment->consecutive_count > 3) {
+                user->banned = true;
+            }
+            if (journal) {
+                journal(request);
+            }
+            if (user->banned) {
+                return HttpResponse(HttpCode::Found).AddHeader("Location", "/captcha");
+            }
+            user_lock.lock();
         }
+        user->comments.Append(comment);
+        return HttpResponse(HttpCode::Ok);
     }
 
     HttpResponse ServeCheckCaptcha(const HttpRequest& request) {
-        if (auto [id, response] = ParseIdAndContent(request.body); response == "42") {
-            banned_users.erase(id);
+        const auto parsed = ParseIdAndContent(request.body);
+        if (!parsed) {
+            return HttpResponse(HttpCode::NotFound);
+        }
+        if (const auto [id, response] = *parsed; response == "42") {
+            User* user = FindUser(id);
+            lock_guard guard(spam_mutex);
+            if (user) {
+                user->banned = false;
+            }
             if (last_comment && last_comment->user_id == id) {
                 last_comment.reset();
             }
+            if (journal) {
+                journal(request);
+            }
             return HttpResponse(HttpCode::Ok);
         } else {
             return HttpResponse(HttpCode::Found).AddHeader("Location", "/captcha");
@@ -177,13 +249,17 @@ private:
     }
 
     HttpResponse ServeUserComments(const HttpRequest& request) {
-        auto user_id = FromString<size_t>(request.get_params.at("user_id"));
-        string response;
-        for (const string& c : comments_[user_id]) {
-            response += c + '\n';
+        const auto param = request.get_params.find("user_id");
+        if (param == request.get_params.end()) {
+            return HttpResponse(HttpCode::NotFound);
         }
-
-        return HttpResponse(HttpCode::Ok).SetContent(std::move(response));
+        const auto user_id = FromString<size_t>(param->second);
+        const User* user = user_id ? FindUser(*user_id) : nullptr;
+        if (!user) {
+            return HttpResponse(HttpCode::NotFound);
+        }
+        shared_lock lock(user->mutex);
+        return HttpResponse(HttpCode::Ok).SetContentParts(user->comments.Parts());
     }
 
     HttpResponse ServeCaptcha(const HttpRequest&) {
@@ -193,3 +269,259 @@ private:
                 );
     }
 };
+
+string Render(const HttpResponse& response) {
+    ostringstream output;
+    output << response;
+    return output.str();
+}
+
+void TestCommentLog() {
+    CommentLog log;
+    ASSERT(log.Parts().empty());
+
+    string expected;
+    for (int i = 0; i < 100000; ++i) {
+        const string comment = "comment " + to_string(i);
+        log.Append(comment);
+        expected += comment + '\n';
+    }
+    const vector<string_view> parts = log.Parts();
+    const string written = expected;
+
+    // Комментарий длиннее куска и пустой комментарий
+    const string long_comment(100000, 'x');
+    log.Append(long_comment);
+    log.Append("");
+    for (int i = 0; i < 1000; ++i) {
+        log.Append("tail");
+    }
+    expected += long_comment + "\n\n";
+    for (int i = 0; i < 1000; ++i) {
+        expected += "tail\n";
+    }
+
+    // Куски, полученные раньше, не изменились и не переехали
+    string old_content;
+    for (string_view part : parts) {
+        old_content += part;
+    }
+    ASSERT_EQUAL(old_content, written);
+
+    string content;
+    for (string_view part : log.Parts()) {
+        content += part;
+    }
+    ASSERT_EQUAL(content, expected);
+    // Куски растут до 64 КБ, так что на мегабайт их немного
+    ASSERT(log.Parts().size() < 40);
+}
+
+void TestCommentServer() {
+    CommentServer cs;
+    auto test = [&cs](const HttpRequest& request, const HttpResponse& expected) {
+        ASSERT_EQUAL(Render(cs.ServeRequest(request)), Render(expected));
+    };
+
+    const HttpResponse ok(HttpCode::Ok);
+    const HttpResponse redirect_to_captcha = HttpResponse(HttpCode::Found).AddHeader("Location", "/captcha");
+    const HttpResponse not_found(HttpCode::NotFound);
+
+    test({"POST", "/add_user"}, HttpResponse(HttpCode::Ok).SetContent("0"));
+    test({"POST", "/add_user"}, HttpResponse(HttpCode::Ok).SetContent("1"));
+    test({"POST", "/add_comment", "0 Hello"}, ok);
+    test({"POST", "/add_comment", "1 Hi"}, ok);
+    test({"POST", "/add_comment", "1 Buy my goods"}, ok);
+    test({"POST", "/add_comment", "1 Enlarge"}, ok);
+    test({"POST", "/add_comment", "1 Buy my goods"}, redirect_to_captcha);
+    test({"POST", "/add_comment", "0 What are you selling?"}, ok);
+    test({"POST", "/add_comment", "1 Buy my goods"}, redirect_to_captcha);
+    test(
+        {"GET", "/user_comments", "", {{"user_id", "0"}}},
+        HttpResponse(HttpCode::Ok).SetContent("Hello\nWhat are you selling?\n")
+    );
+    test(
+        {"GET", "/user_comments", "", {{"user_id", "1"}}},
+        HttpResponse(HttpCode::Ok).SetContent("Hi\nBuy my goods\nEnlarge\n")
+    );
+    test(
+        {"GET", "/captcha"},
+        HttpResponse(HttpCode::Ok).SetContent(
+            "What's the answer for The Ultimate Question of Life, the Universe, and Everything?"
+        )
+    );
+    test({"POST", "/checkcaptcha", "1 24"}, redirect_to_captcha);
+    test({"POST", "/checkcaptcha", "1 42"}, ok);
+    test({"POST", "/add_comment", "1 Sorry! No spam any more"}, ok);
+    test(
+        {"GET", "/user_comments", "", {{"user_id", "1"}}},
+        HttpResponse(HttpCode::Ok).SetContent("Hi\nBuy my goods\nEnlarge\nSorry! No spam any more\n")
+    );
+
+    test({"GET", "/user_commntes"}, not_found);
+    test({"POST", "/add_uesr"}, not_found);
+    // Запросы из сети могут ссылаться на несуществующих пользователей
+    test({"GET", "/user_comments", "", {{"user_id", "5"}}}, not_found);
+    test({"GET", "/user_comments"}, not_found);
+    test({"POST", "/add_comment", "9 Hello"}, not_found);
+    // Некорректный номер пользователя - не пользователь 0
+    test({"POST", "/add_comment", "x Hello"}, not_found);
+    test({"POST", "/add_comment", "0x Hello"}, not_found);
+    test({"POST", "/add_comment", "99999999999999999999999 Hello"}, not_found);
+    test({"POST", "/checkcaptcha", "-1 42"}, not_found);
+    test({"GET", "/user_comments", "", {{"user_id", ""}}}, not_found);
+    test({"GET", "/user_comments", "", {{"user_id", "0abc"}}}, not_found);
+}
+
+// Несколько потоков одновременно пишут комментарии, проходят капчу и читают
+// комментарии. Журнал фиксирует порядок, в котором сервер применил запросы;
+// последовательное воспроизведение журнала на новом сервере должно дать те же
+// ответы и те же комментарии
+void TestCommentServerReplay() {
+    const size_t user_count = 6;
+    const int writer_count = 4;
+    const int requests_per_writer = 3000;
+
+    vector<pair<string, string>> journal;
+    CommentServer cs([&journal](const HttpRequest& request) {
+        journal.emplace_back(request.path, request.body);
+    });
+    for (size_t i = 0; i < user_count; ++i) {
+        cs.ServeRequest({"POST", "/add_user"});
+    }
+
+    // Исключения из потоков не долетят до TestRunner, поэтому потоки только
+    // собирают ответы, а проверяются они после join
+    vector<map<string, string>> responses(writer_count);
+    vector<int> wrong_captcha_responses(writer_count);
+    vector<thread> writers;
+    for (int writer = 0; writer < writer_count; ++writer) {
+        writers.emplace_back([&, writer] {
+            mt19937 gen(writer);
+            size_t user_id = writer;
+            for (int i = 0; i < requests_per_writer; ++i) {
+                // Чаще пишем от того же пользователя, чтобы срабатывал антиспам
+                if (gen() % 3 == 0) {
+                    user_id = gen() % user_count;
+                }
+                if (gen() % 8 == 0) {
+                    const string body = to_string(user_id) + (gen() % 4 ? " 42" : " 24");
+                    const string response = Render(cs.ServeRequest({"POST", "/checkcaptcha", body}));
+                    const bool passed = body.substr(body.size() - 2) == "42";
+                    wrong_captcha_responses[writer] += response != Render(
+                        passed ? HttpResponse(HttpCode::Ok)
+                               : HttpResponse(HttpCode::Found).AddHeader("Location", "/captcha"));
+                } else {
+                    const string body = to_string(user_id) + " w" + to_string(writer) + "-" + to_string(i);
+                    responses[writer][body] = Render(cs.ServeRequest({"POST", "/add_comment", body}));
+                }
+            }
+        });
+    }
+
+    // Читатели работают одновременно с писателями: каждый прочитанный список
+    // должен быть началом итогового списка комментариев пользователя
+    atomic<bool> writing = true;
+    vector<vector<pair<size_t, string>>> snapshots(2);
+    vector<thread> readers;
+    for (size_t reader = 0; reader < snapshots.size(); ++reader) {
+        readers.emplace_back([&, reader] {
+            for (size_t i = 0; writing; ++i) {
+                const size_t user_id = i % user_count;
+                const string id = to_string(user_id);
+                HttpRequest request{"GET", "/user_comments"};
+                request.get_params["user_id"] = id;
+                const string content = cs.ServeRequest(request).GetContent();
+                if (i % 16 == 0) {
+                    snapshots[reader].emplace_back(user_id, content);
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    writing = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQUAL(wrong_captcha_responses, vector<int>(writer_count));
+
+    CommentServer replay;
+    for (size_t i = 0; i < user_count; ++i) {
+        replay.ServeRequest({"POST", "/add_user"});
+    }
+    map<string, string> replayed;
+    for (const auto& [path, body] : journal) {
+        const string response = Render(replay.ServeRequest({"POST", path, body}));
+        if (path == "/add_comment") {
+            replayed[body] = response;
+        }
+    }
+
+    size_t redirects = 0;
+    size_t comment_requests = 0;
+    for (const auto& writer_responses : responses) {
+        comment_requests += writer_responses.size();
+        for (const auto& [body, response] : writer_responses) {
+            AssertEqual(replayed.count(body) ? replayed.at(body) : "<missing>", response, body);
+            redirects += response != Render(HttpResponse(HttpCode::Ok));
+        }
+    }
+    ASSERT_EQUAL(replayed.size(), comment_requests);
+    ASSERT(redirects > 0);
+
+    vector<string> final_comments;
+    for (size_t user_id = 0; user_id < user_count; ++user_id) {
+        HttpRequest request{"GET", "/user_comments"};
+        const string id = to_string(user_id);
+        request.get_params["user_id"] = id;
+        final_comments.push_back(cs.ServeRequest(request).GetContent());
+        ASSERT_EQUAL(final_comments.back(), replay.ServeRequest(request).GetContent());
+    }
+    for (const auto& reader_snapshots : snapshots) {
+        for (const auto& [user_id, content] : reader_snapshots) {
+            ASSERT(final_comments[user_id].compare(0, content.size(), content) == 0);
+        }
+    }
+}
+
+// Без аргументов запускает тесты, с номером порта - ещё и обслуживает
+// CommentServer по HTTP на 127.0.0.1:<port> в заданном числе потоков
+int main(int argc, char* argv[]) {
+    {
+        TestRunner tr;
+        RUN_TEST(tr, TestHttpParser);
+        RUN_TEST(tr, TestResponseWriter);
+        RUN_TEST(tr, TestRouter);
+        RUN_TEST(tr, TestHttpServer);
+        RUN_TEST(tr, TestCommentLog);
+        RUN_TEST(tr, TestCommentServer);
+        RUN_TEST(tr, TestCommentServerReplay);
+    }
+
+    if (argc > 1) {
+        const int thread_count = argc > 2 ? max(stoi(argv[2]), 1) : 1;
+        CommentServer comments;
+        const auto handler = [&comments](const HttpRequest& request) {
+            return comments.ServeRequest(request);
+        };
+        // Каждый поток со своим HttpServer на общем порту, соединения между
+        // ними распределяет ядро
+        vector<unique_ptr<HttpServer>> servers;
+        servers.push_back(make_unique<HttpServer>(handler, static_cast<uint16_t>(stoi(argv[1]))));
+        while (static_cast<int>(servers.size()) < thread_count) {
+            servers.push_back(make_unique<HttpServer>(handler, servers.front()->Port()));
+        }
+        cerr << "Listening on 127.0.0.1:" << servers.front()->Port()
+             << " in " << thread_count << " threads" << endl;
+        vector<thread> loops;
+        for (size_t i = 1; i < servers.size(); ++i) {
+            loops.emplace_back([&server = *servers[i]] { server.Run(); });
+        }
+        servers.front()->Run();
+        for (auto& loop : loops) {
+            loop.join();
+        }
+    }
+}
@@ -1,5 +1,8 @@
 #include "UnitTestsFramework.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 
 void Assert(bool cond, const std::string& hint)
 {
@@ -7,17 +10,251 @@ void Assert(bool cond, const std::string& hint)
 }
 
 
+TestRunnerOptions TestRunnerOptions::FromEnvironment()
+{
+	TestRunnerOptions options;
+	if (const char* filter = std::getenv("TEST_FILTER"))
+	{
+		options.filter = filter;
+	}
+	if (const char* threads = std::getenv("TEST_THREADS"))
+	{
+		options.threads = std::stoul(threads);
+		if (options.threads == 0)
+		{
+			options.threads = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+	}
+	if (const char* budget = std::getenv("TEST_TIME_BUDGET_MS"))
+	{
+		options.time_budget = std::chrono::milliseconds(std::stoll(budget));
+	}
+	return options;
+}
+
+
+bool MatchesPattern(const std::string& name, const std::string& pattern)
+{
+	if (pattern.find_first_of("*?") == std::string::npos)
+	{
+		return name.find(pattern) != std::string::npos;
+	}
+	// Жадный разбор с откатом к последней звёздочке
+	size_t n = 0, p = 0, star = std::string::npos, star_n = 0;
+	while (n < name.size())
+	{
+		if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+		{
+			++n;
+			++p;
+		}
+		else if (p < pattern.size() && pattern[p] == '*')
+		{
+			star = p++;
+			star_n = n;
+		}
+		else if (star != std::string::npos)
+		{
+			p = star + 1;
+			n = ++star_n;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	while (p < pattern.size() && pattern[p] == '*')
+	{
+		++p;
+	}
+	return p == pattern.size();
+}
+
+
+CapturingStreambuf::CapturingStreambuf(std::streambuf* original)
+	: original(original)
+{
+}
+
+
+std::string*& CapturingStreambuf::Target()
+{
+	static thread_local std::string* target = nullptr;
+	return target;
+}
+
+
+std::streambuf* CapturingStreambuf::Original() const
+{
+	return original;
+}
+
+
+int CapturingStreambuf::overflow(int c)
+{
+	if (c == traits_type::eof())
+	{
+		return traits_type::not_eof(c);
+	}
+	const char ch = traits_type::to_char_type(c);
+	return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+}
+
+
+std::streamsize CapturingStreambuf::xsputn(const char* s, std::streamsize n)
+{
+	if (std::string* target = Target())
+	{
+		target->append(s, n);
+		return n;
+	}
+	std::lock_guard<std::mutex> guard(m);
+	return original->sputn(s, n);
+}
+
+
+int CapturingStreambuf::sync()
+{
+	return Target() != nullptr ? 0 : original->pubsync();
+}
+
+
 TestRunner::TestRunner()
+	: TestRunner(TestRunnerOptions::FromEnvironment())
+{
+}
+
+
+TestRunner::TestRunner(TestRunnerOptions options)
+	: options(std::move(options))
+	, start(std::chrono::steady_clock::now())
 {
-	fail_count = 0;
+	if (this->options.threads > 1)
+	{
+		cout_capture = std::make_unique<CapturingStreambuf>(std::cout.rdbuf());
+		cerr_capture = std::make_unique<CapturingStreambuf>(std::cerr.rdbuf());
+		std::cout.rdbuf(cout_capture.get());
+		std::cerr.rdbuf(cerr_capture.get());
+		for (size_t i = 0; i < this->options.threads; ++i)
+		{
+			workers.emplace_back([this] { Work(); });
+		}
+	}
 }
 
 
 TestRunner::~TestRunner()
 {
+	if (!workers.empty())
+	{
+		{
+			std::lock_guard<std::mutex> guard(m);
+			closed = true;
+		}
+		work_ready.notify_all();
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+		std::cout.rdbuf(cout_capture->Original());
+		std::cerr.rdbuf(cerr_capture->Original());
+	}
+	if (skip_count > 0 || !workers.empty())
+	{
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		std::cerr << run_count << " tests run, " << skip_count << " skipped in "
+			<< std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms" << std::endl;
+	}
 	if (fail_count > 0)
 	{
 		std::cerr << fail_count << " tests failed. Terminate";
 		exit(1);
 	}
 }
+
+
+bool TestRunner::Selected(const std::string& test_name) const
+{
+	if (options.filter.empty())
+	{
+		return true;
+	}
+	std::istringstream patterns(options.filter);
+	for (std::string pattern; std::getline(patterns, pattern, ',');)
+	{
+		if (!pattern.empty() && MatchesPattern(test_name, pattern))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void TestRunner::Run(const std::function<void()>& test_function, TestResult& result) const
+{
+	const auto test_start = std::chrono::steady_clock::now();
+	try
+	{
+		test_function();
+		result.ok = true;
+	}
+	catch (std::exception& ex)
+	{
+		result.error = ex.what();
+	}
+	catch (...)
+	{
+		result.error = "Unknown exception caught";
+	}
+	result.elapsed = std::chrono::steady_clock::now() - test_start;
+	if (result.ok && options.time_budget.count() > 0 && result.elapsed > options.time_budget)
+	{
+		result.ok = false;
+		result.error = "exceeded time budget of " + std::to_string(options.time_budget.count()) + " ms";
+	}
+}
+
+
+void TestRunner::Report(const TestResult& result)
+{
+	++run_count;
+	std::cerr << result.output << result.name;
+	if (result.ok)
+	{
+		std::cerr << " OK";
+	}
+	else
+	{
+		++fail_count;
+		std::cerr << " fail: " << result.error;
+	}
+	std::cerr << " (" << std::chrono::duration_cast<std::chrono::milliseconds>(result.elapsed).count() << " ms)" << std::endl;
+}
+
+
+void TestRunner::Work()
+{
+	std::unique_lock<std::mutex> lock(m);
+	while (true)
+	{
+		work_ready.wait(lock, [this] { return closed || next_to_run < tests.size(); });
+		if (next_to_run == tests.size())
+		{
+			return;
+		}
+		TestResult& result = tests[next_to_run++];
+		lock.unlock();
+
+		CapturingStreambuf::Target() = &result.output;
+		Run(result.func, result);
+		CapturingStreambuf::Target() = nullptr;
+
+		lock.lock();
+		result.done = true;
+		while (next_to_report < tests.size() && tests[next_to_report].done)
+		{
+			Report(tests[next_to_report++]);
+		}
+	}
+}
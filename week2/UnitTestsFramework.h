@@ -7,6 +7,14 @@
 #include <set>
 #include <string>
 #include <sstream>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 
 
 template <typename First, typename Second>
@@ -33,16 +41,92 @@ void AssertEqual(const T& t, const U& u, const std::string& hint);
 void Assert(bool cond, const std::string& hint);
 
 
+// Настройки TestRunner. По умолчанию берутся из переменных окружения:
+//   TEST_FILTER - через запятую шаблоны имён тестов с * и ?; шаблон без них
+//                 ищется как подстрока. Остальные тесты пропускаются
+//   TEST_THREADS - сколько тестов выполнять одновременно, 0 - по числу ядер
+//   TEST_TIME_BUDGET_MS - тест, который шёл дольше, считается упавшим
+struct TestRunnerOptions
+{
+	std::string filter;
+	size_t threads = 1;
+	std::chrono::milliseconds time_budget{ 0 };
+
+	static TestRunnerOptions FromEnvironment();
+};
+
+// Подходит ли имя под шаблон с * (любая строка) и ? (любой символ)
+bool MatchesPattern(const std::string& name, const std::string& pattern);
+
+// Пока тесты выполняются параллельно, std::cout и std::cerr пишут сюда: вывод
+// потока, в котором идёт тест, копится в его строку, а остальной, в том числе
+// из потоков, запущенных самим тестом, уходит в исходный поток
+class CapturingStreambuf : public std::streambuf
+{
+public:
+	explicit CapturingStreambuf(std::streambuf* original);
+
+	static std::string*& Target();
+	std::streambuf* Original() const;
+
+protected:
+	int overflow(int c) override;
+	std::streamsize xsputn(const char* s, std::streamsize n) override;
+	int sync() override;
+
+private:
+	std::streambuf* original;
+	std::mutex m;
+};
+
+
+// Выполняет тесты и печатает в std::cerr результат и время каждого. С
+// несколькими потоками RunTest только ставит тест в очередь, вывод теста
+// придерживается и печатается вместе с его результатом, а результаты
+// печатаются в порядке RunTest. Все тесты завершаются к выходу из деструктора
 class TestRunner
 {
 public:
 	TestRunner();
+	explicit TestRunner(TestRunnerOptions options);
 	~TestRunner();
 	template<class TestFunction>
 	void RunTest(TestFunction test_function, const std::string& test_function_name);
 
 private:
-	int fail_count;
+	struct TestResult
+	{
+		std::string name;
+		std::function<void()> func;
+		bool done = false;
+		bool ok = false;
+		std::string error;
+		std::string output;
+		std::chrono::steady_clock::duration elapsed{};
+	};
+
+	TestRunnerOptions options;
+	std::chrono::steady_clock::time_point start;
+	int fail_count = 0;
+	int run_count = 0;
+	int skip_count = 0;
+
+	std::unique_ptr<CapturingStreambuf> cout_capture;
+	std::unique_ptr<CapturingStreambuf> cerr_capture;
+	std::vector<std::thread> workers;
+	std::mutex m;
+	std::condition_variable work_ready;
+	// deque не перемещает элементы при push_back, поэтому рабочие потоки могут
+	// держать ссылку на свой тест без блокировки
+	std::deque<TestResult> tests;
+	size_t next_to_run = 0;
+	size_t next_to_report = 0;
+	bool closed = false;
+
+	bool Selected(const std::string& test_name) const;
+	void Run(const std::function<void()>& test_function, TestResult& result) const;
+	void Report(const TestResult& result);
+	void Work();
 };
 
 
@@ -110,17 +194,26 @@ void AssertEqual(const T& t, const U& u, const std::string& hint)
 template<class TestFunction>
 void TestRunner::RunTest(TestFunction test_function, const std::string& test_function_name)
 {
-
-	try
+	if (!Selected(test_function_name))
+	{
+		++skip_count;
+		return;
+	}
+	if (workers.empty())
 	{
-		test_function();
-		std::cerr << test_function_name << " OK" << std::endl;
+		TestResult result;
+		result.name = test_function_name;
+		Run(test_function, result);
+		Report(result);
+		return;
 	}
-	catch (std::runtime_error& ex)
 	{
-		++fail_count;
-		std::cerr << test_function_name << " fail: " << ex.what() << std::endl;
+		std::lock_guard<std::mutex> guard(m);
+		tests.emplace_back();
+		tests.back().name = test_function_name;
+		tests.back().func = test_function;
 	}
+	work_ready.notify_one();
 }
 
 
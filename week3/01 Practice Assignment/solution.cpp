@@ -1,132 +1,323 @@
+#include "profile.h"
+#include "test_runner.h"
+
+#include <sys/resource.h>
+
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <map>
+#include <random>
+#include <thread>
 #include <vector>
 #include <string>
 #include <optional>
 #include <numeric>
+#include <unordered_map>
 
 using namespace std;
 
-template <typename Iterator>
-class IteratorRange {
+// Хранит каждую различную строку один раз и выдаёт ей номер: людей миллионы,
+// а различных имён среди них - тысячи, так что человеку достаточно номера имени
+class StringPool {
 public:
-  IteratorRange(Iterator begin, Iterator end)
-    : first(begin)
-    , last(end)
-  {
+  uint32_t Intern(const string& s) {
+    const auto [it, inserted] = ids.emplace(s, static_cast<uint32_t>(strings.size()));
+    if (inserted) {
+      // Узлы unordered_map не переезжают при рехешировании
+      strings.push_back(&it->first);
+    }
+    return it->second;
   }
 
-  Iterator begin() const {
-    return first;
+  const string& operator[](uint32_t id) const {
+    return *strings[id];
   }
 
-  Iterator end() const {
-    return last;
+  size_t Size() const {
+    return strings.size();
   }
 
 private:
-  Iterator first, last;
+  unordered_map<string, uint32_t> ids;
+  vector<const string*> strings;
 };
 
-struct Person {
-  string name;
-  int age, income;
-  bool is_male;
+// Люди по столбцам: i-й человек - это i-е элементы всех векторов
+struct People {
+  StringPool names;
+  vector<uint32_t> name_ids;
+  vector<int64_t> ages;
+  vector<int64_t> incomes;
+  vector<bool> is_male;
 };
 
-vector<Person> ReadPeople(istream& input) {
-  int count;
+People ReadPeople(istream& input) {
+  size_t count;
   input >> count;
 
-  vector<Person> result(count);
-  for (Person& p : result) {
+  People result;
+  result.name_ids.reserve(count);
+  result.ages.reserve(count);
+  result.incomes.reserve(count);
+  result.is_male.reserve(count);
+  string name;
+  for (size_t i = 0; i < count; ++i) {
+    int64_t age, income;
     char gender;
-    input >> p.name >> p.age >> p.income >> gender;
-    p.is_male = gender == 'M';
+    input >> name >> age >> income >> gender;
+    result.name_ids.push_back(result.names.Intern(name));
+    result.ages.push_back(age);
+    result.incomes.push_back(income);
+    result.is_male.push_back(gender == 'M');
   }
 
   return result;
 }
 
-template <typename Iter>
-std::optional<string> FindMostPopularName(IteratorRange<Iter> range) {
-  if (range.begin() == range.end()) {
-    return std::nullopt;
-  } else {
-    sort(range.begin(), range.end(), [](const Person& lhs, const Person& rhs) {
-      return lhs.name < rhs.name;
-    });
-    const string* most_popular_name = &range.begin()->name;
-    int count = 1;
-    for (auto i = range.begin(); i != range.end(); ) {
-      auto same_name_end = find_if_not(i, range.end(), [i](const Person& p) {
-        return p.name == i->name;
-      });
-      const auto cur_name_count = std::distance(i, same_name_end);
-      if (
-        cur_name_count > count ||
-        (cur_name_count == count && i->name < *most_popular_name)
-      ) {
-        count = cur_name_count;
-        most_popular_name = &i->name;
-      }
-      i = same_name_end;
+// Сколько раз встречается каждое имя у мужчин и у женщин: номер имени в
+// пуле служит индексом, так что строки при подсчёте не сравниваются
+struct NameCounts {
+  vector<size_t> male, female;
+};
+
+NameCounts CountNames(const People& people, size_t begin, size_t end) {
+  NameCounts result{vector<size_t>(people.names.Size()), vector<size_t>(people.names.Size())};
+  for (size_t i = begin; i < end; ++i) {
+    ++(people.is_male[i] ? result.male : result.female)[people.name_ids[i]];
+  }
+  return result;
+}
+
+// Самое частое имя; из одинаково частых выбирается лексикографически меньшее
+std::optional<string> FindMostPopularName(const vector<size_t>& counts, const StringPool& names) {
+  std::optional<uint32_t> most_popular_name;
+  for (uint32_t id = 0; id < counts.size(); ++id) {
+    if (counts[id] == 0) {
+      continue;
+    }
+    if (
+      !most_popular_name ||
+      counts[id] > counts[*most_popular_name] ||
+      (counts[id] == counts[*most_popular_name] && names[id] < names[*most_popular_name])
+    ) {
+      most_popular_name = id;
     }
-    return *most_popular_name;
+  }
+  if (!most_popular_name) {
+    return std::nullopt;
+  }
+  return names[*most_popular_name];
+}
+
+// Сортировка подсчётом, если возрасты лежат в узком диапазоне, как у живых
+// людей, и обычная сортировка иначе
+void SortAges(vector<int64_t>& ages) {
+  if (ages.empty()) {
+    return;
+  }
+  const auto [min_it, max_it] = minmax_element(ages.begin(), ages.end());
+  const int64_t min_age = *min_it;
+  const uint64_t range = static_cast<uint64_t>(*max_it) - static_cast<uint64_t>(min_age);
+  if (range > ages.size()) {
+    sort(ages.begin(), ages.end());
+    return;
+  }
+  vector<size_t> counts(range + 1);
+  for (int64_t age : ages) {
+    ++counts[age - min_age];
+  }
+  auto out = ages.begin();
+  for (size_t i = 0; i < counts.size(); ++i) {
+    out = fill_n(out, counts[i], min_age + static_cast<int64_t>(i));
   }
 }
 
+// Каждый запрос читает только свой столбец
 struct StatsData {
   std::optional<string> most_popular_male_name;
   std::optional<string> most_popular_female_name;
-  vector<int> cumulative_wealth;
-  vector<Person> sorted_by_age;
+  // Суммы доходов богатейших людей, int64_t, чтобы не переполниться
+  vector<int64_t> cumulative_wealth;
+  vector<int64_t> sorted_ages;
 };
 
-StatsData BuildStatsData(vector<Person> people) {
+// Имена, доходы и возрасты - независимые столбцы, поэтому они обрабатываются
+// параллельно, а имена к тому же подсчитываются по кускам не более чем в
+// thread_count потоках; thread_count == 0 считается за 1
+StatsData BuildStatsData(People people, size_t thread_count = max(thread::hardware_concurrency(), 1u)) {
   StatsData result;
 
+  // Запросы WEALTHY можно тоже обрабатывать за О(1), один раз отсортировав
+  // доходы и посчитав массив префиксных сумм. Столбцы людей больше не нужны,
+  // поэтому сортируем и суммируем их на месте
+  auto wealth = async(launch::async, [&incomes = people.incomes] {
+    sort(incomes.begin(), incomes.end(), greater<>());
+    partial_sum(incomes.begin(), incomes.end(), incomes.begin());
+  });
+  auto ages = async(launch::async, [&ages = people.ages] {
+    SortAges(ages);
+  });
+
+  // По мере обработки запросов список людей не меняется, так что мы можем
+  // один раз найти самые популярные женское и мужское имена
   {
-    IteratorRange males{
-      begin(people),
-      partition(begin(people), end(people), [](const Person& p) {
-        return p.is_male;
-      })
-    };
-    IteratorRange females{males.end(), end(people)};
+    // Каждый кусок заводит счётчики на все различные имена, поэтому кусков не
+    // больше, чем людей на одно имя: иначе при почти уникальных именах
+    // счётчики заняли бы в thread_count раз больше памяти, чем сами люди
+    const size_t size = people.name_ids.size();
+    const size_t chunk_count = max<size_t>(1, min(thread_count, size / max<size_t>(people.names.Size(), 1)));
+    vector<future<NameCounts>> parts;
+    for (size_t i = 0; i < chunk_count; ++i) {
+      parts.push_back(async(launch::async, CountNames, cref(people),
+                            size * i / chunk_count, size * (i + 1) / chunk_count));
+    }
+    NameCounts counts = parts.front().get();
+    for (size_t i = 1; i < parts.size(); ++i) {
+      const NameCounts part = parts[i].get();
+      for (size_t id = 0; id < counts.male.size(); ++id) {
+        counts.male[id] += part.male[id];
+        counts.female[id] += part.female[id];
+      }
+    }
+    result.most_popular_male_name = FindMostPopularName(counts.male, people.names);
+    result.most_popular_female_name = FindMostPopularName(counts.female, people.names);
+  }
+
+  wealth.get();
+  result.cumulative_wealth = move(people.incomes);
+  ages.get();
+  result.sorted_ages = move(people.ages);
+
+  return result;
+}
 
-    // По мере обработки запросов список людей не меняется, так что мы можем
-    // один раз найти самые популярные женское и мужское имена
-    result.most_popular_male_name = FindMostPopularName(males);
-    result.most_popular_female_name = FindMostPopularName(females);
+// Случайные люди с тысячей различных имён, возрастом до 100 лет и доходом до
+// миллиона
+People GeneratePeople(size_t count) {
+  mt19937_64 generator(42);
+  People result;
+  vector<uint32_t> name_ids;
+  for (int i = 0; i < 1000; ++i) {
+    name_ids.push_back(result.names.Intern("Name" + to_string(i)));
+  }
+  result.name_ids.reserve(count);
+  result.ages.reserve(count);
+  result.incomes.reserve(count);
+  result.is_male.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const uint64_t random = generator();
+    result.name_ids.push_back(name_ids[random % name_ids.size()]);
+    result.ages.push_back(static_cast<int64_t>((random >> 10) % 100));
+    result.incomes.push_back(static_cast<int64_t>((random >> 17) % 1'000'000));
+    result.is_male.push_back((random >> 63) != 0);
   }
+  return result;
+}
 
-  // Запросы WEALTHY можно тоже обрабатывать за О(1), один раз отсортировав всех
-  // людей по достатку и посчитав массив префиксных сумм
+void BenchmarkBuildStatsData(size_t count) {
+  People people;
   {
-    sort(people.begin(), people.end(), [](const Person& lhs, const Person& rhs) {
-      return lhs.income > rhs.income;
-    });
-
-    auto& wealth = result.cumulative_wealth;
-    wealth.resize(people.size());
-    if (!people.empty()) {
-      wealth[0] = people[0].income;
-      for (size_t i = 1; i < people.size(); ++i) {
-        wealth[i] = wealth[i - 1] + people[i].income;
+    LOG_DURATION("Generate " + to_string(count) + " people");
+    people = GeneratePeople(count);
+  }
+  StatsData stats;
+  {
+    LOG_DURATION("BuildStatsData");
+    stats = BuildStatsData(move(people));
+  }
+  const size_t stats_bytes = (stats.cumulative_wealth.capacity() + stats.sorted_ages.capacity()) * sizeof(int64_t);
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  cerr << "StatsData: " << stats_bytes / (1 << 20) << " MB, peak RSS: "
+       << usage.ru_maxrss / 1024 << " MB" << endl;
+  cerr << "Top-" << count << " people have total income " << stats.cumulative_wealth.back() << endl;
+}
+
+// Сравнивает BuildStatsData с прямолинейным подсчётом по строкам имён
+void TestBuildStatsData() {
+  struct Person {
+    string name;
+    int64_t age, income;
+    bool is_male;
+  };
+  mt19937 generator(7);
+  for (size_t count : {0, 1, 2, 7, 1000, 100000, 3000}) {
+    // Мало различных имён, чтобы популярность часто совпадала, а в последнем
+    // случае имён больше, чем людей на одно имя
+    vector<string> names = {"Ivan", "Olga", "Iv", "Ivanna", "A", "Zoe", "olga"};
+    if (count == 3000) {
+      for (int i = 0; i < 2000; ++i) {
+        names.push_back("Name" + to_string(i));
       }
     }
-  }
+    vector<Person> persons(count);
+    for (Person& p : persons) {
+      p.name = names[generator() % names.size()];
+      p.age = generator() % 130;
+      p.income = generator() % 2'000'000'000;
+      p.is_male = generator() % (count == 7 ? 8 : 2) == 0;
+    }
 
-  sort(begin(people), end(people), [](const Person& lhs, const Person& rhs) {
-    return lhs.age < rhs.age;
-  });
-  result.sorted_by_age = std::move(people);
+    map<string, size_t> male_counts, female_counts;
+    vector<int64_t> expected_wealth, expected_ages;
+    for (const Person& p : persons) {
+      ++(p.is_male ? male_counts : female_counts)[p.name];
+      expected_wealth.push_back(p.income);
+      expected_ages.push_back(p.age);
+    }
+    const auto most_popular = [](const map<string, size_t>& counts) -> std::optional<string> {
+      if (counts.empty()) {
+        return std::nullopt;
+      }
+      // Строгое сравнение оставляет первое, то есть наименьшее, из равных имён
+      auto best = counts.begin();
+      for (auto it = counts.begin(); it != counts.end(); ++it) {
+        if (it->second > best->second) {
+          best = it;
+        }
+      }
+      return best->first;
+    };
+    sort(expected_wealth.begin(), expected_wealth.end(), greater<>());
+    partial_sum(expected_wealth.begin(), expected_wealth.end(), expected_wealth.begin());
+    sort(expected_ages.begin(), expected_ages.end());
 
-  return result;
+    for (size_t thread_count : {0, 1, 3, 8}) {
+      People people;
+      for (const Person& p : persons) {
+        people.name_ids.push_back(people.names.Intern(p.name));
+        people.ages.push_back(p.age);
+        people.incomes.push_back(p.income);
+        people.is_male.push_back(p.is_male);
+      }
+      const StatsData stats = BuildStatsData(move(people), thread_count);
+      const string hint = to_string(count) + " people, " + to_string(thread_count) + " threads";
+      // Пустая строка не встречается среди имён и обозначает отсутствие имени
+      AssertEqual(stats.most_popular_male_name.value_or(""), most_popular(male_counts).value_or(""), hint);
+      AssertEqual(stats.most_popular_female_name.value_or(""), most_popular(female_counts).value_or(""), hint);
+      AssertEqual(stats.cumulative_wealth, expected_wealth, hint);
+      AssertEqual(stats.sorted_ages, expected_ages, hint);
+    }
+  }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+  // Без аргументов программа только решает задачу по входу из cin
+  if (argc > 1 && string(argv[1]) == "--test") {
+    TestRunner tr;
+    RUN_TEST(tr, TestBuildStatsData);
+    return 0;
+  }
+
+  // ./solution --benchmark [N] замеряет BuildStatsData на N случайных людях
+  if (argc > 1 && string(argv[1]) == "--benchmark") {
+    BenchmarkBuildStatsData(argc > 2 ? stoull(argv[2]) : 100'000'000);
+    return 0;
+  }
+
   // Основной проблемой исходного решения было то, что в нём случайно изменялись
   // входные данные. Чтобы ганатировать, что этого не произойдёт, мы организовываем код
   // так, чтобы в месте обработки запросов были видны только константные данные.
@@ -141,15 +332,12 @@ int main() {
       cin >> adult_age;
 
       auto adult_begin = lower_bound(
-        begin(stats.sorted_by_age),
-        end(stats.sorted_by_age),
-        adult_age,
-        [](const Person& lhs, int age) {
-          return lhs.age < age;
-        }
+        begin(stats.sorted_ages),
+        end(stats.sorted_ages),
+        adult_age
       );
 
-      cout << "There are " << std::distance(adult_begin, end(stats.sorted_by_age))
+      cout << "There are " << std::distance(adult_begin, end(stats.sorted_ages))
            << " adult people for maturity age " << adult_age << '\n';
     } else if (command == "WEALTHY") {
       int count;
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Не даёт компилятору выбросить вычисление value как неиспользуемое
+template <class T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
+
+// Не даёт компилятору отложить или выбросить записи в память до этой точки
+inline void ClobberMemory() {
+#if defined(__GNUC__)
+	asm volatile("" : : : "memory");
+#endif
+}
+
+struct BenchmarkOptions {
+	// Сколько гонять функцию перед замерами, чтобы прогреть кэши и предсказатель
+	nanoseconds warmup_time = milliseconds(100);
+	// Число итераций в одном замере подбирается так, чтобы замер длился не
+	// меньше sample_time: тогда точность часов не влияет на результат
+	nanoseconds sample_time = milliseconds(1);
+	// Замеры продолжаются, пока не наберётся min_samples и не пройдёт min_time,
+	// но не больше max_samples
+	nanoseconds min_time = milliseconds(500);
+	size_t min_samples = 10;
+	size_t max_samples = 1000;
+};
+
+// Время одной итерации в наносекундах по всем замерам
+struct BenchmarkResult {
+	string name;
+	size_t iterations = 0;
+	size_t samples = 0;
+	double min_ns = 0;
+	double median_ns = 0;
+	double p99_ns = 0;
+	double mean_ns = 0;
+};
+
+// Запускает функции без аргументов много раз и печатает в cerr время одной
+// итерации. Если задана переменная окружения BENCHMARK_OUTPUT, в конце
+// результаты замеров записываются в этот файл: в CSV, если имя заканчивается
+// на .csv, иначе в JSON. Результаты копятся в общем для процесса списке, и
+// каждый разрушаемый BenchmarkRunner переписывает файл этим списком целиком,
+// так что в файле оказываются замеры всех BenchmarkRunner процесса
+class BenchmarkRunner {
+public:
+	explicit BenchmarkRunner(BenchmarkOptions options = {})
+	: options(options)
+	{
+	}
+
+	template <class BenchFunc>
+	void RunBenchmark(BenchFunc func, const string& name) {
+		try {
+			const size_t batch = Warmup(func);
+			vector<double> samples;
+			nanoseconds total(0);
+			while (samples.size() < options.min_samples
+				|| (total < options.min_time && samples.size() < options.max_samples)) {
+				const nanoseconds elapsed = RunBatch(func, batch);
+				total += elapsed;
+				samples.push_back(static_cast<double>(elapsed.count()) / batch);
+			}
+			const size_t iterations = batch * samples.size();
+			results.push_back(Summarize(name, iterations, move(samples)));
+			PrintResult(results.back());
+		} catch (exception& e) {
+			++fail_count;
+			cerr << name << " fail: " << e.what() << endl;
+		} catch (...) {
+			++fail_count;
+			cerr << "Unknown exception caught" << endl;
+		}
+	}
+
+	const vector<BenchmarkResult>& Results() const {
+		return results;
+	}
+
+	void WriteJson(ostream& output) const {
+		WriteJson(results, output);
+	}
+
+	void WriteCsv(ostream& output) const {
+		WriteCsv(results, output);
+	}
+
+	static void WriteJson(const vector<BenchmarkResult>& results, ostream& output) {
+		ostringstream out;
+		out << setprecision(10);
+		out << "{\"benchmarks\": [";
+		for (size_t i = 0; i < results.size(); ++i) {
+			const BenchmarkResult& r = results[i];
+			out << (i > 0 ? "," : "") << "\n  {\"name\": \"" << Escape(r.name, '\\')
+				<< "\", \"iterations\": " << r.iterations
+				<< ", \"samples\": " << r.samples
+				<< ", \"min_ns\": " << r.min_ns
+				<< ", \"median_ns\": " << r.median_ns
+				<< ", \"p99_ns\": " << r.p99_ns
+				<< ", \"mean_ns\": " << r.mean_ns << "}";
+		}
+		out << "\n]}\n";
+		output << out.str();
+	}
+
+	static void WriteCsv(const vector<BenchmarkResult>& results, ostream& output) {
+		ostringstream out;
+		out << setprecision(10);
+		out << "name,iterations,samples,min_ns,median_ns,p99_ns,mean_ns\n";
+		for (const BenchmarkResult& r : results) {
+			out << '"' << Escape(r.name, '"') << "\"," << r.iterations << ',' << r.samples << ','
+				<< r.min_ns << ',' << r.median_ns << ',' << r.p99_ns << ',' << r.mean_ns << '\n';
+		}
+		output << out.str();
+	}
+
+	~BenchmarkRunner() {
+		vector<BenchmarkResult>& all_results = ProcessResults();
+		all_results.insert(all_results.end(), results.begin(), results.end());
+		if (const char* path = getenv("BENCHMARK_OUTPUT"); path != nullptr && *path != '\0') {
+			const string file_name = path;
+			ofstream out(file_name);
+			const string csv = ".csv";
+			if (file_name.size() >= csv.size()
+				&& file_name.compare(file_name.size() - csv.size(), csv.size(), csv) == 0) {
+				WriteCsv(all_results, out);
+			} else {
+				WriteJson(all_results, out);
+			}
+		}
+		if (fail_count > 0) {
+			cerr << fail_count << " benchmarks failed. Terminate" << endl;
+			exit(1);
+		}
+	}
+
+	// Результаты всех уже разрушенных BenchmarkRunner процесса
+	static vector<BenchmarkResult>& ProcessResults() {
+		static vector<BenchmarkResult> all_results;
+		return all_results;
+	}
+
+private:
+	BenchmarkOptions options;
+	vector<BenchmarkResult> results;
+	int fail_count = 0;
+
+	template <class BenchFunc>
+	static nanoseconds RunBatch(BenchFunc& func, size_t batch) {
+		const auto start = steady_clock::now();
+		for (size_t i = 0; i < batch; ++i) {
+			func();
+		}
+		ClobberMemory();
+		return duration_cast<nanoseconds>(steady_clock::now() - start);
+	}
+
+	// Прогревает функцию и возвращает число итераций в одном замере
+	template <class BenchFunc>
+	size_t Warmup(BenchFunc& func) const {
+		size_t batch = 1;
+		nanoseconds elapsed = RunBatch(func, batch);
+		nanoseconds total = elapsed;
+		// Пустое тело, которое компилятор выбросил, не доберётся до sample_time
+		const size_t max_batch = size_t(1) << 30;
+		while ((elapsed < options.sample_time && batch < max_batch) || total < options.warmup_time) {
+			if (elapsed < options.sample_time && batch < max_batch) {
+				// Растём не больше чем в 10 раз: первые замеры бывают случайно быстрыми
+				const double scale = elapsed.count() > 0
+					? static_cast<double>(options.sample_time.count()) / elapsed.count()
+					: 10.0;
+				batch = min(max_batch, max(batch + 1, static_cast<size_t>(batch * min(scale * 1.2, 10.0))));
+			}
+			elapsed = RunBatch(func, batch);
+			total += elapsed;
+		}
+		return batch;
+	}
+
+	static BenchmarkResult Summarize(const string& name, size_t iterations, vector<double> samples) {
+		sort(samples.begin(), samples.end());
+		BenchmarkResult result;
+		result.name = name;
+		result.iterations = iterations;
+		result.samples = samples.size();
+		result.min_ns = samples.front();
+		const size_t middle = samples.size() / 2;
+		result.median_ns = samples.size() % 2 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+		const size_t p99_rank = static_cast<size_t>(ceil(0.99 * samples.size()));
+		result.p99_ns = samples[max<size_t>(p99_rank, 1) - 1];
+		double sum = 0;
+		for (double sample : samples) {
+			sum += sample;
+		}
+		result.mean_ns = sum / samples.size();
+		return result;
+	}
+
+	static string FormatDuration(double ns) {
+		ostringstream os;
+		os << fixed << setprecision(ns < 10 ? 2 : 1);
+		if (ns < 1e3) {
+			os << ns << " ns";
+		} else if (ns < 1e6) {
+			os << ns / 1e3 << " us";
+		} else if (ns < 1e9) {
+			os << ns / 1e6 << " ms";
+		} else {
+			os << ns / 1e9 << " s";
+		}
+		return os.str();
+	}
+
+	static void PrintResult(const BenchmarkResult& r) {
+		cerr << r.name << ": median " << FormatDuration(r.median_ns)
+			<< ", min " << FormatDuration(r.min_ns)
+			<< ", p99 " << FormatDuration(r.p99_ns)
+			<< " (" << r.iterations << " iterations, " << r.samples << " samples)" << endl;
+	}
+
+	// Удваивает кавычки для CSV или экранирует их обратной чертой для JSON
+	static string Escape(const string& s, char escape) {
+		string result;
+		for (char c : s) {
+			if (c == '"' || (escape == '\\' && c == '\\')) {
+				result += escape;
+			}
+			result += c;
+		}
+		return result;
+	}
+};
+
+#define RUN_BENCHMARK(br, func) \
+br.RunBenchmark(func, #func)
@@ -1,6 +1,8 @@
 #include "test_runner.h"
 #include "profile.h"
+#include "benchmark.h"
 
+#include <fstream>
 #include <future>
 #include <mutex>
 #include <unordered_map>
@@ -80,11 +82,16 @@ void RunConcurrentUpdates(
         ConcurrentMap<int, int> &cm, size_t thread_count, int key_count
 ) {
     auto kernel = [&cm, key_count](int seed) {
+        PROFILE_ZONE("RunConcurrentUpdates");
         vector<int> updates(key_count);
-        iota(begin(updates), end(updates), -key_count / 2);
-        shuffle(begin(updates), end(updates), default_random_engine(seed));
+        {
+            PROFILE_ZONE("Shuffle keys");
+            iota(begin(updates), end(updates), -key_count / 2);
+            shuffle(begin(updates), end(updates), default_random_engine(seed));
+        }
 
         for (int i = 0; i < 2; ++i) {
+            PROFILE_ZONE("Update pass");
             for (auto key : updates) {
                 cm[key].ref_to_value++;
             }
@@ -258,13 +265,102 @@ void TestHas() {
     ASSERT(!const_map.Has(3));
 }
 
-int main() {
-    TestRunner tr;
-    RUN_TEST(tr, TestConcurrentUpdate);
-    RUN_TEST(tr, TestReadAndWrite);
-    RUN_TEST(tr, TestSpeedup);
-    RUN_TEST(tr, TestConstAccess);
-    RUN_TEST(tr, TestStringKeys);
-    RUN_TEST(tr, TestUserType);
-    RUN_TEST(tr, TestHas);
+// Стоимость одного обращения без конкуренции потоков: захват мьютекса
+// корзины и поиск в её unordered_map
+void BenchmarkAccess() {
+    const int key_count = 50000;
+    ConcurrentMap<int, int> single_lock(1);
+    ConcurrentMap<int, int> many_locks(100);
+    for (int key = 0; key < key_count; ++key) {
+        single_lock[key].ref_to_value = key;
+        many_locks[key].ref_to_value = key;
+    }
+
+    BenchmarkRunner br;
+    int key = 0;
+    auto single_lock_update = [&single_lock, &key] {
+        single_lock[key].ref_to_value++;
+        key = (key + 7919) % key_count;
+    };
+    auto many_locks_update = [&many_locks, &key] {
+        many_locks[key].ref_to_value++;
+        key = (key + 7919) % key_count;
+    };
+    auto const_at = [&map = std::as_const(many_locks), &key] {
+        DoNotOptimize(map.At(key).ref_to_value);
+        key = (key + 7919) % key_count;
+    };
+    auto const_has = [&map = std::as_const(many_locks), &key] {
+        DoNotOptimize(map.Has(key + key_count / 2));
+        key = (key + 7919) % key_count;
+    };
+    RUN_BENCHMARK(br, single_lock_update);
+    RUN_BENCHMARK(br, many_locks_update);
+    RUN_BENCHMARK(br, const_at);
+    RUN_BENCHMARK(br, const_has);
+}
+
+// Цена PROFILE_ZONE в горячем цикле
+void BenchmarkProfileZone() {
+    BenchmarkRunner br;
+    auto enabled_zone = [] {
+        PROFILE_ZONE("Empty zone");
+    };
+    auto disabled_zone = [] {
+        PROFILE_ZONE("Empty zone");
+    };
+    auto log_duration = [] {
+        ostringstream silent;
+        auto* old_buffer = cerr.rdbuf(silent.rdbuf());
+        {
+            LOG_DURATION("Empty scope");
+        }
+        cerr.rdbuf(old_buffer);
+    };
+    RUN_BENCHMARK(br, enabled_zone);
+    Profiler::SetEnabled(false);
+    RUN_BENCHMARK(br, disabled_zone);
+    Profiler::SetEnabled(true);
+    RUN_BENCHMARK(br, log_duration);
+    Profiler::Reset();
+}
+
+int main(int argc, char* argv[]) {
+    {
+        TestRunner tr;
+        RUN_TEST(tr, TestConcurrentUpdate);
+        RUN_TEST(tr, TestReadAndWrite);
+        RUN_TEST(tr, TestSpeedup);
+        RUN_TEST(tr, TestConstAccess);
+        RUN_TEST(tr, TestStringKeys);
+        RUN_TEST(tr, TestUserType);
+        RUN_TEST(tr, TestHas);
+    }
+    const bool benchmark = argc > 1 && string(argv[1]) == "--benchmark";
+    const char* profile_output = getenv("PROFILE_OUTPUT");
+    const bool write_profile = profile_output != nullptr && *profile_output != '\0';
+    // Зоны тестов: дерево в cerr по --benchmark или с PROFILE_OUTPUT, а с ним
+    // ещё и в файл - в формате Chrome trace, если имя заканчивается на .json,
+    // иначе свёрнутыми стеками
+    if (benchmark || write_profile) {
+        Profiler::WriteCallTree(cerr);
+    }
+    if (write_profile) {
+        ofstream out(profile_output);
+        const string file_name = profile_output;
+        if (file_name.size() >= 5 && file_name.substr(file_name.size() - 5) == ".json") {
+            Profiler::WriteChromeTrace(out);
+        } else {
+            Profiler::WriteFoldedStacks(out);
+        }
+    }
+    Profiler::Reset();
+
+    // Замеры идут несколько секунд, поэтому только по --benchmark или когда
+    // их результаты просят записать в BENCHMARK_OUTPUT
+    const char* benchmark_output = getenv("BENCHMARK_OUTPUT");
+    if (benchmark || (benchmark_output != nullptr && *benchmark_output != '\0')) {
+        BenchmarkAccess();
+        BenchmarkProfileZone();
+    }
 }
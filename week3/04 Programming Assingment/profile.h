@@ -1,26 +1,41 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 using namespace std;
 using namespace std::chrono;
 
+// Сообщение не склеивается с ": " и строка не сбрасывается через endl: cerr
+// и так небуферизован, а лишний сброс и выделение памяти искажают замер
 class LogDuration {
 public:
 	explicit LogDuration(const string& msg = "")
-	: message(msg + ": ")
+	: message(msg)
 	, start(steady_clock::now())
 	{
 	}
-	
+
 	~LogDuration() {
 		auto finish = steady_clock::now();
 		auto dur = finish - start;
-		cerr << message
+		cerr << message << ": "
 		<< duration_cast<milliseconds>(dur).count()
-		<< " ms" << endl;
+		<< " ms\n";
 	}
 private:
 	string message;
@@ -32,3 +47,293 @@ private:
 
 #define LOG_DURATION(message) \
 LogDuration UNIQ_ID(__LINE__){message};
+
+// Место в коде, отмеченное PROFILE_ZONE. Для каждого места компилятор создаёт
+// одну статическую константу, и зона в замерах - это указатель на неё, так что
+// имена не копируются и не сравниваются во время работы
+struct ProfileZoneInfo {
+	const char* name;
+	const char* file;
+	int line;
+};
+
+// Иерархический профилировщик. Каждая зона при выходе из области видимости
+// записывает в кольцевой буфер своего потока начало, конец и глубину
+// вложенности, а Write* восстанавливают по этим записям дерево вызовов.
+// Буфер хранит последние buffer_size зон потока, более старые затираются.
+// Write* можно вызывать, когда профилируемые потоки не находятся внутри зон,
+// например после их завершения
+class Profiler {
+public:
+	static constexpr size_t buffer_size = 1 << 16;
+
+	static void SetEnabled(bool value) {
+		enabled.store(value, memory_order_relaxed);
+	}
+
+	static bool IsEnabled() {
+		return enabled.load(memory_order_relaxed);
+	}
+
+	// Такты rdtsc, где он есть, иначе наносекунды steady_clock
+	static uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	static void Record(const ProfileZoneInfo* zone, uint64_t begin, uint64_t end, uint32_t depth) {
+		ThreadBuffer& buffer = LocalBuffer();
+		buffer.events[buffer.recorded % buffer_size] = {zone, begin, end, depth};
+		++buffer.recorded;
+	}
+
+	static uint32_t& Depth() {
+		static thread_local uint32_t depth = 0;
+		return depth;
+	}
+
+	// Дерево вызовов: число входов, общее время и время без вложенных зон
+	static void WriteCallTree(ostream& output) {
+		ostringstream out;
+		out << fixed << setprecision(3);
+		const map<vector<string>, Stats> tree = Aggregate();
+		for (const auto& [stack, stats] : tree) {
+			out << string(2 * (stack.size() - 1), ' ') << stack.back()
+				<< ": " << stats.count << " calls, total " << stats.total_ns / 1e6
+				<< " ms, self " << stats.self_ns / 1e6 << " ms\n";
+		}
+		output << out.str();
+	}
+
+	// Строки "корень;...;зона время_без_вложенных_зон_в_нс" для flamegraph.pl
+	static void WriteFoldedStacks(ostream& output) {
+		ostringstream out;
+		for (const auto& [stack, stats] : Aggregate()) {
+			for (size_t i = 0; i < stack.size(); ++i) {
+				out << (i > 0 ? ";" : "") << stack[i];
+			}
+			out << ' ' << static_cast<uint64_t>(stats.self_ns) << '\n';
+		}
+		output << out.str();
+	}
+
+	// Формат Trace Event для chrome://tracing и Perfetto: каждая зона - событие "X"
+	static void WriteChromeTrace(ostream& output) {
+		vector<vector<Event>> threads;
+		double ns_per_tick = 1.0;
+		ForEachThread([&](size_t, const vector<Event>& events, double thread_ns_per_tick) {
+			threads.push_back(events);
+			ns_per_tick = thread_ns_per_tick;
+		});
+		uint64_t origin = UINT64_MAX;
+		for (const auto& events : threads) {
+			if (!events.empty()) {
+				origin = min(origin, events.front().begin);
+			}
+		}
+
+		ostringstream out;
+		out << fixed << setprecision(3) << "{\"traceEvents\": [";
+		bool first = true;
+		for (size_t thread_index = 0; thread_index < threads.size(); ++thread_index) {
+			for (const Event& event : threads[thread_index]) {
+				out << (first ? "" : ",") << "\n  {\"name\": \"" << EscapeJson(event.zone->name)
+					<< "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread_index
+					<< ", \"ts\": " << (event.begin - origin) * ns_per_tick / 1e3
+					<< ", \"dur\": " << (event.end - event.begin) * ns_per_tick / 1e3 << "}";
+				first = false;
+			}
+		}
+		out << "\n]}\n";
+		output << out.str();
+	}
+
+	// Забывает все записанные зоны и освобождает буферы завершившихся потоков
+	static void Reset() {
+		lock_guard guard(Registry().m);
+		auto& buffers = Registry().buffers;
+		buffers.erase(remove_if(buffers.begin(), buffers.end(), [](const auto& buffer) {
+			return buffer->exited;
+		}), buffers.end());
+		for (const auto& buffer : buffers) {
+			buffer->recorded = 0;
+		}
+	}
+
+private:
+	struct Event {
+		const ProfileZoneInfo* zone;
+		uint64_t begin, end;
+		uint32_t depth;
+	};
+
+	struct ThreadBuffer {
+		vector<Event> events = vector<Event>(buffer_size);
+		size_t recorded = 0;
+		// Поток завершился, и после выгрузки буфер можно освободить (под m)
+		bool exited = false;
+	};
+
+	struct BufferRegistry {
+		mutex m;
+		// Буферы живут дольше своих потоков, чтобы их можно было выгрузить потом,
+		// и освобождаются в Reset
+		vector<shared_ptr<ThreadBuffer>> buffers;
+	};
+
+	// Регистрирует буфер потока и отмечает его при завершении потока
+	struct BufferOwner {
+		shared_ptr<ThreadBuffer> buffer = make_shared<ThreadBuffer>();
+
+		BufferOwner() {
+			lock_guard guard(Registry().m);
+			Registry().buffers.push_back(buffer);
+		}
+
+		~BufferOwner() {
+			lock_guard guard(Registry().m);
+			buffer->exited = true;
+		}
+	};
+
+	struct Stats {
+		size_t count = 0;
+		double total_ns = 0;
+		double self_ns = 0;
+	};
+
+	// Соответствие тактов и времени при запуске программы
+	struct ClockOrigin {
+		uint64_t ticks;
+		steady_clock::time_point time;
+	};
+
+	inline static atomic<bool> enabled = true;
+	inline static const ClockOrigin origin{Now(), steady_clock::now()};
+
+	static BufferRegistry& Registry() {
+		static BufferRegistry registry;
+		return registry;
+	}
+
+	static ThreadBuffer& LocalBuffer() {
+		// Простой указатель, чтобы горячий путь не проверял владельца
+		static thread_local ThreadBuffer* buffer = [] {
+			static thread_local BufferOwner owner;
+			return owner.buffer.get();
+		}();
+		return *buffer;
+	}
+
+	static double NanosecondsPerTick() {
+#if defined(__x86_64__) || defined(__i386__)
+		const uint64_t ticks = Now() - origin.ticks;
+		const double ns = duration<double, nano>(steady_clock::now() - origin.time).count();
+		return ticks > 0 ? ns / ticks : 1.0;
+#else
+		return 1.0;
+#endif
+	}
+
+	// Вызывает callback для каждого потока с его событиями, упорядоченными по
+	// началу, а вложенные зоны - после объемлющих
+	template <typename Callback>
+	static void ForEachThread(Callback callback) {
+		const double ns_per_tick = NanosecondsPerTick();
+		lock_guard guard(Registry().m);
+		for (size_t i = 0; i < Registry().buffers.size(); ++i) {
+			const ThreadBuffer& buffer = *Registry().buffers[i];
+			const size_t count = min(buffer.recorded, buffer_size);
+			vector<Event> events(buffer.events.begin(), buffer.events.begin() + count);
+			sort(events.begin(), events.end(), [](const Event& lhs, const Event& rhs) {
+				return lhs.begin != rhs.begin ? lhs.begin < rhs.begin : lhs.depth < rhs.depth;
+			});
+			callback(i, events, ns_per_tick);
+		}
+	}
+
+	// Зоны, вызванные из одной и той же цепочки зон, складываются вместе
+	static map<vector<string>, Stats> Aggregate() {
+		map<vector<string>, Stats> tree;
+		ForEachThread([&tree](size_t, const vector<Event>& events, double ns_per_tick) {
+			vector<string> stack;
+			vector<Stats*> open;
+			for (const Event& event : events) {
+				stack.resize(min<size_t>(stack.size(), event.depth));
+				open.resize(stack.size());
+				// Объемлющие зоны затёрты в буфере или ещё не закончились
+				while (stack.size() < event.depth) {
+					stack.push_back("[unknown]");
+					open.push_back(nullptr);
+				}
+				stack.push_back(event.zone->name);
+				const double ns = (event.end - event.begin) * ns_per_tick;
+				Stats& stats = tree[stack];
+				++stats.count;
+				stats.total_ns += ns;
+				stats.self_ns += ns;
+				if (!open.empty() && open.back() != nullptr) {
+					open.back()->self_ns -= ns;
+				}
+				open.push_back(&stats);
+			}
+		});
+		return tree;
+	}
+
+	static string EscapeJson(const string& s) {
+		string result;
+		for (char c : s) {
+			if (c == '"' || c == '\\') {
+				result += '\\';
+			}
+			result += c;
+		}
+		return result;
+	}
+};
+
+// Замер области видимости для Profiler. Если профилировщик выключен, стоит
+// одну проверку флага
+class ProfileZone {
+public:
+	explicit ProfileZone(const ProfileZoneInfo* zone)
+	: zone(Profiler::IsEnabled() ? zone : nullptr)
+	{
+		if (this->zone != nullptr) {
+			depth = Profiler::Depth()++;
+			begin = Profiler::Now();
+		}
+	}
+
+	~ProfileZone() {
+		if (zone != nullptr) {
+			const uint64_t end = Profiler::Now();
+			--Profiler::Depth();
+			Profiler::Record(zone, begin, end, depth);
+		}
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const ProfileZoneInfo* zone;
+	uint64_t begin = 0;
+	uint32_t depth = 0;
+};
+
+#define UNIQ_ZONE_ID_IMPL(lineno) _a_profile_zone_##lineno
+#define UNIQ_ZONE_ID(lineno) UNIQ_ZONE_ID_IMPL(lineno)
+
+// name - строковый литерал. С -DDISABLE_PROFILE зоны не компилируются вовсе
+#ifdef DISABLE_PROFILE
+#define PROFILE_ZONE(name)
+#else
+#define PROFILE_ZONE(name) \
+static constexpr ProfileZoneInfo UNIQ_ZONE_ID(__LINE__){name, __FILE__, __LINE__}; \
+ProfileZone UNIQ_ID(__LINE__){&UNIQ_ZONE_ID(__LINE__)};
+#endif
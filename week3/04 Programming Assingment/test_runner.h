@@ -3,12 +3,23 @@
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
+using namespace std::chrono;
 
 template <class T>
 ostream& operator << (ostream& os, const vector<T>& s) {
@@ -52,6 +63,20 @@ ostream& operator << (ostream& os, const map<K, V>& m) {
 	return os << "}";
 }
 
+template <class K, class V>
+ostream& operator << (ostream& os, const unordered_map<K, V>& m) {
+	os << "{";
+	bool first = true;
+	for (const auto& kv : m) {
+		if (!first) {
+			os << ", ";
+		}
+		first = false;
+		os << kv.first << ": " << kv.second;
+	}
+	return os << "}";
+}
+
 template<class T, class U>
 void AssertEqual(const T& t, const U& u, const string& hint = {}) {
 	if (!(t == u)) {
@@ -68,31 +93,272 @@ inline void Assert(bool b, const string& hint) {
 	AssertEqual(b, true, hint);
 }
 
+// Настройки TestRunner. По умолчанию берутся из переменных окружения:
+//   TEST_FILTER - через запятую шаблоны имён тестов с * и ?; шаблон без них
+//                 ищется как подстрока. Остальные тесты пропускаются
+//   TEST_THREADS - сколько тестов выполнять одновременно, 0 - по числу ядер
+//   TEST_TIME_BUDGET_MS - тест, который шёл дольше, считается упавшим
+struct TestRunnerOptions {
+	string filter;
+	size_t threads = 1;
+	milliseconds time_budget{0};
+
+	static TestRunnerOptions FromEnvironment() {
+		TestRunnerOptions options;
+		if (const char* filter = getenv("TEST_FILTER")) {
+			options.filter = filter;
+		}
+		if (const char* threads = getenv("TEST_THREADS")) {
+			options.threads = stoul(threads);
+			if (options.threads == 0) {
+				options.threads = max(thread::hardware_concurrency(), 1u);
+			}
+		}
+		if (const char* budget = getenv("TEST_TIME_BUDGET_MS")) {
+			options.time_budget = milliseconds(stoll(budget));
+		}
+		return options;
+	}
+};
+
+// Подходит ли имя под шаблон с * (любая строка) и ? (любой символ)
+inline bool MatchesPattern(const string& name, const string& pattern) {
+	if (pattern.find_first_of("*?") == string::npos) {
+		return name.find(pattern) != string::npos;
+	}
+	// Жадный разбор с откатом к последней звёздочке
+	size_t n = 0, p = 0, star = string::npos, star_n = 0;
+	while (n < name.size()) {
+		if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+			++n;
+			++p;
+		} else if (p < pattern.size() && pattern[p] == '*') {
+			star = p++;
+			star_n = n;
+		} else if (star != string::npos) {
+			p = star + 1;
+			n = ++star_n;
+		} else {
+			return false;
+		}
+	}
+	while (p < pattern.size() && pattern[p] == '*') {
+		++p;
+	}
+	return p == pattern.size();
+}
+
+// Пока тесты выполняются параллельно, cout и cerr пишут сюда: вывод потока,
+// в котором идёт тест, копится в его строку, а остальной, в том числе из
+// потоков, запущенных самим тестом, уходит в исходный поток
+class CapturingStreambuf : public streambuf {
+public:
+	explicit CapturingStreambuf(streambuf* original)
+	: original(original)
+	{
+	}
+
+	static string*& Target() {
+		static thread_local string* target = nullptr;
+		return target;
+	}
+
+	streambuf* Original() const {
+		return original;
+	}
+
+protected:
+	int overflow(int c) override {
+		if (c == traits_type::eof()) {
+			return traits_type::not_eof(c);
+		}
+		const char ch = traits_type::to_char_type(c);
+		return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+	}
+
+	streamsize xsputn(const char* s, streamsize n) override {
+		if (string* target = Target()) {
+			target->append(s, n);
+			return n;
+		}
+		lock_guard guard(m);
+		return original->sputn(s, n);
+	}
+
+	int sync() override {
+		return Target() != nullptr ? 0 : original->pubsync();
+	}
+
+private:
+	streambuf* original;
+	mutex m;
+};
+
+// Выполняет тесты и печатает в cerr результат и время каждого. С несколькими
+// потоками (TestRunnerOptions::threads) RunTest только ставит тест в очередь,
+// вывод теста придерживается и печатается вместе с его результатом, а
+// результаты печатаются в порядке RunTest. Все тесты завершаются к выходу из
+// деструктора, и, если какой-то упал, программа завершается с кодом 1
 class TestRunner {
 public:
+	TestRunner()
+	: TestRunner(TestRunnerOptions::FromEnvironment())
+	{
+	}
+
+	explicit TestRunner(TestRunnerOptions options)
+	: options(move(options))
+	, start(steady_clock::now())
+	{
+		if (this->options.threads > 1) {
+			cout_capture = make_unique<CapturingStreambuf>(cout.rdbuf());
+			cerr_capture = make_unique<CapturingStreambuf>(cerr.rdbuf());
+			cout.rdbuf(cout_capture.get());
+			cerr.rdbuf(cerr_capture.get());
+			for (size_t i = 0; i < this->options.threads; ++i) {
+				workers.emplace_back([this] { Work(); });
+			}
+		}
+	}
+
 	template <class TestFunc>
 	void RunTest(TestFunc func, const string& test_name) {
-		try {
-			func();
-			cerr << test_name << " OK" << endl;
-		} catch (exception& e) {
-			++fail_count;
-			cerr << test_name << " fail: " << e.what() << endl;
-		} catch (...) {
-			++fail_count;
-			cerr << "Unknown exception caught" << endl;
+		if (!Selected(test_name)) {
+			++skip_count;
+			return;
+		}
+		if (workers.empty()) {
+			TestResult result;
+			result.name = test_name;
+			Run(func, result);
+			Report(result);
+			return;
+		}
+		{
+			lock_guard guard(m);
+			tests.emplace_back();
+			tests.back().name = test_name;
+			tests.back().func = func;
 		}
+		work_ready.notify_one();
 	}
-	
+
 	~TestRunner() {
+		if (!workers.empty()) {
+			{
+				lock_guard guard(m);
+				closed = true;
+			}
+			work_ready.notify_all();
+			for (thread& worker : workers) {
+				worker.join();
+			}
+			cout.rdbuf(cout_capture->Original());
+			cerr.rdbuf(cerr_capture->Original());
+		}
+		if (skip_count > 0 || !workers.empty()) {
+			cerr << run_count << " tests run, " << skip_count << " skipped in "
+			<< duration_cast<milliseconds>(steady_clock::now() - start).count() << " ms" << endl;
+		}
 		if (fail_count > 0) {
 			cerr << fail_count << " unit tests failed. Terminate" << endl;
 			exit(1);
 		}
 	}
-	
+
 private:
+	struct TestResult {
+		string name;
+		function<void()> func;
+		bool done = false;
+		bool ok = false;
+		string error;
+		string output;
+		steady_clock::duration elapsed{};
+	};
+
+	TestRunnerOptions options;
+	steady_clock::time_point start;
 	int fail_count = 0;
+	int run_count = 0;
+	int skip_count = 0;
+
+	unique_ptr<CapturingStreambuf> cout_capture;
+	unique_ptr<CapturingStreambuf> cerr_capture;
+	vector<thread> workers;
+	mutex m;
+	condition_variable work_ready;
+	// deque не перемещает элементы при push_back, поэтому рабочие потоки могут
+	// держать ссылку на свой тест без блокировки
+	deque<TestResult> tests;
+	size_t next_to_run = 0;
+	size_t next_to_report = 0;
+	bool closed = false;
+
+	bool Selected(const string& test_name) const {
+		if (options.filter.empty()) {
+			return true;
+		}
+		istringstream patterns(options.filter);
+		for (string pattern; getline(patterns, pattern, ',');) {
+			if (!pattern.empty() && MatchesPattern(test_name, pattern)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <class TestFunc>
+	void Run(TestFunc& func, TestResult& result) const {
+		const auto test_start = steady_clock::now();
+		try {
+			func();
+			result.ok = true;
+		} catch (exception& e) {
+			result.error = e.what();
+		} catch (...) {
+			result.error = "Unknown exception caught";
+		}
+		result.elapsed = steady_clock::now() - test_start;
+		if (result.ok && options.time_budget.count() > 0 && result.elapsed > options.time_budget) {
+			result.ok = false;
+			result.error = "exceeded time budget of " + to_string(options.time_budget.count()) + " ms";
+		}
+	}
+
+	void Report(const TestResult& result) {
+		++run_count;
+		cerr << result.output << result.name;
+		if (result.ok) {
+			cerr << " OK";
+		} else {
+			++fail_count;
+			cerr << " fail: " << result.error;
+		}
+		cerr << " (" << duration_cast<milliseconds>(result.elapsed).count() << " ms)" << endl;
+	}
+
+	void Work() {
+		unique_lock lock(m);
+		while (true) {
+			work_ready.wait(lock, [this] { return closed || next_to_run < tests.size(); });
+			if (next_to_run == tests.size()) {
+				return;
+			}
+			TestResult& result = tests[next_to_run++];
+			lock.unlock();
+
+			CapturingStreambuf::Target() = &result.output;
+			Run(result.func, result);
+			CapturingStreambuf::Target() = nullptr;
+
+			lock.lock();
+			result.done = true;
+			while (next_to_report < tests.size() && tests[next_to_report].done) {
+				Report(tests[next_to_report++]);
+			}
+		}
+	}
 };
 
 #define ASSERT_EQUAL(x, y) {            \